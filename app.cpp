@@ -4,23 +4,48 @@
  * @date Created by Renato on 27-12-23.
  */
 #include "app.hpp"
+#include <chrono>
 #include <iostream>
 #include <sstream>
+#include <iomanip>
 /**
  * @brief Constructs an App object.
  *
  * Initializes a new GLFW window_ and creates instances of the Engine and Scene classes.
  * This is the primary entry point for setting up the Vulkan-based graphics application.
+ * Headless, no window_ is made and GLFW is left uninitialized.
  *
  * @param width The width_ of the GLFW window_.
  * @param height The height_ of the GLFW window_.
  * @param is_debug Indicates whether debugging features should be enabled.
+ * @param pacing Present mode, swap chain image count, frames in flight and frame rate limit.
+ * @param render The passes a frame is made of.
  */
-App::App(int width, int height, bool is_debug)
+App::App(int width, int height, bool is_debug, const vkutil::FramePacingSettings& pacing, const vkutil::RenderSettings& render)
 {
-    buildGlfwWindow(width, height, is_debug);
-    graphics_engine_ = new Engine(width, height, window_, is_debug);
+    headless_ = render.headless;
+    debug_ = is_debug;
+    window_ = nullptr;
+    if(!headless_)
+    {
+        buildGlfwWindow(width, height, is_debug);
+    }
+    graphics_engine_ = new Engine(width, height, window_, is_debug, pacing, render);
     scene_ = new Scene();
+    frame_dump_ = nullptr;
+    last_time_ = headless_ ? 0.0 : glfwGetTime();
+    current_time_ = last_time_;
+    num_frames_ = 0;
+    frame_time_ = 0.0f;
+    running_ = false;
+    minimized_ = false;
+    frame_limit_ = 0;
+    if(!headless_)
+    {
+        glfwSetWindowUserPointer(window_, this);
+        glfwSetFramebufferSizeCallback(window_, framebufferResizeCallback);
+        glfwSetKeyCallback(window_, keyCallback);
+    }
 }
 /**
  * @brief Initializes and creates a GLFW window_.
@@ -57,24 +82,128 @@ void App::buildGlfwWindow(int width, int height, bool is_debug_mode)
 /**
  * @brief Runs the main application loop.
  *
- * Handles the primary loop of the application, including polling for window_ events,
- * rendering the scene_, and calculating the frame rate. The loop continues until the
- * GLFW window_ should close.
+ * Handles the primary loop of the application on the main thread: window_ events, simulation and
+ * window_ titles, while a dedicated thread renders. Waiting on events with a timeout paces the
+ * simulation without spinning, and a hitch on either thread never blocks the other since they only
+ * meet through lock-free triple buffers. While minimized, the loop sleeps on events and the render
+ * thread idles. Headless, there are no events and the frames are rendered on the calling thread.
+ *
+ * @param frames The number of frames to render before returning, 0 to run until the window_ closes.
  */
-void App::run()
+void App::run(int frames)
+{
+    if(headless_)
+    {
+        if(frames <= 0)
+        {
+            std::cout << "Headless rendering needs a number of frames to render\n";
+            return;
+        }
+        renderHeadless(frames);
+        return;
+    }
+    frame_limit_ = frames;
+    // the render thread must have a snapshot to draw before it starts
+    publishScene();
+    running_ = true;
+    std::thread renderThread(&App::renderLoop, this);
+    // the render thread clears running_ once it rendered the frames it was asked for
+    while(running_ && !glfwWindowShouldClose(window_))
+    {
+        minimized_ = glfwGetWindowAttrib(window_, GLFW_ICONIFIED) != 0;
+        if(minimized_)
+        {
+            glfwWaitEvents();
+            continue;
+        }
+        glfwWaitEventsTimeout(1.0 / 240.0);
+        publishScene();
+        if(titles_.acquire())
+        {
+            glfwSetWindowTitle(window_, titles_.read_buffer().c_str());
+        }
+    }
+    running_ = false;
+    renderThread.join();
+}
+
+void App::dump_frames(const std::string& path)
+{
+    delete frame_dump_;
+    // headless frames are stepped at 60 Hz, windowed ones are at least close to it
+    frame_dump_ = new vkutil::FrameDump(path, vkutil::FrameDump::FormatFor(path), 60, debug_);
+    vkutil::FrameDump* dump = frame_dump_;
+    graphics_engine_->set_frame_callback([dump](const vkutil::ReadbackFrame& frame)
+    {
+        dump->write(frame);
+    });
+}
+
+void App::publishScene()
+{
+    scene_->update(glfwGetTime());
+    scene_->snapshot(snapshots_.write_buffer());
+    snapshots_.publish();
+}
+
+void App::renderLoop()
 {
-    while(!glfwWindowShouldClose(window_))
+    int rendered = 0;
+    while(running_)
     {
-        glfwPollEvents();
-        graphics_engine_->render(scene_);
+        if(minimized_)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        snapshots_.acquire();
+        graphics_engine_->render(snapshots_.read_buffer());
         calculateFrameRate();
+        if(frame_limit_ > 0 && ++rendered >= frame_limit_)
+        {
+            running_ = false;
+        }
+    }
+}
+
+void App::renderHeadless(int frames)
+{
+    SceneSnapshot snapshot;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < frames; ++frame)
+    {
+        scene_->update(frame / 60.0);
+        scene_->snapshot(snapshot);
+        graphics_engine_->render(snapshot);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Rendered " << frames << " frames headless in " << std::fixed << std::setprecision(3) << elapsed
+              << " s, " << std::setprecision(1) << frames / std::max(elapsed, 1e-9) << " fps, "
+              << graphics_engine_->present_latency_ms() << " ms latency\n";
+    logGpuTimes(true);
+}
+
+void App::logGpuTimes(bool average) const
+{
+    const std::vector<vkutil::GpuScopeTime>& times = graphics_engine_->gpu_times();
+    if(times.empty())
+    {
+        return;
     }
+    std::cout << (average ? "GPU ms/frame:" : "GPU ms:") << std::fixed << std::setprecision(3);
+    for(const vkutil::GpuScopeTime& scope : times)
+    {
+        double ms = average ? scope.totalMs / static_cast<double>(std::max<uint64_t>(scope.frames, 1)) : scope.lastMs;
+        std::cout << " " << scope.name << " " << ms;
+    }
+    std::cout << "\n";
 }
 /**
  * @brief Calculates and displays the frame rate.
  *
- * Measures the time elapsed since the last frame and updates the window_ title with the
- * current frame rate every second. This helps in monitoring the performance of the application.
+ * Measures the time elapsed since the last frame and publishes a window_ title with the
+ * current frame rate, present latency and GPU frame time every second. This helps in monitoring the performance of the application.
+ * GLFW only allows titles to be set from the main thread, which picks them up in run().
  */
 void App::calculateFrameRate()
 {
@@ -85,14 +214,49 @@ void App::calculateFrameRate()
     {
         int framerate = std::max(1, int(num_frames_ / delta));
         std::stringstream title;
-        title << "Running at " << framerate << " fps.";
-        glfwSetWindowTitle(window_, title.str().c_str());
+        title << "Running at " << framerate << " fps, " << std::fixed << std::setprecision(1)
+              << graphics_engine_->present_latency_ms() << " ms latency.";
+        // the frame is the first scope recorded
+        const std::vector<vkutil::GpuScopeTime>& gpuTimes = graphics_engine_->gpu_times();
+        if(!gpuTimes.empty())
+        {
+            title << " GPU " << std::setprecision(2) << gpuTimes.front().lastMs << " ms.";
+        }
+        vkutil::PipelineCompileStats compiles = graphics_engine_->pipeline_compile_stats();
+        if(compiles.queueDepth > 0)
+        {
+            title << " Compiling " << compiles.queueDepth << " pipelines.";
+        }
+        titles_.write_buffer() = title.str();
+        titles_.publish();
+        if(debug_)
+        {
+            logGpuTimes(false);
+        }
         last_time_ = current_time_;
         num_frames_ = -1;
         frame_time_ = float(1000.0 / framerate);
     }
     ++num_frames_;
 }
+/**
+ * @brief Forwards framebuffer size changes to the graphics engine.
+ *
+ * The swap chain is only flagged here, it is recreated by the render thread at the start of its next frame.
+ */
+void App::framebufferResizeCallback(GLFWwindow* window, int width, int height)
+{
+    App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
+    app->graphics_engine_->resize(width, height);
+}
+void App::keyCallback(GLFWwindow* window, int key, [[maybe_unused]] int scancode, int action, [[maybe_unused]] int mods)
+{
+    App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
+    if(key == GLFW_KEY_V && action == GLFW_PRESS)
+    {
+        app->graphics_engine_->cycle_debug_view();
+    }
+}
 /**
  * @brief Destructor of the App class.
  *
@@ -101,6 +265,8 @@ void App::calculateFrameRate()
  */
 App::~App()
 {
+    // the engine delivers the frames still in flight as it goes, the dump closes after
     delete graphics_engine_;
+    delete frame_dump_;
     delete scene_;
 }
\ No newline at end of file
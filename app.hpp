@@ -4,14 +4,20 @@
  * @Date Created by Renato on 27-12-23.
  *
  * This class manages the creation and lifecycle of a GLFW window_, initializes the graphics engine (Engine), and handles
- * the main application loop including rendering and frame rate calculations.
+ * the main application loop including rendering and frame rate calculations. Events and simulation run on the main
+ * thread, rendering runs on its own thread fed with scene_ snapshots.
  */
 #ifndef INC_3DLOADERVK_APP_HPP
 #define INC_3DLOADERVK_APP_HPP
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include "engine.hpp"
+#include "frame_dump.hpp"
 #include "scene.hpp"
+#include "triple_buffer.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
 /**
  * @class App
  * @brief The app class encapsulates the main application loop and initialization logic for a Vulkan-based graphics application.
@@ -22,13 +28,17 @@ public:
     /**
      * @brief Constructs an App object.
      *
-     * Initializes the GLFW window_ and creates instances of the Engine and Scene classes.
+     * Initializes the GLFW window_ and creates instances of the Engine and Scene classes. Headless
+     * rendering, as asked for by the render settings, creates no window_ and never initializes GLFW.
      *
      * @param width The width_ of the GLFW window_.
      * @param height The height_ of the GLFW window_.
      * @param is_debug Flag indicating whether to run in is_debug mode, affecting logging verbosity.
+     * @param pacing Present mode, swap chain image count, frames in flight and frame rate limit.
+     * @param render The passes a frame is made of.
      */
-    App(int width, int height, bool is_debug);
+    App(int width, int height, bool is_debug, const vkutil::FramePacingSettings& pacing = vkutil::FramePacingSettings(),
+        const vkutil::RenderSettings& render = vkutil::RenderSettings());
     /**
      * @brief Destructor for the App class-
      *
@@ -38,13 +48,36 @@ public:
     /**
      * @brief Runs the main application loop.
      *
-     * Continuosly polls for GLFW events, renders the scene_, and calculates the frame rate until the window_ should close.
+     * Starts the render thread, then continuously processes GLFW events and advances and publishes the scene_
+     * until the window_ should close. Headless, the frames are rendered on the calling thread instead.
+     *
+     * @param frames The number of frames to render before returning, 0 to run until the window_ closes.
+     *               Headless there is no window_ to close and a frame count is required.
+     */
+    void run(int frames = 0);
+    /**
+     * @brief Streams every rendered frame to a file, or to a command when the path starts with '|'.
+     *
+     * Frames are read back a few frames after they were rendered and written as Y4M when the path
+     * ends in .y4m and as raw texels otherwise. Call before run().
+     *
+     * @param path Where to write the frames.
      */
-    void run();
+    void dump_frames(const std::string& path);
 private:
     Engine* graphics_engine_;
     GLFWwindow* window_;
     Scene* scene_;
+    vkutil::FrameDump* frame_dump_;
+
+    // snapshots flow from the main thread to the render thread, window titles the other way
+    vkutil::TripleBuffer<SceneSnapshot> snapshots_;
+    vkutil::TripleBuffer<std::string> titles_;
+    std::atomic<bool> running_;
+    std::atomic<bool> minimized_;
+    bool headless_;
+    bool debug_;
+    int frame_limit_;
 
     double last_time_;
     double current_time_;
@@ -63,8 +96,47 @@ private:
     /**
      * @brief Calculates and updates the frame rate of the application.
      *
-     * Measures the time elapsed and updates the window_ title with the current frame rate every second.
+     * Measures the time elapsed and publishes a window_ title with the current frame rate, present
+     * latency and GPU frame time every second, and logs the GPU time of every pass in debug mode.
+     * Runs on the render thread; the main thread applies the title.
      */
     void calculateFrameRate();
+    /**
+     * @brief Prints the GPU time of the frame and of each of its passes on one line.
+     * @param average Whether to print the average over every frame read rather than the last one.
+     */
+    void logGpuTimes(bool average) const;
+    /**
+     * @brief Body of the render thread.
+     *
+     * Renders the most recent scene_ snapshot as fast as frame pacing allows, without ever waiting on
+     * the main thread, until run() asks it to stop.
+     */
+    void renderLoop();
+    /**
+     * @brief Renders a number of frames without a window_, stepping the scene_ at a fixed 60 Hz.
+     *
+     * The simulation advances by frame rather than by wall clock time, so every run renders the same
+     * frames however fast the device_ is. Reports the frame rate and average GPU times once done.
+     *
+     * @param frames The number of frames to render.
+     */
+    void renderHeadless(int frames);
+    /**
+     * @brief Advances the simulation and hands a new snapshot to the render thread.
+     */
+    void publishScene();
+    /**
+     * @brief GLFW callback forwarding framebuffer size changes to the graphics engine.
+     *
+     * @param window The GLFW window_ whose framebuffer changed.
+     * @param width The new framebuffer width.
+     * @param height The new framebuffer height.
+     */
+    static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+    /**
+     * @brief GLFW callback for key presses, V cycles the engine's debug views.
+     */
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 };
 #endif //INC_3DLOADERVK_APP_HPP
\ No newline at end of file
@@ -0,0 +1,176 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "async_compute.hpp"
+#include "commands.hpp"
+#include <iostream>
+#include <utility>
+
+namespace vkutil
+{
+    AsyncCompute::AsyncCompute(vk::Device device, vk::Queue queue, uint32_t compute_family, uint32_t graphics_family,
+                               uint32_t slot_count, bool debug)
+    {
+        device_ = device;
+        queue_ = queue;
+        compute_family_ = compute_family;
+        graphics_family_ = graphics_family;
+        debug_ = debug;
+        timeline_ = nullptr;
+        if(!async())
+        {
+            if(debug)
+            {
+                std::cout << "No dedicated compute queue, compute jobs run on the graphics queue\n";
+            }
+            return;
+        }
+        command_pool_ = vkinit::make_command_pool(device_, compute_family_, debug);
+        if(!command_pool_)
+        {
+            return;
+        }
+        vk::CommandBufferAllocateInfo allocInfo = { };
+        allocInfo.commandPool = command_pool_;
+        allocInfo.level = vk::CommandBufferLevel::ePrimary;
+        allocInfo.commandBufferCount = slot_count;
+        try
+        {
+            command_buffers_ = device_.allocateCommandBuffers(allocInfo);
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to allocate compute command buffers: " << err.what() << "\n";
+            return;
+        }
+        slot_values_.assign(slot_count, 0);
+        timeline_ = new Timeline(device_, debug);
+        if(debug)
+        {
+            std::cout << "Compute jobs run on queue family " << compute_family_ << ", graphics on " << graphics_family_ << "\n";
+        }
+    }
+
+    AsyncCompute::~AsyncCompute()
+    {
+        if(timeline_ != nullptr)
+        {
+            timeline_->wait(timeline_->last_signaled());
+        }
+        delete timeline_;
+        if(command_pool_)
+        {
+            device_.destroyCommandPool(command_pool_);
+        }
+    }
+
+    bool AsyncCompute::valid() const
+    {
+        return !async() || timeline_ != nullptr;
+    }
+
+    bool AsyncCompute::async() const
+    {
+        return compute_family_ != graphics_family_;
+    }
+
+    std::vector<uint32_t> AsyncCompute::sharing_families() const
+    {
+        if(!async())
+        {
+            return { };
+        }
+        return { graphics_family_, compute_family_ };
+    }
+
+    void AsyncCompute::schedule(vk::PipelineStageFlags consumer_stages, vk::AccessFlags consumer_access, Job job)
+    {
+        jobs_.push_back(std::move(job));
+        consumer_stages_ |= consumer_stages;
+        consumer_access_ |= consumer_access;
+    }
+
+    void AsyncCompute::record_inline(vk::CommandBuffer command_buffer)
+    {
+        if(async() || jobs_.empty())
+        {
+            return;
+        }
+        for(const Job& job : jobs_)
+        {
+            job(command_buffer);
+        }
+        vk::MemoryBarrier handoff(vk::AccessFlagBits::eShaderWrite, consumer_access_);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, consumer_stages_, { },
+                                       handoff, nullptr, nullptr);
+        ClearJobs();
+    }
+
+    ComputeHandoff AsyncCompute::submit(uint32_t slot)
+    {
+        ComputeHandoff handoff;
+        if(!async() || jobs_.empty() || !valid())
+        {
+            ClearJobs();
+            return handoff;
+        }
+        // already complete in practice, the graphics work of the slot's last frame waited on it
+        timeline_->wait(slot_values_[slot]);
+        vk::CommandBuffer commandBuffer = command_buffers_[slot];
+        try
+        {
+            commandBuffer.reset();
+            vk::CommandBufferBeginInfo beginInfo = { };
+            beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+            commandBuffer.begin(beginInfo);
+            for(const Job& job : jobs_)
+            {
+                job(commandBuffer);
+            }
+            commandBuffer.end();
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to record compute jobs: " << err.what() << "\n";
+            ClearJobs();
+            return handoff;
+        }
+
+        // the semaphore signal makes every write visible to the stages waiting on it
+        uint64_t signalValue = timeline_->advance();
+        vk::Semaphore signalSemaphore = timeline_->semaphore();
+        vk::TimelineSemaphoreSubmitInfo timelineInfo = { };
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &signalValue;
+        vk::SubmitInfo submitInfo = { };
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &signalSemaphore;
+        submitInfo.pNext = &timelineInfo;
+        try
+        {
+            queue_.submit(submitInfo, nullptr);
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to submit compute jobs: " << err.what() << "\n";
+            ClearJobs();
+            return handoff;
+        }
+        slot_values_[slot] = signalValue;
+        handoff.semaphore = signalSemaphore;
+        handoff.value = signalValue;
+        handoff.stages = consumer_stages_;
+        ClearJobs();
+        return handoff;
+    }
+
+    void AsyncCompute::ClearJobs()
+    {
+        jobs_.clear();
+        consumer_stages_ = { };
+        consumer_access_ = { };
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file async_compute.hpp
+ * @brief Defines the AsyncCompute class, which schedules compute work on a queue of its own.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_ASYNC_COMPUTE_HPP
+#define INC_3DLOADERVK_ASYNC_COMPUTE_HPP
+#include <vulkan/vulkan.hpp>
+#include "timeline.hpp"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vkutil
+{
+    /**
+     * @struct ComputeHandoff
+     * @brief What the graphics submission of a frame waits on before consuming its compute results.
+     *
+     * A value of zero means nothing was submitted and there is nothing to wait for.
+     */
+    struct ComputeHandoff
+    {
+        vk::Semaphore semaphore;
+        uint64_t value = 0;
+        vk::PipelineStageFlags stages;
+    };
+
+    /**
+     * @class AsyncCompute
+     * @brief Runs a frame's compute jobs on the dedicated compute queue, or inline where there is none.
+     *
+     * Jobs are scheduled while a frame is recorded. With a compute family of its own, submit()
+     * records them into the frame slot's command buffer and submits them to the compute queue ahead
+     * of the graphics work, signaling a compute timeline value the graphics submission waits on at
+     * the stages consuming the results, so compute overlaps whatever graphics work precedes those
+     * stages. Without one, record_inline() places them at the start of the graphics command buffer
+     * followed by a barrier to the same stages.
+     *
+     * Buffers jobs write and graphics reads are shared concurrently by sharing_families() rather
+     * than transferred between families every frame. Jobs of a frame slot reuse buffers only once
+     * the slot's previous frame completed, so compute never waits on graphics on the GPU.
+     * Not thread safe, belongs to the thread rendering.
+     */
+    class AsyncCompute
+    {
+    public:
+        using Job = std::function<void(vk::CommandBuffer)>;
+
+        /**
+         * @param device The Vulkan logical device_.
+         * @param queue The compute queue, the graphics queue when the families are the same.
+         * @param compute_family The family of the compute queue.
+         * @param graphics_family The family of the graphics queue.
+         * @param slot_count The number of frames in flight.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        AsyncCompute(vk::Device device, vk::Queue queue, uint32_t compute_family, uint32_t graphics_family,
+                     uint32_t slot_count, bool debug);
+        ~AsyncCompute();
+        AsyncCompute(const AsyncCompute&) = delete;
+        AsyncCompute& operator=(const AsyncCompute&) = delete;
+        [[nodiscard]] bool valid() const;
+        /**
+         * @brief Whether jobs run on a compute queue of their own.
+         */
+        [[nodiscard]] bool async() const;
+        /**
+         * @brief The families buffers crossing from compute to graphics are shared by, none when they are one.
+         */
+        [[nodiscard]] std::vector<uint32_t> sharing_families() const;
+        /**
+         * @brief Adds a job to the frame being recorded.
+         * @param consumer_stages The graphics stages reading what the job writes.
+         * @param consumer_access How those stages read it.
+         * @param job Records the job's dispatches.
+         */
+        void schedule(vk::PipelineStageFlags consumer_stages, vk::AccessFlags consumer_access, Job job);
+        /**
+         * @brief Records the scheduled jobs into a graphics command buffer, when not async().
+         */
+        void record_inline(vk::CommandBuffer command_buffer);
+        /**
+         * @brief Submits the scheduled jobs to the compute queue, when async().
+         * @param slot The frame in flight, whose command buffer is reused.
+         * @return What the frame's graphics submission has to wait on.
+         */
+        ComputeHandoff submit(uint32_t slot);
+    private:
+        void ClearJobs();
+
+        vk::Device device_;
+        vk::Queue queue_;
+        uint32_t compute_family_;
+        uint32_t graphics_family_;
+        bool debug_;
+        vk::CommandPool command_pool_;
+        std::vector<vk::CommandBuffer> command_buffers_;
+        // the compute timeline value each slot's command buffer was last submitted with
+        std::vector<uint64_t> slot_values_;
+        Timeline* timeline_;
+
+        std::vector<Job> jobs_;
+        vk::PipelineStageFlags consumer_stages_;
+        vk::AccessFlags consumer_access_;
+    };
+}
+#endif //INC_3DLOADERVK_ASYNC_COMPUTE_HPP
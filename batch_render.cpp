@@ -0,0 +1,221 @@
+/**
+ * @file batch_render.cpp
+ * @brief A command line worker rendering a scene_ headless into a file or pipe as fast as the device_ allows.
+ * @date Created by Renato on 18-10-26.
+ *
+ * Frames are rendered without a window_ or presentation, read back and streamed to the output,
+ * and the frame rate, the CPU time spent in every stage of a frame and the GPU time of every pass
+ * are reported once done.
+ */
+#include "engine.hpp"
+#include "frame_dump.hpp"
+#include "scene.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct BatchOptions
+    {
+        std::string scene;
+        std::string output;
+        int width = 1280;
+        int height = 720;
+        int frames = 0;
+        // deep enough that the CPU never waits on the GPU for anything but throughput
+        int framesInFlight = 3;
+        uint32_t fps = 60;
+        uint32_t samples = 1;
+        bool depthPrepass = false;
+        bool debug = false;
+        std::string device;
+        std::string gpuTrace;
+    };
+
+    void print_usage()
+    {
+        std::cout << "usage: batch_render <scene> --frames <count> --output <path> [options]\n"
+                  << "  --size <width>x<height>    resolution, 1280x720 by default\n"
+                  << "  --frames-in-flight <count> frames recorded ahead of the GPU, 3 by default\n"
+                  << "  --fps <rate>               simulation steps per second of output, 60 by default\n"
+                  << "  --msaa <samples>           MSAA sample count, 1 by default\n"
+                  << "  --depth-prepass            lay down depth in a pass of its own\n"
+                  << "  --device <index or name>   the GPU to render on, the highest scoring by default\n"
+                  << "  --gpu-trace <path>         write the GPU time of every frame and pass as a Chrome trace\n"
+                  << "  --debug                    validation layers and debug logging\n"
+                  << "The output is Y4M when the path ends in .y4m and raw texels otherwise,\n"
+                  << "a path starting with '|' pipes the frames to that command instead.\n";
+    }
+
+    bool parse_options(int argc, char** argv, BatchOptions& options)
+    {
+        for(int i = 1; i < argc; ++i)
+        {
+            std::string option = argv[i];
+            bool hasValue = i + 1 < argc;
+            if(option == "--depth-prepass")
+            {
+                options.depthPrepass = true;
+            }
+            else if(option == "--debug")
+            {
+                options.debug = true;
+            }
+            else if(option == "--size" && hasValue)
+            {
+                std::string size = argv[++i];
+                size_t separator = size.find('x');
+                if(separator == std::string::npos)
+                {
+                    return false;
+                }
+                options.width = std::atoi(size.substr(0, separator).c_str());
+                options.height = std::atoi(size.substr(separator + 1).c_str());
+            }
+            else if(option == "--frames" && hasValue)
+            {
+                options.frames = std::atoi(argv[++i]);
+            }
+            else if(option == "--output" && hasValue)
+            {
+                options.output = argv[++i];
+            }
+            else if(option == "--frames-in-flight" && hasValue)
+            {
+                options.framesInFlight = std::atoi(argv[++i]);
+            }
+            else if(option == "--fps" && hasValue)
+            {
+                options.fps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if(option == "--msaa" && hasValue)
+            {
+                options.samples = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if(option == "--device" && hasValue)
+            {
+                options.device = argv[++i];
+            }
+            else if(option == "--gpu-trace" && hasValue)
+            {
+                options.gpuTrace = argv[++i];
+            }
+            else if(options.scene.empty() && option.front() != '-')
+            {
+                options.scene = option;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        // sample count bits equal the counts they stand for
+        bool validSamples = options.samples > 0 && options.samples <= 64 && (options.samples & (options.samples - 1)) == 0;
+        return !options.scene.empty() && !options.output.empty() && options.frames > 0 && options.width > 0 &&
+               options.height > 0 && options.framesInFlight > 0 && options.fps > 0 && validSamples;
+    }
+
+    void print_stage(const char* name, double total_ms, uint64_t frames)
+    {
+        std::cout << "  " << std::left << std::setw(10) << name << std::right << std::setw(12) << total_ms
+                  << std::setw(12) << total_ms / static_cast<double>(std::max<uint64_t>(frames, 1)) << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BatchOptions options;
+    if(!parse_options(argc, argv, options))
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    Scene scene;
+    if(!scene.load(options.scene))
+    {
+        return EXIT_FAILURE;
+    }
+    vkutil::FrameDump* dump = new vkutil::FrameDump(options.output, vkutil::FrameDump::FormatFor(options.output), options.fps, options.debug);
+    if(!dump->valid())
+    {
+        delete dump;
+        return EXIT_FAILURE;
+    }
+
+    // nothing is presented, so nothing paces the frames but the frames in flight
+    vkutil::FramePacingSettings pacing;
+    pacing.framesInFlight = options.framesInFlight;
+    pacing.targetFps = 0.0;
+    pacing.maxQueuedPresents = 0;
+    vkutil::RenderSettings render;
+    render.headless = true;
+    render.depthPrepass = options.depthPrepass;
+    render.samples = static_cast<vk::SampleCountFlagBits>(options.samples);
+    render.device = options.device;
+    render.gpuTrace = options.gpuTrace;
+    Engine* engine = nullptr;
+    try
+    {
+        engine = new Engine(options.width, options.height, nullptr, options.debug, pacing, render);
+    }
+    catch(std::runtime_error &err)
+    {
+        std::cerr << err.what() << "\n";
+        delete dump;
+        return EXIT_FAILURE;
+    }
+    engine->set_frame_callback([dump](const vkutil::ReadbackFrame& frame)
+    {
+        dump->write(frame);
+    });
+
+    SceneSnapshot snapshot;
+    double sceneMs = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < options.frames; ++frame)
+    {
+        std::chrono::steady_clock::time_point simulated = std::chrono::steady_clock::now();
+        scene.update(frame / static_cast<double>(options.fps));
+        scene.snapshot(snapshot);
+        sceneMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - simulated).count();
+        engine->render(snapshot);
+    }
+    vkutil::FrameStageTimes times = engine->stage_times();
+    // read a few frames late, the frames still in flight are only in the trace
+    std::vector<vkutil::GpuScopeTime> gpuTimes = engine->gpu_times();
+    std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+    // finishing delivers the frames still in flight and writes out what the dump has queued
+    delete engine;
+    delete dump;
+    std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(finished - start).count();
+    std::cout << std::fixed << std::setprecision(3)
+              << "Rendered " << options.frames << " frames of " << options.width << "x" << options.height << " in "
+              << seconds << " s, " << std::setprecision(1) << options.frames / seconds << " fps\n"
+              << std::setprecision(3)
+              << "  stage         total ms    ms/frame\n";
+    print_stage("scene", sceneMs, times.frames);
+    print_stage("pace", times.paceMs, times.frames);
+    print_stage("wait", times.waitMs, times.frames);
+    print_stage("readback", times.readbackMs, times.frames);
+    print_stage("record", times.recordMs, times.frames);
+    print_stage("submit", times.submitMs, times.frames);
+    print_stage("finish", std::chrono::duration<double, std::milli>(finished - submitted).count(), times.frames);
+    if(!gpuTimes.empty())
+    {
+        std::cout << "  gpu scope     total ms    ms/frame\n";
+    }
+    for(const vkutil::GpuScopeTime& scope : gpuTimes)
+    {
+        std::string name = std::string(2 * scope.depth, ' ') + scope.name;
+        print_stage(name.c_str(), scope.totalMs, scope.frames);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "camera.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+Camera::Camera()
+{
+    position_ = glm::vec3(0.0f, 0.0f, 2.5f);
+    target_ = glm::vec3(0.0f);
+    up_ = glm::vec3(0.0f, 1.0f, 0.0f);
+    fov_y_ = glm::radians(60.0f);
+    near_ = 0.1f;
+    far_ = 100.0f;
+}
+
+void Camera::look_at(glm::vec3 position, glm::vec3 target, glm::vec3 up)
+{
+    position_ = position;
+    target_ = target;
+    up_ = up;
+}
+
+void Camera::set_perspective(float fov_y, float near_plane, float far_plane)
+{
+    fov_y_ = fov_y;
+    near_ = near_plane;
+    far_ = far_plane;
+}
+
+vkutil::CameraData Camera::data(float aspect) const
+{
+    vkutil::CameraData data{ };
+    data.view = glm::lookAt(position_, target_, up_);
+    data.projection = glm::perspectiveRH_ZO(fov_y_, aspect, near_, far_);
+    // Vulkan's clip space Y points down
+    data.projection[1][1] *= -1.0f;
+    data.viewProjection = data.projection * data.view;
+    data.position = glm::vec4(position_, 1.0f);
+
+    // planes from the rows of the view projection matrix, near is row 2 alone for a [0, 1] depth range
+    glm::mat4 rows = glm::transpose(data.viewProjection);
+    data.frustum[0] = rows[3] + rows[0];
+    data.frustum[1] = rows[3] - rows[0];
+    data.frustum[2] = rows[3] + rows[1];
+    data.frustum[3] = rows[3] - rows[1];
+    data.frustum[4] = rows[2];
+    data.frustum[5] = rows[3] - rows[2];
+    for(glm::vec4& plane : data.frustum)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return data;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file camera.hpp
+ * @brief Defines the Camera class, a perspective camera owned by the scene_.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_CAMERA_HPP
+#define INC_3DLOADERVK_CAMERA_HPP
+#include <glm/glm.hpp>
+#include "render_structs.hpp"
+
+/**
+ * @class Camera
+ * @brief A perspective camera looking from a position at a target.
+ *
+ * Plain data, copied into every scene_ snapshot. The renderer turns it into matrices once per
+ * frame, when the aspect ratio of the swap chain is known.
+ */
+class Camera
+{
+public:
+    Camera();
+    void look_at(glm::vec3 position, glm::vec3 target, glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f));
+    /**
+     * @param fov_y The vertical field of view, in radians.
+     * @param near_plane The distance to the near plane.
+     * @param far_plane The distance to the far plane.
+     */
+    void set_perspective(float fov_y, float near_plane, float far_plane);
+    /**
+     * @brief Computes the matrices and frustum for Vulkan's clip space, Y down and depth in [0, 1].
+     * @param aspect The width of the image divided by its height.
+     */
+    [[nodiscard]] vkutil::CameraData data(float aspect) const;
+private:
+    glm::vec3 position_;
+    glm::vec3 target_;
+    glm::vec3 up_;
+    float fov_y_;
+    float near_;
+    float far_;
+};
+#endif //INC_3DLOADERVK_CAMERA_HPP
@@ -8,23 +8,18 @@
 namespace vkinit
 {
     /**
-     * @brief Creates a Vulkan command pool.
-     *
-     * Sets up a Vulkan command pool using the provided device_, physical device_, and surface_.
-     * It is used for allocating command buffers.
+     * @brief Creates a Vulkan command pool for the queues of one family.
      *
      * @param device The Vulkan logical device_.
-     * @param physical_device The Vulkan physical device_.
-     * @param surface The Vulkan surface_.
+     * @param queue_family_index The family the command buffers will be submitted to.
      * @param debug Flag indicating whether to enable debug logging.
      * @return A Vulkan command pool object.
      */
-    vk::CommandPool make_command_pool(vk::Device device, vk::PhysicalDevice physical_device, vk::SurfaceKHR surface, bool debug)
+    vk::CommandPool make_command_pool(vk::Device device, uint32_t queue_family_index, bool debug)
     {
-        vkutil::QueueFamilyIndices queueFamilyIndices = vkutil::findQueueFamilies(physical_device, surface, debug);
         vk::CommandPoolCreateInfo poolInfo = { };
         poolInfo.flags = vk::CommandPoolCreateFlags() | vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
-        poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+        poolInfo.queueFamilyIndex = queue_family_index;
 
         try
         {
@@ -83,7 +78,7 @@ namespace vkinit
         allocInfo.level = vk::CommandBufferLevel::ePrimary;
         allocInfo.commandBufferCount = 1;
 
-        for(std::vector<vkutil::SwapChainFrame>::size_type i = 0; i < input_chunk.frames.size(); i++)
+        for(std::vector<vkutil::FrameSync>::size_type i = 0; i < input_chunk.frames.size(); i++)
         {
             try
             {
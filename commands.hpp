@@ -12,10 +12,10 @@ namespace vkinit
     {
         vk::Device device;
         vk::CommandPool command_pool;
-        std::vector<vkutil::SwapChainFrame>& frames;
+        std::vector<vkutil::FrameSync>& frames;
     };
 
-    vk::CommandPool make_command_pool(vk::Device device, vk::PhysicalDevice physical_device, vk::SurfaceKHR surface, bool debug);
+    vk::CommandPool make_command_pool(vk::Device device, uint32_t queue_family_index, bool debug);
 
     vk::CommandBuffer make_command_buffer(commandBufferInputChunk input_chunk, bool debug);
 
@@ -4,6 +4,7 @@
 #ifndef INC_3DLOADERVK_CONFIG_HPP
 #define INC_3DLOADERVK_CONFIG_HPP
 #include <vulkan/vulkan.hpp>
+#include <vector>
 
 struct BufferInput
 {
@@ -11,6 +12,8 @@ struct BufferInput
     vk::BufferUsageFlags usage;
     vk::Device logical_device;
     vk::PhysicalDevice physical_device;
+    // queue families sharing the buffer concurrently, exclusive to one family when fewer than two
+    std::vector<uint32_t> sharing_families;
 };
 
 struct Buffer
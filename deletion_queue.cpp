@@ -0,0 +1,43 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "deletion_queue.hpp"
+namespace vkutil
+{
+    void DeletionQueue::push(uint64_t value, std::function<void()> deleter)
+    {
+        deleters_.emplace_back(value, std::move(deleter));
+    }
+
+    /**
+     * @brief Runs every callback whose value the timeline has reached.
+     *
+     * Values are pushed in increasing order, so the queue stops at the first entry still pending
+     * and the timeline is only queried while there is something left to retire.
+     */
+    void DeletionQueue::flush(Timeline& timeline)
+    {
+        while(!deleters_.empty() && timeline.is_complete(deleters_.front().first))
+        {
+            std::function<void()> deleter = std::move(deleters_.front().second);
+            deleters_.pop_front();
+            deleter();
+        }
+    }
+
+    void DeletionQueue::flush_all()
+    {
+        while(!deleters_.empty())
+        {
+            std::function<void()> deleter = std::move(deleters_.front().second);
+            deleters_.pop_front();
+            deleter();
+        }
+    }
+
+    bool DeletionQueue::empty() const
+    {
+        return deleters_.empty();
+    }
+}
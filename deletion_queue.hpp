@@ -0,0 +1,47 @@
+/**
+ * @file deletion_queue.hpp
+ * @brief Defines the DeletionQueue class, which defers destruction of GPU resources until the GPU is done with them.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_DELETION_QUEUE_HPP
+#define INC_3DLOADERVK_DELETION_QUEUE_HPP
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+#include "timeline.hpp"
+
+namespace vkutil
+{
+    /**
+     * @class DeletionQueue
+     * @brief Holds destruction callbacks tagged with the timeline value after which they may run.
+     *
+     * Resources that may still be referenced by submitted work are pushed with the last value
+     * signaled on a timeline, and flushed once that value is reached, so nothing ever needs to
+     * wait for the device to go idle.
+     */
+    class DeletionQueue
+    {
+    public:
+        /**
+         * @brief Queues a callback to run once the timeline reaches a value.
+         * @param value The timeline value the resources are retired at.
+         * @param deleter The callback destroying the resources.
+         */
+        void push(uint64_t value, std::function<void()> deleter);
+        /**
+         * @brief Runs every callback whose value the timeline has reached.
+         * @param timeline The timeline the values were taken from.
+         */
+        void flush(Timeline& timeline);
+        /**
+         * @brief Runs every callback regardless of its value, for use once the device is idle.
+         */
+        void flush_all();
+        [[nodiscard]] bool empty() const;
+    private:
+        std::deque<std::pair<uint64_t, std::function<void()>>> deleters_;
+    };
+}
+#endif //INC_3DLOADERVK_DELETION_QUEUE_HPP
@@ -0,0 +1,323 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "descriptors.hpp"
+namespace vkutil
+{
+    namespace
+    {
+        // a pool never holds more sets than this, later pools are added at this size
+        constexpr uint32_t kMaxSetsPerPool = 4096;
+        // the arrays are sized to the device_'s limits, up to this many descriptors each
+        constexpr uint32_t kMaxBindlessDescriptors = 16384;
+
+        vk::DescriptorSetLayoutBinding bindless_binding(uint32_t binding, vk::DescriptorType type, uint32_t count)
+        {
+            return vk::DescriptorSetLayoutBinding(binding, type, count, vk::ShaderStageFlagBits::eAll);
+        }
+    }
+
+    DescriptorAllocator::DescriptorAllocator(vk::Device device, std::vector<DescriptorPoolSize> sizes, uint32_t initial_sets, bool debug)
+    {
+        device_ = device;
+        sizes_ = std::move(sizes);
+        sets_per_pool_ = std::clamp(initial_sets, 1u, kMaxSetsPerPool);
+        debug_ = debug;
+    }
+
+    DescriptorAllocator::~DescriptorAllocator()
+    {
+        for(vk::DescriptorPool pool : ready_pools_)
+        {
+            device_.destroyDescriptorPool(pool);
+        }
+        for(vk::DescriptorPool pool : full_pools_)
+        {
+            device_.destroyDescriptorPool(pool);
+        }
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout layout)
+    {
+        // a pool that is out of memory goes to the full list, the next one is tried once
+        for(int attempt = 0; attempt < 2; attempt++)
+        {
+            vk::DescriptorPool pool = ReadyPool();
+            if(!pool)
+            {
+                return vk::DescriptorSet{};
+            }
+            vk::DescriptorSetAllocateInfo allocInfo;
+            allocInfo.descriptorPool = pool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &layout;
+            try
+            {
+                return device_.allocateDescriptorSets(allocInfo)[0];
+            }
+            catch(vk::OutOfPoolMemoryError &err)
+            {
+                // retried below with the next pool
+            }
+            catch(vk::FragmentedPoolError &err)
+            {
+                // retried below with the next pool
+            }
+            catch(vk::SystemError &err)
+            {
+                std::cout << "Failed to allocate a descriptor set: " << err.what() << "\n";
+                return vk::DescriptorSet{};
+            }
+            ready_pools_.pop_back();
+            full_pools_.push_back(pool);
+        }
+        std::cout << "Failed to allocate a descriptor set from a new pool\n";
+        return vk::DescriptorSet{};
+    }
+
+    void DescriptorAllocator::reset()
+    {
+        for(vk::DescriptorPool pool : ready_pools_)
+        {
+            device_.resetDescriptorPool(pool);
+        }
+        for(vk::DescriptorPool pool : full_pools_)
+        {
+            device_.resetDescriptorPool(pool);
+            ready_pools_.push_back(pool);
+        }
+        full_pools_.clear();
+    }
+
+    vk::DescriptorPool DescriptorAllocator::ReadyPool()
+    {
+        if(!ready_pools_.empty())
+        {
+            return ready_pools_.back();
+        }
+        vk::DescriptorPool pool = CreatePool(sets_per_pool_);
+        if(!pool)
+        {
+            return pool;
+        }
+        sets_per_pool_ = std::min(sets_per_pool_ * 2, kMaxSetsPerPool);
+        ready_pools_.push_back(pool);
+        return pool;
+    }
+
+    vk::DescriptorPool DescriptorAllocator::CreatePool(uint32_t set_count)
+    {
+        std::vector<vk::DescriptorPoolSize> poolSizes;
+        for(const DescriptorPoolSize& size : sizes_)
+        {
+            poolSizes.emplace_back(size.type, size.perSet * set_count);
+        }
+        vk::DescriptorPoolCreateInfo poolInfo;
+        poolInfo.flags = vk::DescriptorPoolCreateFlags();
+        poolInfo.maxSets = set_count;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        try
+        {
+            vk::DescriptorPool pool = device_.createDescriptorPool(poolInfo);
+            if(debug_)
+            {
+                std::cout << "Created a descriptor pool for " << set_count << " sets\n";
+            }
+            return pool;
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to create a descriptor pool: " << err.what() << "\n";
+            return vk::DescriptorPool{};
+        }
+    }
+
+    BindlessTable::BindlessTable(vk::Device device, const vkinit::DeviceCapabilities& capabilities, LayoutCache& layouts, bool debug)
+    {
+        device_ = device;
+        debug_ = debug;
+        const vk::PhysicalDeviceVulkan12Properties& limits = capabilities.vulkan12Properties;
+        // both arrays are visible to every stage, so they share the per stage resource limit
+        uint32_t resources = limits.maxPerStageUpdateAfterBindResources / 2;
+        buffers_.capacity = std::min({ kMaxBindlessDescriptors, resources,
+                                       limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                       limits.maxDescriptorSetUpdateAfterBindStorageBuffers });
+        textures_.capacity = std::min({ kMaxBindlessDescriptors, resources,
+                                        limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                        limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                        limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                                        limits.maxDescriptorSetUpdateAfterBindSamplers });
+
+        std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+                bindless_binding(kBufferBinding, vk::DescriptorType::eStorageBuffer, buffers_.capacity),
+                bindless_binding(kTextureBinding, vk::DescriptorType::eCombinedImageSampler, textures_.capacity)
+        };
+        vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                                  vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                                                  vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+        vk::DescriptorSetLayout layout = layouts.reserve_set(kSet, bindings, { bindingFlags, bindingFlags },
+                                                             vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool);
+        if(!layout)
+        {
+            return;
+        }
+
+        std::vector<vk::DescriptorPoolSize> poolSizes = {
+                vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, buffers_.capacity),
+                vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, textures_.capacity)
+        };
+        vk::DescriptorPoolCreateInfo poolInfo;
+        poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        vk::DescriptorSetAllocateInfo allocInfo;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+        try
+        {
+            pool_ = device_.createDescriptorPool(poolInfo);
+            allocInfo.descriptorPool = pool_;
+            set_ = device_.allocateDescriptorSets(allocInfo)[0];
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to create the bindless descriptor set: " << err.what() << "\n";
+            return;
+        }
+        if(debug_)
+        {
+            std::cout << "Bindless table holds " << buffers_.capacity << " buffers and "
+                      << textures_.capacity << " textures\n";
+        }
+    }
+
+    BindlessTable::~BindlessTable()
+    {
+        // freed with the pool, the layout belongs to the layout cache
+        device_.destroyDescriptorPool(pool_);
+    }
+
+    bool BindlessTable::valid() const
+    {
+        return static_cast<bool>(set_);
+    }
+
+    uint32_t BindlessTable::add_buffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+    {
+        if(!set_)
+        {
+            return kInvalidIndex;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t index = Acquire(buffers_);
+        if(index == kInvalidIndex)
+        {
+            std::cout << "The bindless table is out of buffer slots\n";
+            return index;
+        }
+        vk::DescriptorBufferInfo bufferInfo(buffer, offset, range);
+        vk::WriteDescriptorSet write;
+        write.dstSet = set_;
+        write.dstBinding = kBufferBinding;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = vk::DescriptorType::eStorageBuffer;
+        write.pBufferInfo = &bufferInfo;
+        device_.updateDescriptorSets(write, nullptr);
+        return index;
+    }
+
+    uint32_t BindlessTable::add_texture(vk::ImageView view, vk::Sampler sampler, vk::ImageLayout layout)
+    {
+        if(!set_)
+        {
+            return kInvalidIndex;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t index = Acquire(textures_);
+        if(index == kInvalidIndex)
+        {
+            std::cout << "The bindless table is out of texture slots\n";
+            return index;
+        }
+        vk::DescriptorImageInfo imageInfo(sampler, view, layout);
+        vk::WriteDescriptorSet write;
+        write.dstSet = set_;
+        write.dstBinding = kTextureBinding;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        write.pImageInfo = &imageInfo;
+        device_.updateDescriptorSets(write, nullptr);
+        return index;
+    }
+
+    void BindlessTable::remove_buffer(uint32_t index, uint64_t timeline_value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Release(buffers_, index, timeline_value);
+    }
+
+    void BindlessTable::remove_texture(uint32_t index, uint64_t timeline_value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Release(textures_, index, timeline_value);
+    }
+
+    void BindlessTable::collect(Timeline& timeline)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Collect(buffers_, timeline);
+        Collect(textures_, timeline);
+    }
+
+    vk::DescriptorSet BindlessTable::set() const
+    {
+        return set_;
+    }
+
+    /**
+     * @brief Takes the most recently freed slot, or the next never used one.
+     */
+    uint32_t BindlessTable::Acquire(Slots& slots)
+    {
+        if(!slots.free.empty())
+        {
+            uint32_t index = slots.free.back();
+            slots.free.pop_back();
+            return index;
+        }
+        if(slots.next >= slots.capacity)
+        {
+            return kInvalidIndex;
+        }
+        return slots.next++;
+    }
+
+    /**
+     * @brief Queues a slot to be freed once the frame timeline reaches the given value.
+     *
+     * Frames in flight bind the same set, rewriting the slot before they completed would change
+     * what they read.
+     */
+    void BindlessTable::Release(Slots& slots, uint32_t index, uint64_t timeline_value)
+    {
+        if(index < slots.next)
+        {
+            slots.retired.emplace_back(timeline_value, index);
+        }
+    }
+
+    void BindlessTable::Collect(Slots& slots, Timeline& timeline)
+    {
+        // partially bound, a stale descriptor in a free slot is fine as long as no shader reads it
+        while(!slots.retired.empty() && timeline.is_complete(slots.retired.front().first))
+        {
+            slots.free.push_back(slots.retired.front().second);
+            slots.retired.pop_front();
+        }
+    }
+}
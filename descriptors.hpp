@@ -0,0 +1,166 @@
+/**
+ * @file descriptors.hpp
+ * @brief Defines the DescriptorAllocator, which hands out short lived descriptor sets, and the BindlessTable.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_DESCRIPTORS_HPP
+#define INC_3DLOADERVK_DESCRIPTORS_HPP
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "device.hpp"
+#include "layout_cache.hpp"
+#include "timeline.hpp"
+
+namespace vkutil
+{
+    /**
+     * @struct DescriptorPoolSize
+     * @brief How many descriptors of a type a pool holds for every set it can allocate.
+     */
+    struct DescriptorPoolSize
+    {
+        vk::DescriptorType type;
+        uint32_t perSet;
+    };
+
+    /**
+     * @class DescriptorAllocator
+     * @brief Allocates descriptor sets from a list of pools that grows when the pools run out.
+     *
+     * Sets are never freed one by one, reset() recycles every pool at once. The engine keeps one
+     * allocator per frame in flight and resets it once the frame's previous submission finished,
+     * so sets written while recording a frame live exactly as long as that frame. Each new pool
+     * holds twice the sets of the previous one, up to a limit.
+     *
+     * Not thread safe, an allocator belongs to the thread recording its frame.
+     */
+    class DescriptorAllocator
+    {
+    public:
+        /**
+         * @param device The Vulkan logical device_.
+         * @param sizes The descriptors each pool holds per set.
+         * @param initial_sets The number of sets the first pool holds.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        DescriptorAllocator(vk::Device device, std::vector<DescriptorPoolSize> sizes, uint32_t initial_sets, bool debug);
+        ~DescriptorAllocator();
+        DescriptorAllocator(const DescriptorAllocator&) = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+        /**
+         * @brief Allocates a set, creating a new pool when the current ones are exhausted.
+         * @return The set, or a null handle if no pool could hold it.
+         */
+        vk::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+        /**
+         * @brief Returns every set allocated so far to its pool. None of them may still be in use.
+         */
+        void reset();
+    private:
+        vk::DescriptorPool ReadyPool();
+        vk::DescriptorPool CreatePool(uint32_t set_count);
+
+        vk::Device device_;
+        std::vector<DescriptorPoolSize> sizes_;
+        uint32_t sets_per_pool_;
+        bool debug_;
+        std::vector<vk::DescriptorPool> ready_pools_;
+        std::vector<vk::DescriptorPool> full_pools_;
+    };
+
+    /**
+     * @class BindlessTable
+     * @brief One descriptor set holding large arrays of every buffer and texture, addressed by index.
+     *
+     * The set is bound once per frame at kSet and every pipeline_ layout reserves that number for it,
+     * so draws pass integer IDs, through push constants or buffers, instead of binding descriptors.
+     * Binding kBufferBinding is an array of storage buffers and kTextureBinding an array of combined
+     * image samplers, matching shaders/bindless.glsl.
+     *
+     * The bindings are partially bound and update after bind, so slots can be written while the
+     * set is bound by frames in flight, as long as those frames don't use the slots. A removed slot
+     * is therefore only handed out again once the frame timeline passed the value it was removed
+     * at, collect() puts it back on the free list.
+     *
+     * Only created when the device_ supports descriptor indexing. Thread safe.
+     */
+    class BindlessTable
+    {
+    public:
+        static constexpr uint32_t kSet = 1;
+        static constexpr uint32_t kBufferBinding = 0;
+        static constexpr uint32_t kTextureBinding = 1;
+        static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+        /**
+         * @param device The Vulkan logical device_.
+         * @param capabilities The snapshot of the physical device_, its 1.2 limits size the arrays.
+         * @param layouts The cache kSet is reserved in.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        BindlessTable(vk::Device device, const vkinit::DeviceCapabilities& capabilities, LayoutCache& layouts, bool debug);
+        ~BindlessTable();
+        BindlessTable(const BindlessTable&) = delete;
+        BindlessTable& operator=(const BindlessTable&) = delete;
+        /**
+         * @brief Whether the set was created. A table that failed hands out no indices.
+         */
+        [[nodiscard]] bool valid() const;
+        /**
+         * @brief Writes a storage buffer into a free slot.
+         * @return The slot's index, or kInvalidIndex when the table is full.
+         */
+        uint32_t add_buffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+        /**
+         * @brief Writes a texture and its sampler into a free slot.
+         * @return The slot's index, or kInvalidIndex when the table is full.
+         */
+        uint32_t add_texture(vk::ImageView view, vk::Sampler sampler,
+                             vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+        /**
+         * @brief Frees a buffer slot for reuse once the frames that may read it completed.
+         * @param index The slot.
+         * @param timeline_value The frame timeline value the last frame reading the slot signals.
+         */
+        void remove_buffer(uint32_t index, uint64_t timeline_value);
+        /**
+         * @brief Frees a texture slot for reuse once the frames that may read it completed.
+         * @param index The slot.
+         * @param timeline_value The frame timeline value the last frame reading the slot signals.
+         */
+        void remove_texture(uint32_t index, uint64_t timeline_value);
+        /**
+         * @brief Makes the removed slots whose frames completed free to hand out again, without blocking.
+         */
+        void collect(Timeline& timeline);
+        [[nodiscard]] vk::DescriptorSet set() const;
+    private:
+        struct Slots
+        {
+            uint32_t capacity = 0;
+            uint32_t next = 0;
+            std::vector<uint32_t> free;
+            // removed slots, in the order of the timeline values they wait for
+            std::deque<std::pair<uint64_t, uint32_t>> retired;
+        };
+
+        static uint32_t Acquire(Slots& slots);
+        static void Release(Slots& slots, uint32_t index, uint64_t timeline_value);
+        static void Collect(Slots& slots, Timeline& timeline);
+
+        vk::Device device_;
+        bool debug_;
+        vk::DescriptorPool pool_;
+        vk::DescriptorSet set_;
+        std::mutex mutex_;
+        Slots buffers_;
+        Slots textures_;
+    };
+}
+#endif //INC_3DLOADERVK_DESCRIPTORS_HPP
@@ -4,85 +4,220 @@
  * @date Created by Renato on 27-12-23.
  */
 #include "device.hpp"
+#include "instance.hpp"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+bool vkinit::DeviceCapabilities::supports(const std::string& extension) const
+{
+    return extensions.contains(extension);
+}
 /**
  * @brief Checks if a Vulkan physical device_ supports the required extensions.
  *
- * @param device The Vulkan physical device_ to check.
+ * @param capabilities The snapshot of the Vulkan physical device_ to check.
  * @param requested_extensions A vector of extension names to be checked.
  * @param debug Flag indicating whether to enable debug logging.
  * @return true if the device_ supports all requested extensions, false otherwise
  */
 bool vkinit::CheckDeviceExtensionSupport
 (
-    const vk::PhysicalDevice& device,
+    const DeviceCapabilities& capabilities,
     const std::vector<const char*>& requested_extensions,
     const bool& debug
 )
 {
-    std::set<std::string> requiredExtensions(requested_extensions.begin(), requested_extensions.end());
+    bool supported = true;
+    for(const char* extension : requested_extensions)
+    {
+        if(!capabilities.supports(extension))
+        {
+            if(debug)
+            {
+                std::cout << "\tmissing \"" << extension << "\"\n";
+            }
+            supported = false;
+        }
+    }
+    return supported;
+}
+/**
+ * @brief Takes the snapshot of a physical device_, the only place setup queries a device_'s capabilities.
+ *
+ * @param physical_device The Vulkan physical device_.
+ * @param surface The Vulkan surface_, or nullptr when rendering headless.
+ * @param instance_version The API version the instance_ was created for.
+ * @param debug Flag indicating whether to enable debug logging.
+ * @return The snapshot, scored when the device_ is suitable.
+ */
+vkinit::DeviceCapabilities vkinit::QueryCapabilities(vk::PhysicalDevice physical_device, vk::SurfaceKHR surface, uint32_t instance_version, bool debug)
+{
+    DeviceCapabilities capabilities;
+    capabilities.physicalDevice = physical_device;
+    capabilities.properties = physical_device.getProperties();
+    capabilities.memory = physical_device.getMemoryProperties();
+    // the patch version never decides what is core
+    capabilities.apiVersion = std::min(capabilities.properties.apiVersion, instance_version) & ~0xFFFU;
     if(debug)
     {
-        std::cout << "Device can support extensions:\n";
+        log_device_properties(capabilities.properties);
     }
-    for(vk::ExtensionProperties& extension : device.enumerateDeviceExtensionProperties())
+    for(const vk::ExtensionProperties& extension : physical_device.enumerateDeviceExtensionProperties())
     {
-        if(debug)
+        capabilities.extensions.insert(extension.extensionName);
+    }
+    for(uint32_t i = 0; i < capabilities.memory.memoryHeapCount; i++)
+    {
+        const vk::MemoryHeap& heap = capabilities.memory.memoryHeaps[i];
+        if(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal)
         {
-            std::cout << "\t\""<<extension.extensionName << "\"\n";
+            capabilities.deviceLocalBytes = std::max(capabilities.deviceLocalBytes, heap.size);
         }
-        requiredExtensions.erase(extension.extensionName);
     }
-    return requiredExtensions.empty();
+    capabilities.queueFamilies = vkutil::findQueueFamilies(physical_device, surface, debug);
+    if(capabilities.queueFamilies.graphicsFamily.has_value())
+    {
+        std::vector<vk::QueueFamilyProperties> families = physical_device.getQueueFamilyProperties();
+        capabilities.graphicsTimestampBits = families[capabilities.queueFamilies.graphicsFamily.value()].timestampValidBits;
+    }
+    // the 1.2 and 1.3 features and limits are only defined on devices used at those versions
+    if(capabilities.apiVersion >= VK_API_VERSION_1_3)
+    {
+        vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features> features =
+                physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features>();
+        capabilities.vulkan12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+        capabilities.vulkan12.pNext = nullptr;
+        capabilities.vulkan13 = features.get<vk::PhysicalDeviceVulkan13Features>();
+        capabilities.vulkan13.pNext = nullptr;
+    }
+    else if(capabilities.apiVersion >= VK_API_VERSION_1_2)
+    {
+        vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features> features =
+                physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        capabilities.vulkan12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+        capabilities.vulkan12.pNext = nullptr;
+    }
+    if(capabilities.apiVersion >= VK_API_VERSION_1_2)
+    {
+        vk::StructureChain<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties> properties =
+                physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+        capabilities.vulkan12Properties = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+        capabilities.vulkan12Properties.pNext = nullptr;
+    }
+    if(IsSuitable(capabilities, !surface, debug))
+    {
+        capabilities.optionalFeatures = QueryOptionalFeatures(capabilities, debug);
+        // present fences are of no use without presents, and need the instance_'s surface extensions
+        capabilities.optionalFeatures.swapchainMaintenance1 = capabilities.optionalFeatures.swapchainMaintenance1 && surface &&
+                                                              surface_maintenance_supported();
+        capabilities.score = ScoreDevice(capabilities);
+    }
+    return capabilities;
 }
 /**
  * @brief Determines if a Vulkan physical device_ is suitable for the application's needs.
  *
- * @param device The vulkan physical device_ to evaluate.
+ * @param capabilities The snapshot of the vulkan physical device_ to evaluate, why it isn't suitable is recorded in it.
+ * @param headless Whether the device_ renders without presenting, so needs no swap chain support.
  * @param debug Flag indicating whether to enable debug logging.
  * @return true if the device_ is suitable, false otherwise.
  */
-bool vkinit::IsSuitable(const vk::PhysicalDevice& device, const bool debug)
+bool vkinit::IsSuitable(DeviceCapabilities& capabilities, const bool headless, const bool debug)
 {
-    if(debug)
+    std::vector<const char*> requestedExtensions;
+    if(!headless)
     {
-        std::cout << "Checking if device_ is suitable\n";
+        requestedExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     }
-    const std::vector<const char*> requestedExtensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
-    if(debug)
+    if(capabilities.apiVersion < VK_API_VERSION_1_2)
     {
-        std::cout << "We are requesting device_ extensions:\n";
-        for(const char* extension : requestedExtensions)
-        {
-            std::cout << "\t\"" << extension << "\"\n";
-        }
+        capabilities.unsuitable = "no Vulkan 1.2";
     }
-    if(bool extensionSupported = CheckDeviceExtensionSupport(device, requestedExtensions, debug))
+    else if(!CheckDeviceExtensionSupport(capabilities, requestedExtensions, debug))
     {
-        if(debug && extensionSupported)
-        {
-            std::cout << "Device can support the requested extensions!\n";
-        }
+        capabilities.unsuitable = "no swap chain support";
     }
-    else
+    else if(!capabilities.vulkan12.timelineSemaphore)
     {
-        if(debug)
-        {
-            std::cout << "Device can't support the requested extensions!\n";
-        }
-        return false;
+        capabilities.unsuitable = "no timeline semaphores";
+    }
+    else if(!capabilities.queueFamilies.isComplete())
+    {
+        capabilities.unsuitable = headless ? "no graphics queue" : "no queue that can present to the window";
+    }
+    if(debug && !capabilities.unsuitable.empty())
+    {
+        std::cout << "Device can't be used: " << capabilities.unsuitable << "\n";
+    }
+    return capabilities.unsuitable.empty();
+}
+
+int64_t vkinit::ScoreDevice(const DeviceCapabilities& capabilities)
+{
+    int64_t score = 0;
+    switch(capabilities.properties.deviceType)
+    {
+        case vk::PhysicalDeviceType::eDiscreteGpu:
+            score = 10000;
+            break;
+        case vk::PhysicalDeviceType::eIntegratedGpu:
+            score = 5000;
+            break;
+        case vk::PhysicalDeviceType::eVirtualGpu:
+            score = 2500;
+            break;
+        case vk::PhysicalDeviceType::eOther:
+            score = 1000;
+            break;
+        case vk::PhysicalDeviceType::eCpu:
+            score = 0;
+            break;
+        default:
+            score = 0;
+    }
+    // a point per 64 MiB, capped well below the gap between two device_ types
+    constexpr vk::DeviceSize pointSize = vk::DeviceSize(64) << 20;
+    score += static_cast<int64_t>(std::min<vk::DeviceSize>(capabilities.deviceLocalBytes / pointSize, 1024));
+    score += capabilities.properties.limits.maxImageDimension2D / 1024;
+    if(capabilities.queueFamilies.hasAsyncCompute())
+    {
+        score += 200;
+    }
+    if(capabilities.optionalFeatures.descriptorIndexing)
+    {
+        score += 200;
     }
-    return true;
+    if(capabilities.optionalFeatures.graphicsPipelineLibrary)
+    {
+        score += 100;
+    }
+    if(capabilities.optionalFeatures.presentWait)
+    {
+        score += 50;
+    }
+    if(capabilities.optionalFeatures.dynamicRendering)
+    {
+        score += 50;
+    }
+    return score;
 }
 /**
- * @brief Chooses a suitable Vulkan physical device_ from available devices.
+ * @brief Chooses the fastest suitable Vulkan physical device_ from available devices.
+ *
+ * Every device_ is snapshotted and scored once. A preferred device_ wins over the score, so a
+ * machine with two GPUs can be pointed at either, and is matched by its index in enumeration order
+ * or by part of its name.
  *
  * @param instance The Vulkan instance_.
+ * @param surface The Vulkan surface_, or nullptr when rendering headless.
+ * @param instance_version The API version the instance_ was created for.
+ * @param preferred The device_ asked for, or empty.
  * @param debug Flag indicating whether to enable debug logging.
- * @return The chosen Vulkan physical device_.
+ * @return The snapshot of the chosen Vulkan physical device_.
  */
-vk::PhysicalDevice vkinit::ChoosePhysicalDevice(vk::Instance& instance, bool debug)
+vkinit::DeviceCapabilities vkinit::ChoosePhysicalDevice(vk::Instance& instance, vk::SurfaceKHR surface, uint32_t instance_version,
+                                                        const std::string& preferred, bool debug)
 {
     /**
      * Choose a suitable physical device_ from a list of candidates.
@@ -93,67 +228,327 @@ vk::PhysicalDevice vkinit::ChoosePhysicalDevice(vk::Instance& instance, bool deb
     {
         std::cout << "Choosing physical device_...\n";
     }
-    /**
-     * ResultValueType<std::vector<PhysicalDevice, PhysicalDeviceAllocator>>::type
-     * Instance::enumeratePhysicalDevices( Dispatch const & d )
-     * std::vector<vk::PhysicalDevice> instance_.enumeratePhysicalDevices( Dispatch const & d = static/default )
-     */
     std::vector<vk::PhysicalDevice>availableDevices = instance.enumeratePhysicalDevices();
     if(debug)
     {
         std::cout << "There are " << availableDevices.size() << " physical devices available on this system\n";
     }
+    std::vector<DeviceCapabilities> candidates;
     for(vk::PhysicalDevice device : availableDevices)
     {
-        if(debug)
+        candidates.push_back(QueryCapabilities(device, surface, instance_version, debug));
+        if(debug && candidates.back().unsuitable.empty())
         {
-            log_device_properties(device);
+            std::cout << "Device score: " << candidates.back().score << "\n";
         }
-        if(IsSuitable(device, debug))
+    }
+
+    auto lower = [](std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c)
+        {
+            return static_cast<char>(std::tolower(c));
+        });
+        return text;
+    };
+    bool byIndex = !preferred.empty() && std::all_of(preferred.begin(), preferred.end(), [](unsigned char c)
+    {
+        return std::isdigit(c) != 0;
+    });
+    size_t chosen = candidates.size();
+    for(size_t i = 0; i < candidates.size() && !preferred.empty(); i++)
+    {
+        std::string name = candidates[i].properties.deviceName;
+        bool matches = byIndex ? std::to_string(i) == preferred : lower(name).find(lower(preferred)) != std::string::npos;
+        if(!matches)
         {
-            return device;
+            continue;
         }
+        if(!candidates[i].unsuitable.empty())
+        {
+            std::cout << "Preferred device " << name << " can't be used: " << candidates[i].unsuitable << "\n";
+            continue;
+        }
+        chosen = i;
+        break;
     }
-    return nullptr;
+    if(!preferred.empty() && chosen == candidates.size())
+    {
+        std::cout << "No usable device matches \"" << preferred << "\", choosing by score\n";
+    }
+    if(chosen == candidates.size())
+    {
+        // ties go to the first enumerated, usually the one the system prefers
+        int64_t best = std::numeric_limits<int64_t>::min();
+        for(size_t i = 0; i < candidates.size(); i++)
+        {
+            if(candidates[i].unsuitable.empty() && candidates[i].score > best)
+            {
+                best = candidates[i].score;
+                chosen = i;
+            }
+        }
+    }
+    if(chosen == candidates.size())
+    {
+        std::cout << "No physical device can run the engine\n";
+        for(size_t i = 0; i < candidates.size(); i++)
+        {
+            std::cout << "  " << i << ": " << candidates[i].properties.deviceName << ": " << candidates[i].unsuitable << "\n";
+        }
+        return { };
+    }
+    std::cout << "Rendering on " << candidates[chosen].properties.deviceName << "\n";
+    return candidates[chosen];
 }
 /**
- * @brief Creates a Vulkan logical device_ from a physical device_.
+ * @brief Determines which optional features a physical device_ supports.
+ *
+ * Extension feature structures are only queried when the extension itself is available, descriptor
+ * indexing is read from the snapshot's Vulkan 1.2 features and dynamic rendering and synchronization2
+ * from its 1.3 features.
+ *
+ * @param capabilities The snapshot of the Vulkan physical device_.
+ * @param debug Flag indicating whether to enable debug logging.
+ * @return The optional features that can be enabled on this device_.
+ */
+vkinit::OptionalDeviceFeatures vkinit::QueryOptionalFeatures(const DeviceCapabilities& capabilities, bool debug)
+{
+    OptionalDeviceFeatures optional;
+    vk::PhysicalDevice physical_device = capabilities.physicalDevice;
+    const std::vector<const char*> presentWaitExtensions = {
+            VK_KHR_PRESENT_ID_EXTENSION_NAME,
+            VK_KHR_PRESENT_WAIT_EXTENSION_NAME
+    };
+    if(CheckDeviceExtensionSupport(capabilities, presentWaitExtensions, false))
+    {
+        vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR> features =
+                physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR>();
+        optional.presentWait = features.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId &&
+                               features.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+    }
+    if(capabilities.supports(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME))
+    {
+        vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT> features =
+                physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>();
+        optional.swapchainMaintenance1 = features.get<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>().swapchainMaintenance1 == VK_TRUE;
+    }
+    const std::vector<const char*> pipelineLibraryExtensions = {
+            VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+            VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME
+    };
+    if(CheckDeviceExtensionSupport(capabilities, pipelineLibraryExtensions, false))
+    {
+        vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT> features =
+                physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+        vk::StructureChain<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT> properties =
+                physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT>();
+        // without fast linking, linking costs as much as a full compile and libraries buy nothing
+        optional.graphicsPipelineLibrary = features.get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>().graphicsPipelineLibrary &&
+                                           properties.get<vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT>().graphicsPipelineLibraryFastLinking;
+    }
+    const vk::PhysicalDeviceVulkan12Features& indexing = capabilities.vulkan12;
+    optional.descriptorIndexing = indexing.runtimeDescriptorArray &&
+                                  indexing.descriptorBindingPartiallyBound &&
+                                  indexing.descriptorBindingUpdateUnusedWhilePending &&
+                                  indexing.descriptorBindingStorageBufferUpdateAfterBind &&
+                                  indexing.descriptorBindingSampledImageUpdateAfterBind &&
+                                  indexing.shaderStorageBufferArrayNonUniformIndexing &&
+                                  indexing.shaderSampledImageArrayNonUniformIndexing;
+    optional.dynamicRendering = capabilities.vulkan13.dynamicRendering == VK_TRUE;
+    optional.synchronization2 = capabilities.vulkan13.synchronization2 == VK_TRUE;
+    if(debug)
+    {
+        std::cout << "Optional features:\n";
+        std::cout << "\tpresent wait: " << (optional.presentWait ? "supported" : "unsupported") << '\n';
+        std::cout << "\tswapchain maintenance1: " << (optional.swapchainMaintenance1 ? "supported" : "unsupported") << '\n';
+        std::cout << "\tgraphics pipeline library: " << (optional.graphicsPipelineLibrary ? "supported" : "unsupported") << '\n';
+        std::cout << "\tdescriptor indexing: " << (optional.descriptorIndexing ? "supported" : "unsupported") << '\n';
+        std::cout << "\tdynamic rendering: " << (optional.dynamicRendering ? "supported" : "unsupported") << '\n';
+        std::cout << "\tsynchronization2: " << (optional.synchronization2 ? "supported" : "unsupported") << '\n';
+    }
+    return optional;
+}
+/**
+ * @brief Picks the most precise depth format the device_ can render to with optimal tiling.
  *
  * @param physical_device The Vulkan physical device_.
- * @param surface The Vulkan surface_.
+ * @param debug Flag indicating whether to enable debug logging.
+ * @return The depth format, or eUndefined if none of the candidates is supported.
+ */
+vk::Format vkinit::ChooseDepthFormat(vk::PhysicalDevice physical_device, bool debug)
+{
+    // the engine uses no stencil, formats without one come first
+    const std::array<vk::Format, 5> candidates = {
+            vk::Format::eD32Sfloat,
+            vk::Format::eX8D24UnormPack32,
+            vk::Format::eD32SfloatS8Uint,
+            vk::Format::eD24UnormS8Uint,
+            vk::Format::eD16Unorm
+    };
+    for(vk::Format format : candidates)
+    {
+        vk::FormatProperties properties = physical_device.getFormatProperties(format);
+        if(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+        {
+            if(debug)
+            {
+                std::cout << "Depth format: " << vk::to_string(format) << '\n';
+            }
+            return format;
+        }
+    }
+    if(debug)
+    {
+        std::cout << "No supported depth format\n";
+    }
+    return vk::Format::eUndefined;
+}
+/**
+ * @brief Clamps a requested sample count to what the device_ supports for both color and depth attachments.
+ *
+ * @param capabilities The snapshot of the Vulkan physical device_.
+ * @param requested The sample count asked for.
+ * @param debug Flag indicating whether to enable debug logging.
+ * @return The highest supported sample count not above the requested one.
+ */
+vk::SampleCountFlagBits vkinit::ChooseSampleCount(const DeviceCapabilities& capabilities, vk::SampleCountFlagBits requested, bool debug)
+{
+    const vk::PhysicalDeviceLimits& limits = capabilities.properties.limits;
+    vk::SampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+    const std::array<vk::SampleCountFlagBits, 7> counts = {
+            vk::SampleCountFlagBits::e64,
+            vk::SampleCountFlagBits::e32,
+            vk::SampleCountFlagBits::e16,
+            vk::SampleCountFlagBits::e8,
+            vk::SampleCountFlagBits::e4,
+            vk::SampleCountFlagBits::e2,
+            vk::SampleCountFlagBits::e1
+    };
+    vk::SampleCountFlagBits chosen = vk::SampleCountFlagBits::e1;
+    for(vk::SampleCountFlagBits count : counts)
+    {
+        if(static_cast<uint32_t>(count) <= static_cast<uint32_t>(requested) && (supported & count))
+        {
+            chosen = count;
+            break;
+        }
+    }
+    if(chosen != requested)
+    {
+        std::cout << "MSAA: " << vk::to_string(requested) << " is not supported, using " << vk::to_string(chosen) << '\n';
+    }
+    else if(debug)
+    {
+        std::cout << "MSAA: " << vk::to_string(chosen) << '\n';
+    }
+    return chosen;
+}
+/**
+ * @brief Creates a Vulkan logical device_ from a physical device_.
+ *
+ * @param capabilities The snapshot of the Vulkan physical device_.
+ * @param surface The Vulkan surface_, or nullptr for a headless device_ without swap chain support.
+ * @param optional_features The optional features to enable, as reported by QueryOptionalFeatures.
  * @param debug The Vulkan surface_.
  * @return The created Vulkan logical device_.
  */
-vk::Device vkinit::CreateLogicalDevice(vk::PhysicalDevice physical_device, vk::SurfaceKHR surface, bool debug)
+vk::Device vkinit::CreateLogicalDevice(const DeviceCapabilities& capabilities, vk::SurfaceKHR surface, const OptionalDeviceFeatures& optional_features, bool debug)
 {
-    vkutil::QueueFamilyIndices indices = vkutil::findQueueFamilies(physical_device, surface, debug);
+    const vkutil::QueueFamilyIndices& indices = capabilities.queueFamilies;
 
-    std::vector<uint32_t>uniqueIndices;
-    uniqueIndices.push_back(indices.graphicsFamily.value());
-    if(indices.graphicsFamily.value() != indices.presentFamily.value())
+    // one queue from every distinct family, the dedicated compute and transfer ones included
+    std::set<uint32_t> uniqueIndices =
     {
-        uniqueIndices.push_back(indices.presentFamily.value());
-    }
+        indices.graphicsFamily.value(),
+        indices.presentFamily.value(),
+        indices.computeFamily.value(),
+        indices.transferFamily.value()
+    };
 
     float queuePriority = 1.0f;
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfo;
-    for([[maybe_unused]] uint32_t queueFamilyIndex : uniqueIndices)
+    for(uint32_t queueFamilyIndex : uniqueIndices)
     {
         queueCreateInfo.emplace_back
         (
             vk::DeviceQueueCreateFlags(),
-            indices.graphicsFamily.value(),
+            queueFamilyIndex,
             1,
             &queuePriority
         );
     }
 
-    std::vector<const char*> deviceExtensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    std::vector<const char*> deviceExtensions;
+    // headless devices render into images of their own and never present
+    if(surface)
+    {
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+    if(optional_features.presentWait)
+    {
+        deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+    if(optional_features.swapchainMaintenance1)
+    {
+        deviceExtensions.push_back(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+    }
+    if(optional_features.graphicsPipelineLibrary)
+    {
+        deviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    }
 
 
     vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures();
+    vk::PhysicalDeviceVulkan12Features vulkan12Features = { };
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+    if(optional_features.descriptorIndexing)
+    {
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    }
+    vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures = { };
+    presentIdFeatures.presentId = VK_TRUE;
+    vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = { };
+    presentWaitFeatures.presentWait = VK_TRUE;
+    vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT swapchainMaintenanceFeatures = { };
+    swapchainMaintenanceFeatures.swapchainMaintenance1 = VK_TRUE;
+    vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures = { };
+    pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+    vk::PhysicalDeviceVulkan13Features vulkan13Features = { };
+    vulkan13Features.dynamicRendering = optional_features.dynamicRendering ? VK_TRUE : VK_FALSE;
+    vulkan13Features.synchronization2 = optional_features.synchronization2 ? VK_TRUE : VK_FALSE;
+    // each enabled optional feature is appended to the end of the chain
+    void** chainTail = &vulkan12Features.pNext;
+    // only chained when used, a device_ below 1.3 doesn't know the structure
+    if(optional_features.dynamicRendering || optional_features.synchronization2)
+    {
+        *chainTail = &vulkan13Features;
+        chainTail = &vulkan13Features.pNext;
+    }
+    if(optional_features.presentWait)
+    {
+        *chainTail = &presentIdFeatures;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        chainTail = &presentWaitFeatures.pNext;
+    }
+    if(optional_features.swapchainMaintenance1)
+    {
+        *chainTail = &swapchainMaintenanceFeatures;
+        chainTail = &swapchainMaintenanceFeatures.pNext;
+    }
+    if(optional_features.graphicsPipelineLibrary)
+    {
+        *chainTail = &pipelineLibraryFeatures;
+        chainTail = &pipelineLibraryFeatures.pNext;
+    }
     std::vector<const char*> enabledLayers;
     if(debug)
     {
@@ -170,9 +565,10 @@ vk::Device vkinit::CreateLogicalDevice(vk::PhysicalDevice physical_device, vk::S
         deviceExtensions.data(),
         &deviceFeatures
     );
+    deviceInfo.pNext = &vulkan12Features;
     try
     {
-        vk::Device device = physical_device.createDevice(deviceInfo);
+        vk::Device device = capabilities.physicalDevice.createDevice(deviceInfo);
         if(debug)
         {
             std::cout << "GPU has been successfully abstracted!\n";
@@ -190,23 +586,22 @@ vk::Device vkinit::CreateLogicalDevice(vk::PhysicalDevice physical_device, vk::S
     return nullptr;
 }
 /**
- * @brief Retrieves graphics and presentation queues from a Vulkan device_.
+ * @brief Retrieves the graphics, presentation, compute and transfer queues from a Vulkan device_.
  *
- * @param physical_device The Vulkan physical device_.
+ * Families shared between roles hand out the same queue, so compute and transfers go to the
+ * graphics queue on devices without families dedicated to them.
+ *
+ * @param capabilities The snapshot of the Vulkan physical device_ the device_ was created from.
  * @param device The Vulkan logical device_.
- * @param surface The Vulkan surface_.
- * @param debug Flag indicating whether to enable debug logging.
- * @return An array containing the graphics and presentation queues.
+ * @return The queues and the families they belong to.
  */
-std::array<vk::Queue, 2> vkinit::GetQueues(vk::PhysicalDevice physical_device, vk::Device device, vk::SurfaceKHR surface, bool debug)
+vkinit::DeviceQueues vkinit::GetQueues(const DeviceCapabilities& capabilities, vk::Device device)
 {
-    vkutil::QueueFamilyIndices indices = vkutil::findQueueFamilies(physical_device, surface, debug);
-
-    return
-    {
-        {
-            device.getQueue(indices.graphicsFamily.value(), 0),
-            device.getQueue(indices.presentFamily.value(), 0)
-        }
-    };
-}
\ No newline at end of file
+    DeviceQueues queues;
+    queues.families = capabilities.queueFamilies;
+    queues.graphics = device.getQueue(queues.families.graphicsFamily.value(), 0);
+    queues.present = device.getQueue(queues.families.presentFamily.value(), 0);
+    queues.compute = device.getQueue(queues.families.computeFamily.value(), 0);
+    queues.transfer = device.getQueue(queues.families.transferFamily.value(), 0);
+    return queues;
+}
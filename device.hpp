@@ -11,6 +11,7 @@
 #include <set>
 #include <string>
 #include <array>
+#include <cstdint>
 #include "queue_families.hpp"
 #include "logging.hpp"
 /**
@@ -33,16 +34,128 @@
   */
 namespace vkinit
 {
+    /**
+     * @struct OptionalDeviceFeatures
+     * @brief Features the engine uses when the device_ offers them, but can run without.
+     *
+     * presentWait covers both VK_KHR_present_id and VK_KHR_present_wait, which are only useful together.
+     * graphicsPipelineLibrary covers VK_KHR_pipeline_library and VK_EXT_graphics_pipeline_library, and is
+     * only reported when the driver also says fast linking is actually fast.
+     * descriptorIndexing covers the Vulkan 1.2 descriptor indexing features the bindless table needs:
+     * runtime arrays, partially bound and update after bind buffers and images, and non-uniform indexing.
+     * dynamicRendering and synchronization2 are the Vulkan 1.3 core features, only reported when both the
+     * device_ and the instance_ are 1.3. Without them the render graph builds render pass objects and
+     * records the original barriers.
+     * swapchainMaintenance1 covers VK_EXT_swapchain_maintenance1, for fences signaled once a present is done
+     * with its semaphores and swap chain. Only reported with a window_ and when the instance_ has the
+     * surface extensions it needs, see surface_maintenance_supported().
+     */
+    struct OptionalDeviceFeatures
+    {
+        bool presentWait = false;
+        bool swapchainMaintenance1 = false;
+        bool graphicsPipelineLibrary = false;
+        bool descriptorIndexing = false;
+        bool dynamicRendering = false;
+        bool synchronization2 = false;
+    };
+
+    /**
+     * @struct DeviceQueues
+     * @brief The queues of a logical device_, one per role, with the families they come from.
+     */
+    struct DeviceQueues
+    {
+        vk::Queue graphics;
+        vk::Queue present;
+        vk::Queue compute;
+        vk::Queue transfer;
+        vkutil::QueueFamilyIndices families;
+    };
+
+    /**
+     * @struct DeviceCapabilities
+     * @brief A snapshot of everything setup needs to know about a physical device_, queried once.
+     *
+     * ChoosePhysicalDevice takes one of every device to score them and returns the one it picked,
+     * which the engine keeps, so the rest of setup reads the snapshot instead of asking the driver again.
+     */
+    struct DeviceCapabilities
+    {
+        vk::PhysicalDevice physicalDevice;
+        vk::PhysicalDeviceProperties properties;
+        vk::PhysicalDeviceMemoryProperties memory;
+        // the version the device_ is used at, the lower of its own and the instance_'s
+        uint32_t apiVersion = 0;
+        // pNext is cleared, the chain they were queried with is gone, and 1.3 features stay zero below 1.3
+        vk::PhysicalDeviceVulkan12Features vulkan12;
+        vk::PhysicalDeviceVulkan13Features vulkan13;
+        // the 1.2 limits, descriptor indexing's among them, zero below 1.2 with pNext cleared too
+        vk::PhysicalDeviceVulkan12Properties vulkan12Properties;
+        std::set<std::string> extensions;
+        vkutil::QueueFamilyIndices queueFamilies;
+        // the bits of a timestamp written on the graphics queue that count, zero when it can't write any
+        uint32_t graphicsTimestampBits = 0;
+        OptionalDeviceFeatures optionalFeatures;
+        // the largest device_ local heap
+        vk::DeviceSize deviceLocalBytes = 0;
+        // why the device_ can't be used, empty when it meets every requirement
+        std::string unsuitable;
+        int64_t score = 0;
+
+        [[nodiscard]] bool supports(const std::string& extension) const;
+    };
+
     bool CheckDeviceExtensionSupport
     (
-        const vk::PhysicalDevice& device,
+        const DeviceCapabilities& capabilities,
         const std::vector<const char*>& requested_extensions,
         const bool& debug
     );
-    bool IsSuitable(const vk::PhysicalDevice& device, bool debug);
-    vk::PhysicalDevice ChoosePhysicalDevice(vk::Instance& instance, bool debug);
-    vk::Device CreateLogicalDevice(vk::PhysicalDevice physical_device, vk::SurfaceKHR surface, bool debug);
-    std::array<vk::Queue, 2> GetQueues(vk::PhysicalDevice physical_device, vk::Device device, vk::SurfaceKHR surface, bool debug);
+    /**
+     * @brief Queries the snapshot of a physical device_, checks its requirements and scores it.
+     *
+     * @param physical_device The Vulkan physical device_.
+     * @param surface The surface_ to present to, or nullptr when rendering headless.
+     * @param instance_version The API version the instance_ was created for.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The snapshot, with unsuitable set if the device_ can't be used.
+     */
+    DeviceCapabilities QueryCapabilities(vk::PhysicalDevice physical_device, vk::SurfaceKHR surface, uint32_t instance_version, bool debug);
+    bool IsSuitable(DeviceCapabilities& capabilities, bool headless, bool debug);
+    /**
+     * @brief Rates how fast a suitable device_ is expected to render, higher is faster.
+     *
+     * The device_ type dominates, discrete ahead of integrated ahead of virtual ahead of CPU
+     * rasterizers, so a large shared heap never lifts an integrated GPU past a discrete one. Within
+     * a type, device_ local memory, limits and optional features break the tie.
+     */
+    int64_t ScoreDevice(const DeviceCapabilities& capabilities);
+    /**
+     * @brief Picks the highest scoring suitable physical device_, unless one is asked for.
+     *
+     * @param instance The Vulkan instance_.
+     * @param surface The surface_ to present to, or nullptr when rendering headless.
+     * @param instance_version The API version the instance_ was created for.
+     * @param preferred An index in enumeration order or part of a device_ name, case insensitive,
+     *                  empty to go by score. A preferred device_ that can't be used is reported and skipped.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The snapshot of the chosen device_, with a null physicalDevice if there is none.
+     */
+    DeviceCapabilities ChoosePhysicalDevice(vk::Instance& instance, vk::SurfaceKHR surface, uint32_t instance_version,
+                                            const std::string& preferred, bool debug);
+    /**
+     * @brief Determines which optional features a physical device_ supports.
+     *
+     * @param capabilities The snapshot of the device_, its extensions and Vulkan 1.2 features filled in.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The optional features that can be enabled on this device_.
+     */
+    OptionalDeviceFeatures QueryOptionalFeatures(const DeviceCapabilities& capabilities, bool debug);
+    vk::Format ChooseDepthFormat(vk::PhysicalDevice physical_device, bool debug);
+    vk::SampleCountFlagBits ChooseSampleCount(const DeviceCapabilities& capabilities, vk::SampleCountFlagBits requested, bool debug);
+    vk::Device CreateLogicalDevice(const DeviceCapabilities& capabilities, vk::SurfaceKHR surface, const OptionalDeviceFeatures& optional_features, bool debug);
+    DeviceQueues GetQueues(const DeviceCapabilities& capabilities, vk::Device device);
 
 }
 #endif //INC_3DLOADERVK_DEVICE_HPP
\ No newline at end of file
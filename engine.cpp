@@ -21,10 +21,17 @@
 #include "logging.hpp"
 #include "device.hpp"
 #include "swapchain.hpp"
+#include "offscreen.hpp"
 #include "pipeline.hpp"
-#include "framebuffer.hpp"
+#include "shaders.hpp"
 #include "commands.hpp"
 #include "sync.hpp"
+#include "timeline.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
 #include <glm/gtc/matrix_transform.hpp>
 /**
  * @brief Constructs an Engine object
@@ -35,21 +42,56 @@
  *
  * @param width The width_ of the rendering window_.
  * @param height The height_ of the rendering window_.
- * @param window Pointer to the GLFWindow.
+ * @param window Pointer to the GLFWindow, unused when rendering headless.
  * @param debugMode Boolean flag to enable or disable debugging features.
+ * @param pacing Present mode, swap chain image count, frames in flight and frame rate limit.
+ * @param render The passes a frame is made of.
  */
-Engine::Engine(int width, int height, GLFWwindow* window, bool debugMode)
+Engine::Engine(int width, int height, GLFWwindow* window, bool debugMode, const vkutil::FramePacingSettings& pacing,
+               const vkutil::RenderSettings& render)
 {
     this->width_ = width;
     this->height_ = height;
     this->window_ = window;
     this->debug_mode_ = debugMode;
+    this->pacing_settings_ = pacing;
+    this->render_settings_ = render;
+    this->headless_ = render.headless;
+    this->max_frames_in_flight_ = std::max(1, pacing.framesInFlight);
+    this->swapchain_dirty_ = false;
+    this->resize_requested_ = false;
+    this->framebuffer_width_ = width;
+    this->framebuffer_height_ = height;
+    this->report_resize_ = false;
+    this->last_recreate_ms_ = 0.0;
+    this->layout_cache_ = nullptr;
+    this->bindless_ = nullptr;
+    this->descriptor_allocator_ = nullptr;
+    this->camera_buffer_ = nullptr;
+    this->camera_offset_ = 0;
+    this->debug_view_ = 0;
+    this->view_desc_view_ = UINT32_MAX;
+    this->bindless_objects_ = false;
+    this->draw_push_stages_ = vk::ShaderStageFlagBits::eVertex;
+    this->recording_object_buffer_ = vkutil::BindlessTable::kInvalidIndex;
+    this->render_graph_ = nullptr;
+    this->readback_ = nullptr;
+    this->async_compute_ = nullptr;
+    this->gpu_profiler_ = nullptr;
+    this->present_tracker_ = nullptr;
+    this->pipeline_states_ = nullptr;
+    this->shader_compiler_ = nullptr;
+    this->shader_watcher_ = nullptr;
     if(debugMode)
     {
         std::cout << "Making a graphics engine\n";
     }
     MakeInstance();
     MakeDevice();
+    MakePipelineCache();
+    MakeShaderCompiler();
+    MakeShaderWatcher();
+    MakeDescriptors();
     MakePipeline();
     FinalizeSetup();
     MakeAssets();
@@ -59,16 +101,20 @@ Engine::Engine(int width, int height, GLFWwindow* window, bool debugMode)
  *
  * This method creates a Vulkan instance_ with a given debug mode and application name.
  * It also sets up a debug messenger if debugging is enabled, and abstracts the GLFW
- * window_ surface_ for Vulkan use.
+ * window_ surface_ for Vulkan use, unless rendering headless without one.
  */
 void Engine::MakeInstance()
 {
-    instance_ = vkinit::make_instance(debug_mode_, "ID Tech 12");
+    instance_ = vkinit::make_instance(debug_mode_, "ID Tech 12", headless_);
     dldi_ =  vk::DispatchLoaderDynamic(instance_, vkGetInstanceProcAddr);
     if(debug_mode_)
     {
         debug_messenger_ = vkinit::make_debug_messenger(instance_, dldi_);
     }
+    if(headless_)
+    {
+        return;
+    }
     VkSurfaceKHR c_style_surface;
     if(glfwCreateWindowSurface(instance_, window_, nullptr, &c_style_surface) != VK_SUCCESS)
     {
@@ -88,101 +134,608 @@ void Engine::MakeInstance()
  *
  * Chooses and initalizes the physical device_, creates the logical device_, and sets up
  * the swap chain along with its related components like image format and extent. It also
- * initializes the queues for graphics and presentation
+ * initializes the queues for graphics, presentation, compute and transfers. Headless, the present
+ * queue is the graphics queue and is never presented to. Without a usable device_ the instance_ is
+ * torn down and a std::runtime_error thrown.
  */
 void Engine::MakeDevice()
 {
-    physical_device_ = vkinit::ChoosePhysicalDevice(instance_, debug_mode_);
-    //vkinit::findQueueFamilies(physical_device_, debug_mode_);
-    device_ = vkinit::CreateLogicalDevice(physical_device_, surface_, debug_mode_);
-    std::array<vk::Queue, 2> queues = vkinit::GetQueues(physical_device_, device_, surface_, debug_mode_);
-    graphics_queue_ = queues[0];
-    present_queue_ = queues[1];
-    MakeSwapchain();
+    std::string preferred = render_settings_.device;
+    if(const char* device = std::getenv("VKLOADER_DEVICE"); preferred.empty() && device != nullptr)
+    {
+        preferred = device;
+    }
+    device_capabilities_ = vkinit::ChoosePhysicalDevice(instance_, surface_, vkinit::instance_api_version(), preferred, debug_mode_);
+    if(!device_capabilities_.physicalDevice)
+    {
+        // the reason every device_ was rejected is printed by the choice, nothing past the instance_ exists yet
+        if(surface_)
+        {
+            instance_.destroySurfaceKHR(surface_);
+        }
+        if(debug_mode_)
+        {
+            instance_.destroyDebugUtilsMessengerEXT(debug_messenger_, nullptr, dldi_);
+        }
+        instance_.destroy();
+        glfwTerminate();
+        throw std::runtime_error("No Vulkan device can run the engine");
+    }
+    physical_device_ = device_capabilities_.physicalDevice;
+    optional_features_ = device_capabilities_.optionalFeatures;
+    if(headless_)
+    {
+        // nothing is presented, latency is measured to GPU completion instead
+        optional_features_.presentWait = false;
+    }
+    depth_format_ = vkinit::ChooseDepthFormat(physical_device_, debug_mode_);
+    samples_ = vkinit::ChooseSampleCount(device_capabilities_, render_settings_.samples, debug_mode_);
+    device_ = vkinit::CreateLogicalDevice(device_capabilities_, surface_, optional_features_, debug_mode_);
+    dldi_.init(device_);
+    frame_pacer_ = new vkutil::FramePacer(pacing_settings_, optional_features_.presentWait, debug_mode_);
+    vkinit::DeviceQueues queues = vkinit::GetQueues(device_capabilities_, device_);
+    graphics_queue_ = queues.graphics;
+    present_queue_ = queues.present;
+    compute_queue_ = queues.compute;
+    transfer_queue_ = queues.transfer;
+    queue_families_ = queues.families;
+    MakeSwapchain(nullptr);
     frame_number_ = 0;
     //vkinit::query_swapchain_support(physical_device_, surface_, true);
 }
 
-void Engine::MakeSwapchain()
+/**
+ * @brief Creates the swap chain, or headless the offscreen images standing in for it, one per frame in flight.
+ */
+void Engine::MakeSwapchain(vk::SwapchainKHR old_swapchain)
 {
-    vkinit::SwapChainBundle bundle = vkinit::create_swapchain(device_, physical_device_, surface_, width_, height_, debug_mode_);
+    vkinit::SwapChainBundle bundle = headless_
+            ? vkinit::create_offscreen_frames(device_, physical_device_, width_, height_, static_cast<uint32_t>(max_frames_in_flight_), debug_mode_)
+            : vkinit::create_swapchain(device_, physical_device_, surface_, queue_families_, width_, height_, old_swapchain, pacing_settings_, debug_mode_);
     swapchain_ = bundle.swapchain;
     swap_chain_frames_ = bundle.frames;
     swapchain_format_ = bundle.format;
     swapchain_extent_ = bundle.extent;
-    max_frames_in_flight_ = static_cast<int>(swap_chain_frames_.size());
+    swapchain_usage_ = bundle.usage;
+    MakeSwapchainSyncObjects();
 }
 
-void Engine::RecreateSwapchain()
+void Engine::cycle_debug_view()
 {
-    width_ = 0;
-    height_ = 0;
-    while(width_ == 0 || height_ == 0)
+    uint32_t view = (debug_view_.load() + 1) % kDebugViewCount;
+    debug_view_ = view;
+    std::cout << "Debug view: " << (view == 0 ? "shaded" : "depth") << "\n";
+}
+
+void Engine::resize(int width, int height)
+{
+    framebuffer_width_ = width;
+    framebuffer_height_ = height;
     {
-        glfwGetFramebufferSize(window_, &width_, &height_);
-        glfwWaitEvents();
+        std::lock_guard<std::mutex> lock(resize_mutex_);
+        resize_requested_ = true;
+    }
+    resize_signal_.notify_all();
+}
+/**
+ * @brief Blocks until resize() reports a new framebuffer size, or a short timeout passes.
+ *
+ * The timeout lets the thread rendering notice it is asked to stop while the window_ has no area.
+ */
+void Engine::WaitForResize()
+{
+    std::unique_lock<std::mutex> lock(resize_mutex_);
+    resize_signal_.wait_for(lock, std::chrono::milliseconds(100), [this]()
+    {
+        return resize_requested_.load();
+    });
+}
+
+double Engine::present_latency_ms() const
+{
+    return frame_pacer_->average_latency_ms();
+}
+
+vkutil::PipelineCompileStats Engine::pipeline_compile_stats() const
+{
+    return pipeline_states_->stats();
+}
+
+vkutil::FrameStageTimes Engine::stage_times() const
+{
+    return stage_times_;
+}
+
+const std::vector<vkutil::GpuScopeTime>& Engine::gpu_times() const
+{
+    return gpu_profiler_->scope_times();
+}
+
+void Engine::set_frame_callback(vkutil::ReadbackCallback callback)
+{
+    frame_callback_ = std::move(callback);
+    // the copy is a pass of the graph
+    MakeRenderGraph();
+}
+
+void Engine::RequestSwapchainRecreation()
+{
+    if(!swapchain_dirty_)
+    {
+        swapchain_dirty_ = true;
+        resize_requested_at_ = std::chrono::steady_clock::now();
     }
-    device_.waitIdle();
-    CleanupSwapchain();
-    MakeSwapchain();
-    MakeFramebuffers();
-    MakeFrameSyncObjects();
-    vkinit::commandBufferInputChunk commandBufferInput = {device_, command_pool_, swap_chain_frames_ };
-    vkinit::make_frame_command_buffer(commandBufferInput, debug_mode_);
+}
+/**
+ * @brief Hands a replaced swap chain and its frames to the present tracker.
+ *
+ * Everything that submitted frames may still reference is destroyed once the frame timeline
+ * reaches the last value signaled so far and the presents queued on the swap chain are done with
+ * it, and the present semaphores are recycled rather than destroyed. Offscreen frames are never
+ * presented and go through the deletion queue instead, they own their images, which go with them.
+ */
+void Engine::RetireSwapchain(vk::SwapchainKHR swapchain, const std::vector<vkutil::SwapChainFrame>& frames)
+{
+    std::function<void()> deleter = [this, frames, swapchain]()
+    {
+        for(const vkutil::SwapChainFrame& frame : frames)
+        {
+            device_.destroyImageView(frame.imageView);
+            recycled_semaphores_.push_back(frame.renderFinished);
+            if(frame.memory)
+            {
+                device_.destroyImage(frame.image);
+                device_.freeMemory(frame.memory);
+            }
+        }
+        if(swapchain)
+        {
+            device_.destroySwapchainKHR(swapchain);
+        }
+    };
+    if(!swapchain)
+    {
+        deletion_queue_.push(frame_timeline_->last_signaled(), std::move(deleter));
+        return;
+    }
+    present_tracker_->retire(frame_timeline_->last_signaled(), static_cast<uint32_t>(swap_chain_frames_.size()), std::move(deleter));
+}
+/**
+ * @brief Replaces the swap chain without stalling the device_.
+ *
+ * The old swap chain is passed to the new one and retired through the present tracker, frames in flight
+ * and pipelines are left untouched, so the only work is the new swap chain, its image views and the render graph.
+ *
+ * @return false if the framebuffer is 0x0, minimized or not, and there is nothing to render to.
+ */
+bool Engine::RecreateSwapchain()
+{
+    width_ = framebuffer_width_;
+    height_ = framebuffer_height_;
+    if(width_ == 0 || height_ == 0)
+    {
+        return false;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    vk::SwapchainKHR old_swapchain = swapchain_;
+    std::vector<vkutil::SwapChainFrame> old_frames = swap_chain_frames_;
+    vk::Format old_format = swapchain_format_;
+    MakeSwapchain(old_swapchain);
+    RetireSwapchain(old_swapchain, old_frames);
+    frame_pacer_->on_swapchain_recreated();
+    if(swapchain_format_ != old_format)
+    {
+        // the pipelines depend on the format, a rare enough event to afford an idle wait
+        device_.waitIdle();
+        MakePipeline();
+    }
+    MakeRenderGraph();
+    swapchain_dirty_ = false;
+    report_resize_ = true;
+    last_recreate_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
 }
 
+/**
+ * @brief Creates the layout cache and the descriptor sets every pipeline_ layout shares.
+ *
+ * Set 0 holds the camera, a dynamic uniform buffer written once per frame, and set 1 the bindless
+ * table when the device_ supports descriptor indexing. Both are reserved in the layout cache, so
+ * this runs before any pipeline_ layout is created.
+ */
+void Engine::MakeDescriptors()
+{
+    layout_cache_ = new vkutil::LayoutCache(device_);
+    if(optional_features_.descriptorIndexing)
+    {
+        bindless_ = new vkutil::BindlessTable(device_, device_capabilities_, *layout_cache_, debug_mode_);
+    }
+    descriptor_allocator_ = new vkutil::DescriptorAllocator(device_, {
+            { vk::DescriptorType::eUniformBufferDynamic, 1 }
+    }, 4, debug_mode_);
+    camera_buffer_ = new vkutil::FrameUniformBuffer(device_, device_capabilities_, sizeof(vkutil::CameraData),
+                                                    static_cast<uint32_t>(max_frames_in_flight_), debug_mode_);
+    vk::DescriptorSetLayoutBinding cameraBinding(0, vk::DescriptorType::eUniformBufferDynamic, 1,
+                                                 vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
+    vk::DescriptorSetLayout cameraLayout = layout_cache_->reserve_set(kCameraSet, { cameraBinding }, { }, { });
+    if(!cameraLayout || !camera_buffer_->valid())
+    {
+        return;
+    }
+    camera_set_ = descriptor_allocator_->allocate(cameraLayout);
+    if(!camera_set_)
+    {
+        return;
+    }
+    // written once, the dynamic offset picks the frame's slice at bind time
+    vk::DescriptorBufferInfo bufferInfo(camera_buffer_->buffer(), 0, camera_buffer_->range());
+    vk::WriteDescriptorSet write;
+    write.dstSet = camera_set_;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+    write.pBufferInfo = &bufferInfo;
+    device_.updateDescriptorSets(write, nullptr);
+}
+/**
+ * @brief Creates the pipeline_ cache, seeded from the previous run when the file is still valid.
+ */
+void Engine::MakePipelineCache()
+{
+    pipeline_cache_ = new vkutil::PipelineCache(device_, physical_device_, "pipeline_cache.bin", debug_mode_);
+}
 /**
  * @brief Configures the graphics pipeline_.
  *
- * This method creates and configures the Vulkan graphics pipeline_, including the
- * shader stages, render pass, and pipeline_ layout.
+ * This method creates the pipeline_ layout shared by every pipeline_, reflected from the base
+ * pipeline_'s shaders, then builds the pipeline_ DrawScene draws the quads with, and the depth pre-pass
+ * pipeline_ when there is one, in one parallel batch. How long it took is reported so cold and
+ * warm pipeline_ cache startups can be compared. A pipeline_ that fails to build is reported and
+ * a std::runtime_error thrown, DrawScene would otherwise silently draw nothing.
  */
 void Engine::MakePipeline()
 {
-    vkinit::GraphicsPipelineInBundle specification = { };
-    specification.device = device_;
-    std::string prefix = "../../"; // remove prefix addition unless using visual studio (windows only)
-    specification.vertexFilepath = prefix + "../shaders/vertex.spv";
-    specification.fragmentFilepath = prefix + "../shaders/fragment.spv";
-    specification.swapchainExtent = swapchain_extent_;
-    specification.swapchainImageFormat = swapchain_format_;
-    vkinit::GraphicsPipelineOutBundle output = vkinit::create_graphics_pipeline(specification, debug_mode_);
-    pipeline_layout_ = output.layout;
-    render_pass_ = output.renderpass;
-    pipeline_ = output.pipeline;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pipeline_desc_ = { };
+    pipeline_desc_.vertexShader = "shader.vert";
+    pipeline_desc_.fragmentShader = "shader.frag";
+    pipeline_desc_.topology = vk::PrimitiveTopology::eTriangleStrip;
+    pipeline_desc_.colorFormat = swapchain_format_;
+    pipeline_desc_.depthFormat = depth_format_;
+    pipeline_desc_.depthTest = depth_format_ != vk::Format::eUndefined;
+    pipeline_desc_.depthWrite = pipeline_desc_.depthTest;
+    pipeline_desc_.samples = samples_;
+    // without the bindless table draws push their model matrix, a variant compiled at runtime
+    bindless_objects_ = bindless_ != nullptr && bindless_->valid();
+    if(!bindless_objects_)
+    {
+        pipeline_desc_.defines = { "NO_BINDLESS" };
+    }
+    if(pipeline_states_ == nullptr)
+    {
+        pipeline_layout_ = vkinit::make_pipeline_layout(*layout_cache_, pipeline_desc_, debug_mode_);
+        if(std::optional<vkutil::PipelineInterface> layout = layout_cache_->find_interface(pipeline_layout_); layout && !layout->pushConstants.empty())
+        {
+            draw_push_stages_ = layout->pushConstants.front().stageFlags;
+        }
+        pipeline_states_ = new vkutil::PipelineStateCache(device_, *pipeline_cache_, *layout_cache_, pipeline_layout_, optional_features_.graphicsPipelineLibrary,
+                                                          optional_features_.dynamicRendering, debug_mode_);
+    }
+    else
+    {
+        pipeline_states_->reset();
+    }
+
+    std::vector<vkinit::PipelineDesc> descs;
+    if(render_settings_.depthPrepass && pipeline_desc_.depthTest)
+    {
+        // the pre-pass only runs the vertex shader, the color pass then shades each pixel once
+        depth_prepass_desc_ = pipeline_desc_;
+        depth_prepass_desc_.fragmentShader = "depth.frag";
+        depth_prepass_desc_.colorFormat = vk::Format::eUndefined;
+        pipeline_desc_.depthWrite = false;
+        pipeline_desc_.depthCompare = vk::CompareOp::eEqual;
+        descs.push_back(depth_prepass_desc_);
+    }
+    descs.push_back(pipeline_desc_);
+    std::vector<vk::Pipeline> pipelines = pipeline_states_->build_batch(descs);
+    // every frame draws with these, there is no point in running without them
+    for(size_t i = 0; i < pipelines.size(); i++)
+    {
+        if(!pipelines[i])
+        {
+            std::cerr << "Error: Failed to build the " << descs[i].vertexShader << " + " << descs[i].fragmentShader << " pipeline\n";
+            throw std::runtime_error("Failed to build the graphics pipelines");
+        }
+    }
+    // variants requested later compile in the background, drawn with the base pipeline_ until ready
+    pipeline_states_->set_fallback(pipeline_desc_);
+    view_desc_view_ = UINT32_MAX;
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Graphics pipelines created in " << elapsed << " ms with a "
+              << (pipeline_cache_->warm() ? "warm" : "cold") << " pipeline cache\n";
 }
 
-void Engine::MakeFramebuffers()
+/**
+ * @brief Creates the compiler for shader variants, which keeps their SPIR-V in shader_cache.
+ *
+ * Sources are read from the source tree the binary was built from unless VKLOADER_SHADER_SOURCE_DIR
+ * points elsewhere, so shipped builds can bring their own.
+ */
+void Engine::MakeShaderCompiler()
 {
-    vkinit::framebufferInput framebufferInput;
-    framebufferInput.device = device_;
-    framebufferInput.renderpass = render_pass_;
-    framebufferInput.swapchainExtent = swapchain_extent_;
-    vkinit::make_framebuffers(framebufferInput, swap_chain_frames_, debug_mode_);
+    const char* sources = std::getenv("VKLOADER_SHADER_SOURCE_DIR");
+    shader_compiler_ = new vkutil::ShaderCompiler(sources != nullptr ? sources : SHADER_SOURCE_DIR, "shader_cache", debug_mode_);
+    vkutil::set_shader_compiler(shader_compiler_);
+}
+/**
+ * @brief Sets where shaders may be loaded from instead of the embedded SPIR-V.
+ *
+ * VKLOADER_SHADER_DIR points the engine at a directory of <name>.spv files in any build. In debug
+ * mode the sources are also watched and recompiled into a scratch directory next to the binary,
+ * which starts out empty so a fresh run always begins from the embedded shaders.
+ */
+void Engine::MakeShaderWatcher()
+{
+    if(const char* directory = std::getenv("VKLOADER_SHADER_DIR"))
+    {
+        vkutil::set_shader_override_directory(directory);
+        if(debug_mode_)
+        {
+            std::cout << "Loading shader overrides from " << directory << "\n";
+        }
+        return;
+    }
+    if(!debug_mode_)
+    {
+        return;
+    }
+    std::filesystem::path overrides = SHADER_OVERRIDE_DIR;
+    std::error_code error;
+    std::filesystem::remove_all(overrides, error);
+    std::filesystem::create_directories(overrides, error);
+    if(error)
+    {
+        std::cout << "Failed to create " << overrides.string() << ", shader hot reload is disabled\n";
+        return;
+    }
+    vkutil::set_shader_override_directory(overrides);
+    shader_watcher_ = new vkutil::ShaderWatcher(SHADER_SOURCE_DIR, overrides, debug_mode_);
+}
+/**
+ * @brief Rebuilds pipelines whose shaders changed and swaps in the ones finished in the background.
+ *
+ * Runs at the start of a frame, so no frame mixes two versions of a pipeline_. Replaced pipelines
+ * may still be used by frames in flight and go through the deletion queue.
+ */
+void Engine::ApplyPipelineUpdates()
+{
+    if(shader_watcher_ != nullptr)
+    {
+        std::vector<std::string> changed = shader_watcher_->take_changed();
+        if(!changed.empty())
+        {
+            pipeline_states_->reload(changed);
+        }
+    }
+    std::vector<vk::Pipeline> replaced = pipeline_states_->apply_swaps();
+    if(!replaced.empty())
+    {
+        deletion_queue_.push(frame_timeline_->last_signaled(), [this, replaced]()
+        {
+            for(vk::Pipeline pipeline : replaced)
+            {
+                device_.destroyPipeline(pipeline);
+            }
+        });
+    }
+}
+
+/**
+ * @brief Declares the frame as a render graph for the current swap chain.
+ *
+ * The graph depends on the swap chain's format and extent, so it is rebuilt with it and the
+ * old one retired once the frames recorded with it are done. The depth buffer is a transient
+ * image of the graph, created with it: with a depth pre-pass it is cleared and written there and
+ * only tested in the color pass, otherwise the color pass does both. With MSAA the color pass
+ * renders to a multisampled transient image resolved into the swap chain image as the pass ends.
+ * Headless, the offscreen image takes the swap chain image's place and ends the frame ready to be
+ * copied from instead of presented. With a frame callback, a last pass copies the final image into
+ * a readback ring sized for the swap chain, replaced along with the graph. With dynamic rendering the
+ * graph holds no render passes or framebuffers, so a rebuild only recreates its transient images.
+ */
+void Engine::MakeRenderGraph()
+{
+    if(render_graph_ != nullptr)
+    {
+        vkutil::RenderGraph* old_graph = render_graph_;
+        deletion_queue_.push(frame_timeline_->last_signaled(), [old_graph]()
+        {
+            delete old_graph;
+        });
+    }
+    render_graph_ = new vkutil::RenderGraph(device_, physical_device_, optional_features_.dynamicRendering,
+                                            optional_features_.synchronization2, debug_mode_);
+    swapchain_image_ = render_graph_->import_image(headless_ ? "offscreen" : "swapchain", { swapchain_format_, swapchain_extent_ },
+                                                   headless_ ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR);
+    vk::ClearDepthStencilValue farthest(1.0f, 0);
+    vkutil::RenderGraphImage depth;
+    if(depth_format_ != vk::Format::eUndefined)
+    {
+        depth = render_graph_->create_image("depth", { depth_format_, swapchain_extent_, samples_ });
+    }
+    bool prepass = render_settings_.depthPrepass && depth.valid();
+    if(prepass)
+    {
+        render_graph_->add_pass("depth prepass")
+                .write_depth(depth, farthest)
+                .execute([this](vk::CommandBuffer commandBuffer)
+                {
+                    DrawScene(commandBuffer, true);
+                });
+    }
+    // color, its resolve and then depth, in the order the pipelines' render pass declares them
+    vk::ClearColorValue background(std::array<float, 4>{1.0f, 0.5f, 0.25f, 1.0f});
+    vkutil::RenderGraphPass scene = render_graph_->add_pass("scene");
+    if(samples_ != vk::SampleCountFlagBits::e1)
+    {
+        vkutil::RenderGraphImage color = render_graph_->create_image("color", { swapchain_format_, swapchain_extent_, samples_ });
+        scene.write_color(color, background).resolve(swapchain_image_);
+    }
+    else
+    {
+        scene.write_color(swapchain_image_, background);
+    }
+    if(prepass)
+    {
+        scene.read_depth(depth);
+    }
+    else if(depth.valid())
+    {
+        scene.write_depth(depth, farthest);
+    }
+    scene.execute([this](vk::CommandBuffer commandBuffer)
+    {
+        DrawScene(commandBuffer, false);
+    });
+    if(readback_ != nullptr)
+    {
+        vkutil::ReadbackRing* old_readback = readback_;
+        readback_ = nullptr;
+        deletion_queue_.push(frame_timeline_->last_signaled(), [this, old_readback]()
+        {
+            // every copy it holds has completed by now, draining only delivers them
+            old_readback->drain(*frame_timeline_);
+            delete old_readback;
+        });
+    }
+    if(frame_callback_ && !(swapchain_usage_ & vk::ImageUsageFlagBits::eTransferSrc))
+    {
+        std::cout << "Swap chain images can't be copied from, frames won't be read back\n";
+    }
+    else if(frame_callback_)
+    {
+        readback_ = new vkutil::ReadbackRing(device_, physical_device_, swapchain_extent_, swapchain_format_,
+                                             static_cast<uint32_t>(max_frames_in_flight_) + 1, frame_callback_, debug_mode_);
+        render_graph_->add_pass("readback")
+                .copy_from(swapchain_image_)
+                .keep()
+                .execute([this](vk::CommandBuffer commandBuffer)
+                {
+                    readback_->record(commandBuffer, render_graph_->image(swapchain_image_));
+                });
+    }
+    render_graph_->compile();
 }
 void Engine::MakeFrameSyncObjects()
 {
-    for(vkutil::SwapChainFrame& frame : swap_chain_frames_)
+    for(vkutil::FrameSync& frame : frames_)
     {
-        frame.inFlight = vkinit::make_fence(device_, debug_mode_);
+        frame.timelineValue = 0;
         frame.imageAvailable = vkinit::make_semaphore(device_, debug_mode_);
-        frame.renderFinished = vkinit::make_semaphore(device_, debug_mode_);
+        frame.descriptors = new vkutil::DescriptorAllocator(device_, {
+                { vk::DescriptorType::eUniformBuffer, 2 },
+                { vk::DescriptorType::eUniformBufferDynamic, 1 },
+                { vk::DescriptorType::eStorageBuffer, 2 },
+                { vk::DescriptorType::eCombinedImageSampler, 4 }
+        }, 16, debug_mode_);
     }
 }
+/**
+ * @brief Creates the profiler timing the frame and its passes with timestamps on the graphics queue.
+ *
+ * The trace goes where the render settings say, or the VKLOADER_GPU_TRACE environment variable
+ * when they don't, and isn't written when neither does.
+ */
+void Engine::MakeGpuProfiler()
+{
+    std::string trace = render_settings_.gpuTrace;
+    if(const char* path = std::getenv("VKLOADER_GPU_TRACE"); trace.empty() && path != nullptr)
+    {
+        trace = path;
+    }
+    // the frame, inline culling and every pass, with room to spare for passes added later
+    gpu_profiler_ = new vkutil::GpuProfiler(device_, device_capabilities_.properties.limits.timestampPeriod,
+                                            device_capabilities_.graphicsTimestampBits,
+                                            static_cast<uint32_t>(max_frames_in_flight_), 32, trace, debug_mode_);
+}
+/**
+ * @brief Gives every swap chain image a present semaphore, reusing retired ones first.
+ */
+void Engine::MakeSwapchainSyncObjects()
+{
+    for(vkutil::SwapChainFrame& frame : swap_chain_frames_)
+    {
+        if(recycled_semaphores_.empty())
+        {
+            frame.renderFinished = vkinit::make_semaphore(device_, debug_mode_);
+        }
+        else
+        {
+            frame.renderFinished = recycled_semaphores_.back();
+            recycled_semaphores_.pop_back();
+        }
+    }
+}
+/**
+ * @brief Creates the culling compute pipeline_ and the scheduler running it on the async compute queue.
+ *
+ * Culling reads the frame's bounding spheres and writes a draw command per object, both through
+ * storage buffers of a set of its own, and takes the frustum as push constants. Without the pipeline_
+ * every object is drawn.
+ */
+void Engine::MakeCulling()
+{
+    async_compute_ = new vkutil::AsyncCompute(device_, compute_queue_, queue_families_.computeFamily.value(),
+                                              queue_families_.graphicsFamily.value(),
+                                              static_cast<uint32_t>(max_frames_in_flight_), debug_mode_);
+    std::vector<vk::DescriptorSetLayoutBinding> bindings =
+    {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)
+    };
+    culling_set_layout_ = layout_cache_->set_layout(bindings);
+    if(!culling_set_layout_)
+    {
+        return;
+    }
+    vk::PushConstantRange pushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(vkutil::CullingData));
+    vk::PipelineLayoutCreateInfo layoutInfo = { };
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &culling_set_layout_;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstants;
+    try
+    {
+        culling_layout_ = device_.createPipelineLayout(layoutInfo);
+    }
+    catch(vk::SystemError &err)
+    {
+        std::cout << "Failed to create the culling pipeline layout, drawing without culling\n";
+        return;
+    }
+    culling_pipeline_ = vkinit::create_compute_pipeline(device_, pipeline_cache_->get(), culling_layout_, "cull.comp", debug_mode_);
+}
 /**
  * @brief Finalizes the engine setup.
  *
- * Completes the engine setup by crafting framebuffers, command pools, and command
- * buffers. It also prepares synchronization primitives for rendering.
+ * Completes the engine setup by building the render graph, command pools, and command
+ * buffers. It also prepares synchronization primitives for rendering and the culling pass.
  */
 void Engine::FinalizeSetup()
 {
-    MakeFramebuffers();
-    command_pool_ = vkinit::make_command_pool(device_, physical_device_, surface_, debug_mode_);
-    vkinit::commandBufferInputChunk commandBufferInput = {device_, command_pool_, swap_chain_frames_ };
+    MakeRenderGraph();
+    command_pool_ = vkinit::make_command_pool(device_, queue_families_.graphicsFamily.value(), debug_mode_);
+    frames_.resize(static_cast<size_t>(max_frames_in_flight_));
+    vkinit::commandBufferInputChunk commandBufferInput = {device_, command_pool_, frames_ };
     main_command_buffer_ = vkinit::make_command_buffer(commandBufferInput, debug_mode_);
     vkinit::make_frame_command_buffer(commandBufferInput, debug_mode_);
+    frame_timeline_ = new vkutil::Timeline(device_, debug_mode_);
+    present_tracker_ = new vkutil::PresentTracker(device_, optional_features_.swapchainMaintenance1, debug_mode_);
     MakeFrameSyncObjects();
+    MakeGpuProfiler();
+    MakeCulling();
 }
 
 void Engine::MakeAssets()
@@ -204,15 +757,15 @@ void Engine::PrepareScene(vk::CommandBuffer commandBuffer)
 /**
  * @brief Records draw commands into a command buffer.
  *
- * Prepares a command buffer for drawing operations, binding the graphics pipeline_ and
- * specifying the vertex data to be rendered. It also manages render passes and push
- * constants for each frame.
+ * Writes the camera for the frame, schedules culling, points the render graph at the acquired swap
+ * chain image and records the graph, which places the render passes and barriers around DrawScene.
+ * The whole frame, culling when it runs inline and every pass are timed by the GPU profiler.
  *
  * @param commandBuffer The command buffer to record the drawing commands into.
  * @param imageIndex The index of the swap chain image that will be rendered.
- * @param scene Pointer to the scene_ to be rendered.
+ * @param scene The snapshot of the scene_ to be rendered.
  */
-void Engine::RecordDrawCommands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene)
+void Engine::RecordDrawCommands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, const SceneSnapshot& scene)
 {
     vk::CommandBufferBeginInfo beginInfo = { };
     try
@@ -226,34 +779,39 @@ void Engine::RecordDrawCommands(vk::CommandBuffer commandBuffer, uint32_t imageI
             std::cout << "Failed to begin recording command buffer" << std::endl;
         }
     }
-    vk::RenderPassBeginInfo renderPassInfo = { };
-    renderPassInfo.renderPass = render_pass_;
-    renderPassInfo.framebuffer = swap_chain_frames_[imageIndex].framebuffer;
-    renderPassInfo.renderArea.offset.x = 0;
-    renderPassInfo.renderArea.offset.y = 0;
-    renderPassInfo.renderArea.extent = swapchain_extent_;
-
-    vk::ClearValue clearColor = { std::array<float, 4>{1.0f, 0.5f, 0.25f, 1.0f} };
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
-    commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics , pipeline_);
-
-    PrepareScene(commandBuffer);
-    int index = 0;
-    for(glm::vec3 position : scene->triangle_positions_)
+    // the slot's previous frame completed before recording started, so its timestamps are ready to read
+    gpu_profiler_->begin_frame(commandBuffer, static_cast<uint32_t>(frame_number_));
+    uint32_t frameScope = gpu_profiler_->begin_scope(commandBuffer, "frame");
+    // the view and projection are computed once per frame, draws only push which object they draw
+    float aspect = static_cast<float>(swapchain_extent_.width) / static_cast<float>(swapchain_extent_.height);
+    vkutil::CameraData camera = scene.camera.data(aspect);
+    if(camera_set_)
     {
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-        if(index == 1){
-            model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        camera_offset_ = camera_buffer_->write(static_cast<uint32_t>(frame_number_), camera);
+    }
+    recording_draws_ = ScheduleCulling(frames_[static_cast<size_t>(frame_number_)], scene, camera);
+    recording_object_buffer_ = WriteObjects(frames_[static_cast<size_t>(frame_number_)], scene);
+    if(uint32_t view = debug_view_.load(); view != view_desc_view_)
+    {
+        view_desc_ = pipeline_desc_;
+        if(view != 0)
+        {
+            view_desc_.specialization.push_back({ kDebugViewConstant, view });
         }
-        vkutil::ObjectData objectdata{ };
-        objectdata.model = model;
-        commandBuffer.pushConstants(pipeline_layout_, vk::ShaderStageFlagBits::eVertex, 0, sizeof(objectdata), &objectdata);
-        commandBuffer.draw(4, 1, 0, 0);
-        index++;
+        view_desc_view_ = view;
     }
-    commandBuffer.endRenderPass();
+    // without a compute queue of its own culling runs here, before the passes drawing with its results
+    if(!async_compute_->async())
+    {
+        uint32_t cullingScope = gpu_profiler_->begin_scope(commandBuffer, "culling");
+        async_compute_->record_inline(commandBuffer);
+        gpu_profiler_->end_scope(commandBuffer, cullingScope);
+    }
+    render_graph_->set_image(swapchain_image_, swap_chain_frames_[imageIndex].image, swap_chain_frames_[imageIndex].imageView);
+    render_graph_->execute(commandBuffer, gpu_profiler_);
+    recording_draws_ = nullptr;
+    recording_object_buffer_ = vkutil::BindlessTable::kInvalidIndex;
+    gpu_profiler_->end_scope(commandBuffer, frameScope);
     try
     {
         commandBuffer.end();
@@ -266,78 +824,452 @@ void Engine::RecordDrawCommands(vk::CommandBuffer commandBuffer, uint32_t imageI
         }
     }
 }
+
+/**
+ * @brief Writes the frame's bounding spheres and schedules the culling dispatch that turns them into draw commands.
+ *
+ * The frame's previous submission completed before recording started, so its buffers are free to
+ * overwrite, or to replace when the scene_ outgrew them.
+ */
+vk::Buffer Engine::ScheduleCulling(vkutil::FrameSync& frame, const SceneSnapshot& scene, const vkutil::CameraData& camera)
+{
+    uint32_t objectCount = static_cast<uint32_t>(scene.triangle_positions.size());
+    if(!culling_pipeline_ || !async_compute_->valid() || objectCount == 0)
+    {
+        return nullptr;
+    }
+    if(objectCount > frame.cullCapacity && !ResizeCullingBuffers(frame, objectCount))
+    {
+        return nullptr;
+    }
+    glm::vec4* spheres = static_cast<glm::vec4*>(frame.cullObjectsMapped);
+    for(uint32_t i = 0; i < objectCount; ++i)
+    {
+        spheres[i] = glm::vec4(scene.triangle_positions[i], kQuadRadius);
+    }
+    vk::DescriptorSet set = frame.descriptors->allocate(culling_set_layout_);
+    if(!set)
+    {
+        return nullptr;
+    }
+    vk::DescriptorBufferInfo objectsInfo(frame.cullObjects.buffer, 0, VK_WHOLE_SIZE);
+    vk::DescriptorBufferInfo drawsInfo(frame.cullDraws.buffer, 0, VK_WHOLE_SIZE);
+    std::array<vk::WriteDescriptorSet, 2> writes;
+    writes[0].dstSet = set;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = vk::DescriptorType::eStorageBuffer;
+    writes[0].pBufferInfo = &objectsInfo;
+    writes[1] = writes[0];
+    writes[1].dstBinding = 1;
+    writes[1].pBufferInfo = &drawsInfo;
+    device_.updateDescriptorSets(writes, nullptr);
+
+    vkutil::CullingData culling = { };
+    std::copy(std::begin(camera.frustum), std::end(camera.frustum), std::begin(culling.frustum));
+    culling.objectCount = objectCount;
+    culling.vertexCount = 4;
+    vk::PipelineLayout layout = culling_layout_;
+    vk::Pipeline pipeline = culling_pipeline_;
+    async_compute_->schedule(vk::PipelineStageFlagBits::eDrawIndirect, vk::AccessFlagBits::eIndirectCommandRead,
+                             [layout, pipeline, set, culling](vk::CommandBuffer commandBuffer)
+    {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout, 0, set, nullptr);
+        commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(culling), &culling);
+        // one invocation per object in groups of 64, the local size of cull.comp
+        commandBuffer.dispatch((culling.objectCount + 63) / 64, 1, 1);
+    });
+    return frame.cullDraws.buffer;
+}
+/**
+ * @brief Replaces a frame's culling buffers with ones holding at least the given number of objects.
+ *
+ * The draw commands are shared by the graphics and compute families when they differ, so neither
+ * queue has to transfer them to the other.
+ */
+bool Engine::ResizeCullingBuffers(vkutil::FrameSync& frame, uint32_t object_count)
+{
+    DestroyCullingBuffers(frame);
+    uint32_t capacity = std::max(object_count, 64u);
+    BufferInput input;
+    input.logical_device = device_;
+    input.physical_device = physical_device_;
+    try
+    {
+        input.size = sizeof(glm::vec4) * capacity;
+        input.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+        frame.cullObjects = vkutil::createBuffer(input);
+        frame.cullObjectsMapped = device_.mapMemory(frame.cullObjects.buffer_memory, 0, input.size);
+        input.size = sizeof(vk::DrawIndirectCommand) * capacity;
+        input.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
+        input.sharing_families = async_compute_->sharing_families();
+        frame.cullDraws = vkutil::createBuffer(input);
+    }
+    catch(std::exception &err)
+    {
+        std::cout << "Failed to create culling buffers: " << err.what() << "\n";
+        DestroyCullingBuffers(frame);
+        return false;
+    }
+    frame.cullCapacity = capacity;
+    return true;
+}
+void Engine::DestroyCullingBuffers(vkutil::FrameSync& frame)
+{
+    if(frame.cullObjectsMapped != nullptr)
+    {
+        device_.unmapMemory(frame.cullObjects.buffer_memory);
+    }
+    device_.destroyBuffer(frame.cullObjects.buffer);
+    device_.freeMemory(frame.cullObjects.buffer_memory);
+    device_.destroyBuffer(frame.cullDraws.buffer);
+    device_.freeMemory(frame.cullDraws.buffer_memory);
+    frame.cullObjects = { };
+    frame.cullObjectsMapped = nullptr;
+    frame.cullDraws = { };
+    frame.cullCapacity = 0;
+}
+/**
+ * @brief Computes the model matrix of every object and writes the objects for the frame's draws.
+ *
+ * Draws look their object up in a buffer of the bindless table by index. The frame's previous
+ * submission completed before recording started, so its buffer is free to overwrite. Without the
+ * table the objects are only kept for DrawScene to push.
+ */
+uint32_t Engine::WriteObjects(vkutil::FrameSync& frame, const SceneSnapshot& scene)
+{
+    recording_objects_.clear();
+    for(size_t i = 0; i < scene.triangle_positions.size(); ++i)
+    {
+        vkutil::ObjectData object = { };
+        object.model = glm::translate(glm::mat4(1.0f), scene.triangle_positions[i]);
+        if(i == 1)
+        {
+            object.model = glm::rotate(object.model, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        }
+        object.color = glm::vec4(1.0f);
+        recording_objects_.push_back(object);
+    }
+    uint32_t objectCount = static_cast<uint32_t>(recording_objects_.size());
+    if(!bindless_objects_ || objectCount == 0)
+    {
+        return vkutil::BindlessTable::kInvalidIndex;
+    }
+    if(objectCount > frame.objectCapacity && !ResizeObjectBuffer(frame, objectCount))
+    {
+        return vkutil::BindlessTable::kInvalidIndex;
+    }
+    std::copy(recording_objects_.begin(), recording_objects_.end(), static_cast<vkutil::ObjectData*>(frame.objectsMapped));
+    return frame.objectsIndex;
+}
+/**
+ * @brief Replaces a frame's object buffer with one holding at least the given number of objects.
+ *
+ * The old buffer's bindless slot is only reused once every frame submitted so far completed,
+ * the others bind the same table.
+ */
+bool Engine::ResizeObjectBuffer(vkutil::FrameSync& frame, uint32_t object_count)
+{
+    if(frame.objectsIndex != vkutil::BindlessTable::kInvalidIndex)
+    {
+        bindless_->remove_buffer(frame.objectsIndex, frame_timeline_->last_signaled());
+    }
+    DestroyObjectBuffer(frame);
+    uint32_t capacity = std::max(object_count, 64u);
+    BufferInput input;
+    input.logical_device = device_;
+    input.physical_device = physical_device_;
+    input.size = sizeof(vkutil::ObjectData) * capacity;
+    input.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+    try
+    {
+        frame.objects = vkutil::createBuffer(input);
+        frame.objectsMapped = device_.mapMemory(frame.objects.buffer_memory, 0, input.size);
+    }
+    catch(std::exception &err)
+    {
+        std::cout << "Failed to create an object buffer: " << err.what() << "\n";
+        DestroyObjectBuffer(frame);
+        return false;
+    }
+    frame.objectsIndex = bindless_->add_buffer(frame.objects.buffer);
+    if(frame.objectsIndex == vkutil::BindlessTable::kInvalidIndex)
+    {
+        DestroyObjectBuffer(frame);
+        return false;
+    }
+    frame.objectCapacity = capacity;
+    return true;
+}
+/**
+ * @brief Destroys a frame's object buffer. Its bindless slot, if any, must already be removed.
+ */
+void Engine::DestroyObjectBuffer(vkutil::FrameSync& frame)
+{
+    if(frame.objectsMapped != nullptr)
+    {
+        device_.unmapMemory(frame.objects.buffer_memory);
+    }
+    device_.destroyBuffer(frame.objects.buffer);
+    device_.freeMemory(frame.objects.buffer_memory);
+    frame.objects = { };
+    frame.objectsMapped = nullptr;
+    frame.objectCapacity = 0;
+    frame.objectsIndex = vkutil::BindlessTable::kInvalidIndex;
+}
+
+/**
+ * @brief Draws the scene_ being recorded, called by the render graph inside its passes.
+ *
+ * Binds the camera and bindless sets and the graphics pipeline_, the base pipeline_ specialized for
+ * the debug view. It is looked up without blocking, if it is still compiling the fallback, the
+ * base pipeline_, is bound instead, or the draws are skipped when there is none. The depth pre-pass pipeline_ is built with the others up front and
+ * has no fallback, since the fallback renders to a color attachment the pre-pass lacks. Objects
+ * are drawn through the draw commands culling wrote for the frame when there are any, each draw
+ * pushing the bindless ID of the frame's object buffer and its object's index.
+ *
+ * @param commandBuffer The command buffer the render graph is recording.
+ * @param depth_only Whether this is the depth pre-pass.
+ */
+void Engine::DrawScene(vk::CommandBuffer commandBuffer, bool depth_only)
+{
+    vk::Viewport viewport = { };
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(swapchain_extent_.width);
+    viewport.height = static_cast<float>(swapchain_extent_.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    commandBuffer.setViewport(0, viewport);
+    vk::Rect2D scissor = { };
+    scissor.offset.x = 0;
+    scissor.offset.y = 0;
+    scissor.extent = swapchain_extent_;
+    commandBuffer.setScissor(0, scissor);
+
+    if(camera_set_)
+    {
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout_, kCameraSet, camera_set_, camera_offset_);
+    }
+    // every pipeline_ layout reserves the bindless set, so one bind lasts the whole pass
+    if(bindless_ != nullptr && bindless_->valid())
+    {
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline_layout_, vkutil::BindlessTable::kSet,
+                                         bindless_->set(), nullptr);
+    }
+    // the shaders read the objects from the table, without the frame's buffer there is nothing to draw
+    if(bindless_objects_ && recording_object_buffer_ == vkutil::BindlessTable::kInvalidIndex)
+    {
+        return;
+    }
+    vk::Pipeline pipeline = depth_only ? pipeline_states_->find(depth_prepass_desc_) : pipeline_states_->get_async(view_desc_);
+    if(pipeline)
+    {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+        PrepareScene(commandBuffer);
+        uint32_t index = 0;
+        for(const vkutil::ObjectData& object : recording_objects_)
+        {
+            if(bindless_objects_)
+            {
+                vkutil::DrawIds ids = { recording_object_buffer_, index };
+                commandBuffer.pushConstants(pipeline_layout_, draw_push_stages_, 0, sizeof(ids), &ids);
+            }
+            else
+            {
+                commandBuffer.pushConstants(pipeline_layout_, draw_push_stages_, 0, sizeof(object.model), &object.model);
+            }
+            if(recording_draws_)
+            {
+                // culled objects draw no instances
+                vk::DeviceSize offset = sizeof(vk::DrawIndirectCommand) * static_cast<vk::DeviceSize>(index);
+                commandBuffer.drawIndirect(recording_draws_, offset, 1, sizeof(vk::DrawIndirectCommand));
+            }
+            else
+            {
+                commandBuffer.draw(4, 1, 0, 0);
+            }
+            index++;
+        }
+    }
+}
 /**
  * @brief Renders a frame.
  *
  * Handles the rendering of a single frame. This involves acquiring an image from the
- * swap chain, recording drawing commands, submitting the command buffer to the graphics
- * queue, and presenting the rendered image to the screen.
+ * swap chain, recording drawing commands, submitting the frame's compute jobs to the compute
+ * queue and the command buffer to the graphics queue, and presenting the rendered image to the screen. Headless, the frame in flight renders
+ * into its own offscreen image, which the timeline wait already made free, and nothing is acquired
+ * or presented.
  *
- * @param scene Pointer to the scene_ to be rendered.
+ * @param scene The snapshot of the scene_ to be rendered.
  */
-void Engine::render(Scene* scene)
+void Engine::render(const SceneSnapshot& scene)
 {
-    vk::Result waitResult = device_.waitForFences(1, &swap_chain_frames_[static_cast<size_t>(frame_number_)].inFlight, VK_TRUE, UINT64_MAX);
-    if (waitResult != vk::Result::eSuccess)
+    deletion_queue_.flush(*frame_timeline_);
+    present_tracker_->collect(*frame_timeline_);
+    if(bindless_ != nullptr)
     {
-        std::cerr << "Error: Failed to wait for fence. Result: " << waitResult << std::endl;
-        return;
+        bindless_->collect(*frame_timeline_);
     }
-    uint32_t imageIndex;
-    try
+    ApplyPipelineUpdates();
+    if(resize_requested_.exchange(false))
     {
-        vk::ResultValue acquire = device_.acquireNextImageKHR
-        (
-                swapchain_,
-                UINT64_MAX,
-                swap_chain_frames_[static_cast<size_t>(frame_number_)].imageAvailable,
-                nullptr
-        );
-        imageIndex = acquire.value;
+        RequestSwapchainRecreation();
     }
-    catch(vk::OutOfDateKHRError &error)
+    if(swapchain_dirty_ && !RecreateSwapchain())
     {
-        std::cout << "Recreate" << std::endl;
-        RecreateSwapchain();
+        // a 0x0 framebuffer isn't always an iconified window_, wait for a new size instead of spinning
+        WaitForResize();
         return;
     }
-    vk::CommandBuffer commandBuffer = swap_chain_frames_[imageIndex].commandbuffer;
+    // every stage is timed from the end of the one before it
+    std::chrono::steady_clock::time_point lap = std::chrono::steady_clock::now();
+    auto stage = [&lap](double& total)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        total += std::chrono::duration<double, std::milli>(now - lap).count();
+        lap = now;
+    };
+    frame_pacer_->begin_frame(device_, swapchain_, *frame_timeline_, dldi_);
+    stage(stage_times_.paceMs);
+    vkutil::FrameSync& frame = frames_[static_cast<size_t>(frame_number_)];
+    if(!frame_timeline_->wait(frame.timelineValue))
+    {
+        std::cerr << "Error: Failed to wait for frame timeline value " << frame.timelineValue << std::endl;
+        return;
+    }
+    stage(stage_times_.waitMs);
+    frame.descriptors->reset();
+    if(readback_ != nullptr)
+    {
+        readback_->collect(*frame_timeline_);
+    }
+    stage(stage_times_.readbackMs);
+    uint32_t imageIndex = static_cast<uint32_t>(frame_number_);
+    if(!headless_)
+    {
+        try
+        {
+            vk::ResultValue acquire = device_.acquireNextImageKHR
+            (
+                    swapchain_,
+                    UINT64_MAX,
+                    frame.imageAvailable,
+                    nullptr
+            );
+            imageIndex = acquire.value;
+            if(acquire.result == vk::Result::eSuboptimalKHR)
+            {
+                RequestSwapchainRecreation();
+            }
+        }
+        catch(vk::OutOfDateKHRError &error)
+        {
+            RequestSwapchainRecreation();
+            return;
+        }
+    }
+    stage(stage_times_.acquireMs);
+    vk::CommandBuffer commandBuffer = frame.commandbuffer;
     commandBuffer.reset();
     RecordDrawCommands(commandBuffer, imageIndex, scene);
+    stage(stage_times_.recordMs);
+
+    // compute goes first, the graphics work only waits for it where it draws with the results
+    vkutil::ComputeHandoff compute = async_compute_->submit(static_cast<uint32_t>(frame_number_));
+    uint64_t signalValue = frame_timeline_->advance();
     vk::SubmitInfo submitInfo = { };
-    vk::Semaphore waitSemaphores[] = { swap_chain_frames_[static_cast<size_t>(frame_number_)].imageAvailable };
-    vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-    submitInfo.waitSemaphoreCount = 1;
+    // binary semaphores ignore their entry in the value arrays
+    vk::Semaphore waitSemaphores[2];
+    vk::PipelineStageFlags waitStages[2];
+    uint64_t waitValues[2] = { 0, 0 };
+    uint32_t waitCount = 0;
+    if(!headless_)
+    {
+        waitSemaphores[waitCount] = frame.imageAvailable;
+        waitStages[waitCount] = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        waitCount++;
+    }
+    if(compute.value != 0)
+    {
+        waitSemaphores[waitCount] = compute.semaphore;
+        waitStages[waitCount] = compute.stages;
+        waitValues[waitCount] = compute.value;
+        waitCount++;
+    }
+    submitInfo.waitSemaphoreCount = waitCount;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
-    vk::Semaphore signalSemaphores[] = { swap_chain_frames_[static_cast<size_t>(frame_number_)].renderFinished };
-    submitInfo.signalSemaphoreCount = 1;
+    // present semaphores belong to the image, an acquired image is never still being presented
+    vk::Semaphore signalSemaphores[] = { swap_chain_frames_[imageIndex].renderFinished, frame_timeline_->semaphore() };
+    submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores = signalSemaphores;
-    vk::Result resetResult = device_.resetFences(1, &swap_chain_frames_[static_cast<size_t>(frame_number_)].inFlight);
-    if (resetResult != vk::Result::eSuccess)
+    uint64_t signalValues[] = { 0, signalValue };
+    vk::TimelineSemaphoreSubmitInfo timelineInfo = { };
+    timelineInfo.waitSemaphoreValueCount = waitCount;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 2;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    if(headless_)
     {
-        std::cerr << "Error: Failed to reset fences. Result: " << resetResult << std::endl;
+        // nothing was acquired and nothing will be presented, only the timeline is signaled
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &signalSemaphores[1];
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &signalValues[1];
     }
+    submitInfo.pNext = &timelineInfo;
     try
     {
-        graphics_queue_.submit(submitInfo, swap_chain_frames_[static_cast<size_t>(frame_number_)].inFlight);
+        graphics_queue_.submit(submitInfo, nullptr);
     }
     catch(vk::SystemError &err)
     {
-        if(debug_mode_)
-        {
-            std::cout << "Failed to submit draw command buffer" << std::endl;
-        }
+        std::cerr << "Error: Failed to submit draw command buffer: " << err.what() << std::endl;
+        AbandonFrame(frame, signalValue);
+        return;
+    }
+    frame.timelineValue = signalValue;
+    if(readback_ != nullptr)
+    {
+        readback_->submitted(signalValue);
+    }
+    frame_number_ = (frame_number_ + 1) % max_frames_in_flight_;
+    uint64_t presentId = frame_pacer_->on_submit(signalValue);
+    stage(stage_times_.submitMs);
+    ++stage_times_.frames;
+    if(headless_)
+    {
+        return;
     }
+
     vk::PresentInfoKHR presentInfo = { };
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &swap_chain_frames_[imageIndex].renderFinished;
     vk::SwapchainKHR swapchains[] = {swapchain_ };
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapchains;
     presentInfo.pImageIndices = &imageIndex;
+    vk::PresentIdKHR presentIdInfo = { };
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &presentId;
+    if(frame_pacer_->uses_present_wait())
+    {
+        presentInfo.pNext = &presentIdInfo;
+    }
+    vk::Fence presentFence = present_tracker_->next_fence();
+    vk::SwapchainPresentFenceInfoEXT presentFenceInfo = { };
+    presentFenceInfo.swapchainCount = 1;
+    presentFenceInfo.pFences = &presentFence;
+    if(presentFence)
+    {
+        presentFenceInfo.pNext = presentInfo.pNext;
+        presentInfo.pNext = &presentFenceInfo;
+    }
     vk::Result present;
     try
     {
@@ -347,26 +1279,79 @@ void Engine::render(Scene* scene)
     {
         present = vk::Result::eErrorOutOfDateKHR;
     }
+    // rejected as out of date, the present is still queued and still waits on its semaphore
+    present_tracker_->presented(imageIndex, presentFence);
+    stage(stage_times_.presentMs);
     if(present == vk::Result::eErrorOutOfDateKHR || present == vk::Result::eSuboptimalKHR)
     {
-        std::cout << "Recreate" << std::endl;
-        RecreateSwapchain();
-        return;
+        RequestSwapchainRecreation();
     }
-    frame_number_ = (frame_number_ + 1) % max_frames_in_flight_;
+    else if(report_resize_)
+    {
+        report_resize_ = false;
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - resize_requested_at_).count();
+        std::cout << "Swapchain recreated at " << swapchain_extent_.width << "x" << swapchain_extent_.height
+                  << " in " << last_recreate_ms_ << " ms, first frame presented " << latency << " ms after the resize\n";
+    }
+}
+/**
+ * @brief Settles a frame whose submission failed, so nothing waits forever on what it would have signaled.
+ *
+ * The reserved timeline value is signaled by an empty submission, which also consumes the acquire
+ * semaphore, or from the host when even that fails. The frame is neither presented, read back nor timed,
+ * and the swap chain is recreated to hand back the image that was acquired for it.
+ */
+void Engine::AbandonFrame(vkutil::FrameSync& frame, uint64_t signal_value)
+{
+    vk::Semaphore timeline = frame_timeline_->semaphore();
+    vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+    vk::TimelineSemaphoreSubmitInfo timelineInfo = { };
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signal_value;
+    vk::SubmitInfo submitInfo = { };
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &timeline;
+    submitInfo.pNext = &timelineInfo;
+    if(!headless_)
+    {
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &frame.imageAvailable;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        RequestSwapchainRecreation();
+    }
+    try
+    {
+        graphics_queue_.submit(submitInfo, nullptr);
+    }
+    catch(vk::SystemError &err)
+    {
+        frame_timeline_->signal(signal_value);
+    }
+    frame.timelineValue = signal_value;
+    if(readback_ != nullptr)
+    {
+        readback_->abandon();
+    }
+    // the frame's queries were never reset nor written
+    gpu_profiler_->abandon_frame(static_cast<uint32_t>(frame_number_));
 }
 void Engine::CleanupSwapchain()
 {
-    for(vkutil::SwapChainFrame frame : swap_chain_frames_)
+    RetireSwapchain(swapchain_, swap_chain_frames_);
+    present_tracker_->flush_all();
+    deletion_queue_.flush_all();
+    for(vk::Semaphore semaphore : recycled_semaphores_)
+    {
+        device_.destroySemaphore(semaphore);
+    }
+    recycled_semaphores_.clear();
+    for(vkutil::FrameSync& frame : frames_)
     {
-        device_.destroyImageView(frame.imageView);
-        device_.destroyFramebuffer(frame.framebuffer);
-        device_.destroyFence(frame.inFlight);
         device_.destroySemaphore(frame.imageAvailable);
-        device_.destroySemaphore(frame.renderFinished);
+        delete frame.descriptors;
+        DestroyCullingBuffers(frame);
+        DestroyObjectBuffer(frame);
     }
-
-    device_.destroySwapchainKHR(swapchain_);
 }
 
 /**
@@ -386,14 +1371,38 @@ Engine::~Engine()
 //    device_.destroySemaphore(renderFinished);
 //
     device_.destroyCommandPool(command_pool_);
-    device_.destroyPipeline(pipeline_);
-    device_.destroyPipelineLayout(pipeline_layout_);
-    device_.destroyRenderPass(render_pass_);
+    delete async_compute_;
+    device_.destroyPipeline(culling_pipeline_);
+    device_.destroyPipelineLayout(culling_layout_);
+    delete shader_watcher_;
+    delete pipeline_states_;
+    vkutil::set_shader_compiler(nullptr);
+    delete shader_compiler_;
+    delete bindless_;
+    delete camera_buffer_;
+    delete descriptor_allocator_;
+    delete layout_cache_;
+    delete render_graph_;
+    // every frame completed with the wait for idle, the profiler reads the last of them
+    delete gpu_profiler_;
+    if(readback_ != nullptr)
+    {
+        readback_->drain(*frame_timeline_);
+    }
+    delete readback_;
+    pipeline_cache_->save();
+    delete pipeline_cache_;
     CleanupSwapchain();
+    delete present_tracker_;
+    delete frame_timeline_;
+    delete frame_pacer_;
 //    delete triangle_mesh_;
     delete quad_mesh_;
     device_.destroy();
-    instance_.destroySurfaceKHR(surface_);
+    if(surface_)
+    {
+        instance_.destroySurfaceKHR(surface_);
+    }
     if(debug_mode_)
     {
         instance_.destroyDebugUtilsMessengerEXT(debug_messenger_, nullptr, dldi_);
@@ -9,6 +9,25 @@
 #include <GLFW/glfw3.h>
 #include "frame.hpp"
 #include "scene.hpp"
+#include "timeline.hpp"
+#include "deletion_queue.hpp"
+#include "present_tracker.hpp"
+#include "frame_pacing.hpp"
+#include "pipeline_cache.hpp"
+#include "pipeline_state_cache.hpp"
+#include "shader_compiler.hpp"
+#include "shader_watcher.hpp"
+#include "device.hpp"
+#include "uniform_buffer.hpp"
+#include "render_graph.hpp"
+#include "render_settings.hpp"
+#include "readback.hpp"
+#include "async_compute.hpp"
+#include "gpu_profiler.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include "triangle_mesh.hpp"
 #include "quad_mesh.hpp"
 /**
@@ -17,7 +36,8 @@
  *
  * This class is responsible for setting up and managing Vulkan resources such as the instance_, device_,
  * swap chain, graphics pipeline_, and command buffers. It integrates with GLFW for window_ management and
- * provides functionality for rendering scenes.
+ * provides functionality for rendering scenes. Headless, it renders into offscreen images of its own
+ * instead, with the same draw code and without a window_, surface_ or swap chain.
  */
 class Engine
 {
@@ -26,19 +46,74 @@ public:
      * @brief Constructs an Engine object.
      * @param width The width_ of the rendering window_.
      * @param height The height_ of the rendering window_.
-     * @param window Pointer to the GLFWwindow to be used for rendering.
+     * @param window Pointer to the GLFWwindow to be used for rendering, or nullptr when rendering headless.
      * @param debug Indicates whether to enable debug mode.
+     * @param pacing Present mode, swap chain image count, frames in flight and frame rate limit.
+     * @param render The passes a frame is made of.
      */
-    Engine(int width, int height, GLFWwindow* window, bool debug);
+    Engine(int width, int height, GLFWwindow* window, bool debug, const vkutil::FramePacingSettings& pacing = vkutil::FramePacingSettings(),
+           const vkutil::RenderSettings& render = vkutil::RenderSettings());
     /**
      * @brief Destructor that cleans up Vulkan and GLFW resources.
      */
     ~Engine();
     /**
-     * @brief Renders a given scene_.
-     * @param scene Pointer to the scene_ object to be rendered.
+     * @brief Renders a snapshot of the scene_.
+     * @param scene The snapshot to be rendered, left untouched.
      */
-    void render(Scene* scene);
+    void render(const SceneSnapshot& scene);
+    /**
+     * @brief Flags the swap chain for recreation before the next frame is rendered.
+     *
+     * Called when the window_'s framebuffer changes size, since not every platform reports
+     * a resize through an out of date swap chain. Safe to call from a thread other than the
+     * one rendering; the size is picked up at the start of the next frame.
+     *
+     * @param width The new framebuffer width.
+     * @param height The new framebuffer height.
+     */
+    void resize(int width, int height);
+    /**
+     * @brief Switches to the next debug view of the scene_. Safe to call from any thread.
+     *
+     * A view is a specialization of the base pipeline_ that isn't built up front: the first frame
+     * drawing it requests it without blocking, so it is fast linked from library parts or compiled
+     * in the background, with the base pipeline_ drawn until it is ready.
+     */
+    void cycle_debug_view();
+    /**
+     * @brief Smoothed CPU submit to present latency, in milliseconds.
+     *
+     * Falls back to submit to GPU completion when the device_ lacks VK_KHR_present_wait.
+     */
+    [[nodiscard]] double present_latency_ms() const;
+    /**
+     * @brief Queue depth and time to ready of pipelines compiled in the background.
+     */
+    [[nodiscard]] vkutil::PipelineCompileStats pipeline_compile_stats() const;
+    /**
+     * @brief CPU time spent in each stage of render(), summed over every frame submitted so far.
+     *
+     * Only safe to call from the thread rendering.
+     */
+    [[nodiscard]] vkutil::FrameStageTimes stage_times() const;
+    /**
+     * @brief GPU time of the frame and of each of its passes, read back from timestamps a few frames late.
+     *
+     * Empty when the graphics queue can't write timestamps. Only safe to call from the thread rendering.
+     */
+    [[nodiscard]] const std::vector<vkutil::GpuScopeTime>& gpu_times() const;
+    /**
+     * @brief Reads every rendered frame back to the CPU and hands it to a callback a few frames later.
+     *
+     * The copy is recorded at the end of the frame into a ring of host visible buffers, one more
+     * than there are frames in flight, and delivered from render() once the frame timeline says it
+     * finished, so the render loop never waits for it. The callback runs on the thread rendering.
+     * Not thread safe, call before rendering starts or from the thread rendering.
+     *
+     * @param callback Receives the frames, or nullptr to stop reading them back.
+     */
+    void set_frame_callback(vkutil::ReadbackCallback callback);
 
 private:
     // whether to print debug messages in functions
@@ -47,6 +122,8 @@ private:
     int width_;
     int height_;
     GLFWwindow* window_;
+    // render into offscreen images without a window_, surface_ or swap chain
+    bool headless_;
 
     //instance_ related variables
     vk::Instance instance_{ nullptr };
@@ -56,18 +133,85 @@ private:
 
     //device_-related variables
     vk::PhysicalDevice physical_device_ {nullptr };
+    // queried once while choosing the device_, setup reads it instead of the driver
+    vkinit::DeviceCapabilities device_capabilities_;
     vk::Device device_ { nullptr };
+    vkinit::OptionalDeviceFeatures optional_features_;
     vk::Queue graphics_queue_ { nullptr };
     vk::Queue present_queue_ { nullptr};
+    // the graphics queue too on devices without families dedicated to them
+    vk::Queue compute_queue_ { nullptr };
+    vk::Queue transfer_queue_ { nullptr };
+    vkutil::QueueFamilyIndices queue_families_;
     vk::SwapchainKHR swapchain_ { nullptr };
     std::vector<vkutil::SwapChainFrame> swap_chain_frames_;
     vk::Format swapchain_format_;
     vk::Extent2D swapchain_extent_;
+    vk::ImageUsageFlags swapchain_usage_;
+    vk::Format depth_format_;
+    vk::SampleCountFlagBits samples_;
+    bool swapchain_dirty_;
+    std::atomic<bool> resize_requested_;
+    // signaled by resize(), the thread rendering waits on it while the framebuffer is 0x0
+    std::mutex resize_mutex_;
+    std::condition_variable resize_signal_;
+    std::atomic<int> framebuffer_width_;
+    std::atomic<int> framebuffer_height_;
+    bool report_resize_;
+    std::chrono::steady_clock::time_point resize_requested_at_;
+    double last_recreate_ms_;
 
     //pipeline_-related variables
+    vkutil::LayoutCache* layout_cache_;
     vk::PipelineLayout pipeline_layout_;
-    vk::RenderPass render_pass_;
-    vk::Pipeline pipeline_;
+    vkinit::PipelineDesc pipeline_desc_;
+    vkinit::PipelineDesc depth_prepass_desc_;
+    // the base pipeline_ specialized for the debug view, which DrawScene requests each frame
+    static constexpr uint32_t kDebugViewConstant = 0;
+    static constexpr uint32_t kDebugViewCount = 2;
+    std::atomic<uint32_t> debug_view_;
+    uint32_t view_desc_view_;
+    vkinit::PipelineDesc view_desc_;
+    vkutil::PipelineCache* pipeline_cache_;
+    vkutil::PipelineStateCache* pipeline_states_;
+    vkutil::ShaderCompiler* shader_compiler_;
+    vkutil::ShaderWatcher* shader_watcher_;
+
+    //descriptor-related variables
+    // set 0 of every pipeline_ layout holds the camera, see shaders/camera.glsl
+    static constexpr uint32_t kCameraSet = 0;
+    vkutil::BindlessTable* bindless_;
+    vkutil::DescriptorAllocator* descriptor_allocator_;
+    vkutil::FrameUniformBuffer* camera_buffer_;
+    vk::DescriptorSet camera_set_;
+    uint32_t camera_offset_;
+    // whether draws find their object in the bindless table, see shaders/object.glsl
+    bool bindless_objects_;
+    // the stages the pipeline_ layout's push constants are visible to
+    vk::ShaderStageFlags draw_push_stages_;
+
+    //render graph-related variables
+    vkutil::RenderSettings render_settings_;
+    vkutil::RenderGraph* render_graph_;
+    vkutil::RenderGraphImage swapchain_image_;
+    // the objects of the snapshot RecordDrawCommands is recording, read by the graph's pass callbacks,
+    // and the bindless index of the buffer they were written to
+    std::vector<vkutil::ObjectData> recording_objects_;
+    uint32_t recording_object_buffer_;
+
+    //culling-related variables
+    // the quad's corners are half a unit from its center along both axes
+    static constexpr float kQuadRadius = 0.70711f;
+    vkutil::AsyncCompute* async_compute_;
+    vk::DescriptorSetLayout culling_set_layout_;
+    vk::PipelineLayout culling_layout_;
+    vk::Pipeline culling_pipeline_;
+    // the draw commands culling writes for the frame being recorded, null to draw everything
+    vk::Buffer recording_draws_;
+
+    //readback-related variables
+    vkutil::ReadbackCallback frame_callback_;
+    vkutil::ReadbackRing* readback_;
 
     //command-related variables
     vk::CommandPool command_pool_;
@@ -76,6 +220,16 @@ private:
     //synchronization objects
     int max_frames_in_flight_;
     int frame_number_;
+    std::vector<vkutil::FrameSync> frames_;
+    vkutil::Timeline* frame_timeline_;
+    vkutil::FramePacingSettings pacing_settings_;
+    vkutil::FramePacer* frame_pacer_;
+    vkutil::FrameStageTimes stage_times_;
+    vkutil::GpuProfiler* gpu_profiler_;
+    vkutil::DeletionQueue deletion_queue_;
+    // swap chains are only released once the presentation engine is done with them
+    vkutil::PresentTracker* present_tracker_;
+    std::vector<vk::Semaphore> recycled_semaphores_;
 
     //asset pointers
     TriangleMesh* triangle_mesh_;
@@ -86,16 +240,28 @@ private:
 
     //device_ setup
     void MakeDevice();
-    void MakeSwapchain();
-    void RecreateSwapchain();
+    void MakeSwapchain(vk::SwapchainKHR old_swapchain);
+    bool RecreateSwapchain();
+    void RequestSwapchainRecreation();
+    void RetireSwapchain(vk::SwapchainKHR swapchain, const std::vector<vkutil::SwapChainFrame>& frames);
+
+    //descriptor setup
+    void MakeDescriptors();
 
     //pipeline_ setup
+    void MakePipelineCache();
     void MakePipeline();
+    void MakeShaderCompiler();
+    void MakeShaderWatcher();
+    void ApplyPipelineUpdates();
 
     //final setup steps
     void FinalizeSetup();
-    void MakeFramebuffers();
+    void MakeRenderGraph();
     void MakeFrameSyncObjects();
+    void MakeGpuProfiler();
+    void MakeCulling();
+    void MakeSwapchainSyncObjects();
 
     void MakeAssets();
     void PrepareScene(vk::CommandBuffer commandBuffer);
@@ -103,9 +269,31 @@ private:
      * @brief Records draw commands for the given scene_ into a Vulkan command buffer.
      * @param commandBuffer The command buffer to record into.
      * @param imageIndex The index of the image in the swap chain to draw to.
-     * @param scene Pointer to the scene_ to be drawn.
+     * @param scene The snapshot of the scene_ to be drawn.
+     */
+    void RecordDrawCommands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, const SceneSnapshot& scene);
+    /**
+     * @brief Schedules culling the scene_'s objects against the camera on the async compute queue.
+     * @param frame The frame in flight being recorded, whose culling buffers are written.
+     * @param scene The snapshot of the scene_ being recorded.
+     * @param camera The camera data of the frame.
+     * @return The buffer of draw commands culling writes, or a null handle to draw without culling.
+     */
+    vk::Buffer ScheduleCulling(vkutil::FrameSync& frame, const SceneSnapshot& scene, const vkutil::CameraData& camera);
+    bool ResizeCullingBuffers(vkutil::FrameSync& frame, uint32_t object_count);
+    void DestroyCullingBuffers(vkutil::FrameSync& frame);
+    /**
+     * @brief Computes the scene_'s objects and writes them to the frame's object buffer.
+     * @param frame The frame in flight being recorded, whose object buffer is written.
+     * @param scene The snapshot of the scene_ being recorded.
+     * @return The bindless index of the buffer, or kInvalidIndex when draws don't read objects from the table.
      */
-    void RecordDrawCommands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene);
+    uint32_t WriteObjects(vkutil::FrameSync& frame, const SceneSnapshot& scene);
+    bool ResizeObjectBuffer(vkutil::FrameSync& frame, uint32_t object_count);
+    void DestroyObjectBuffer(vkutil::FrameSync& frame);
+    void DrawScene(vk::CommandBuffer commandBuffer, bool depth_only);
+    void AbandonFrame(vkutil::FrameSync& frame, uint64_t signal_value);
+    void WaitForResize();
     void CleanupSwapchain();
 };
 
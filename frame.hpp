@@ -6,6 +6,8 @@
 #ifndef INC_3DLOADERVK_FRAME_HPP
 #define INC_3DLOADERVK_FRAME_HPP
 #include <vulkan/vulkan.hpp>
+#include "config.hpp"
+#include "descriptors.hpp"
 /**
  * @namespace vkutil
  * @brief Contains utility structures and functions for Vulkan.
@@ -17,21 +19,44 @@ namespace vkutil
 {
     /**
      * @struct SwapChainFrame
-     * @brief Holds the components necessary for a single frame in a Vulkan swap chain.
+     * @brief Holds the components necessary for a single image in a Vulkan swap chain.
      *
-     * This structure includes an image, an image view, a framebuffer, command buffer,
-     * and synchronization objects for a frame. These components are essential for rendering
-     * and presenting each frame in a Vulkan application.
+     * This structure includes an image, an image view and the semaphore that the presentation of
+     * this image waits on. These objects live and die with the swap chain. Headless, the frames are
+     * offscreen images the engine created itself, which also own their memory.
      */
     struct SwapChainFrame
     {
         vk::Image image;
         vk::ImageView imageView;
-        vk::Framebuffer framebuffer;
+        vk::Semaphore renderFinished;
+        vk::DeviceMemory memory;
+    };
+    /**
+     * @struct FrameSync
+     * @brief Holds the per frame in flight command buffer and synchronization objects.
+     *
+     * Frames in flight are independent of the swap chain images, so they survive swap chain
+     * recreation untouched. Instead of a fence, a frame remembers the frame timeline value
+     * signaled by the last submission that used it. Descriptor sets the frame writes while
+     * recording come from its own allocator, reset once that value is reached. So do the bounding
+     * spheres the frame culls, the draw commands culling writes and the objects the frame draws,
+     * which grow with the scene_. The object buffer has a slot of the bindless table, objectsIndex.
+     */
+    struct FrameSync
+    {
         vk::CommandBuffer commandbuffer;
         vk::Semaphore imageAvailable;
-        vk::Semaphore renderFinished;
-        vk::Fence inFlight;
+        uint64_t timelineValue = 0;
+        DescriptorAllocator* descriptors = nullptr;
+        Buffer cullObjects;
+        void* cullObjectsMapped = nullptr;
+        Buffer cullDraws;
+        uint32_t cullCapacity = 0;
+        Buffer objects;
+        void* objectsMapped = nullptr;
+        uint32_t objectCapacity = 0;
+        uint32_t objectsIndex = BindlessTable::kInvalidIndex;
     };
 }
 
@@ -0,0 +1,217 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "frame_dump.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+namespace vkutil
+{
+    FrameDump::FrameDump(const std::string& path, FrameDumpFormat format, uint32_t fps, bool debug)
+    {
+        format_ = format;
+        fps_ = std::max(fps, 1u);
+        debug_ = debug;
+        written_ = 0;
+        skipped_ = 0;
+        stopping_ = false;
+        pipe_ = !path.empty() && path.front() == '|';
+        if(pipe_)
+        {
+#ifdef _WIN32
+            file_ = _popen(path.c_str() + 1, "wb");
+#else
+            file_ = popen(path.c_str() + 1, "w");
+#endif
+        }
+        else
+        {
+            file_ = std::fopen(path.c_str(), "wb");
+        }
+        if(file_ == nullptr)
+        {
+            std::cout << "Failed to open " << path << " to dump frames to\n";
+            return;
+        }
+        if(debug)
+        {
+            std::cout << "Dumping " << (format == FrameDumpFormat::eY4M ? "Y4M" : "raw") << " frames to " << path << "\n";
+        }
+        writer_ = std::thread(&FrameDump::WriterLoop, this);
+    }
+
+    FrameDump::~FrameDump()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        queued_.notify_one();
+        if(writer_.joinable())
+        {
+            writer_.join();
+        }
+        if(file_ != nullptr && pipe_)
+        {
+            // waits for the command to finish reading
+#ifdef _WIN32
+            _pclose(file_);
+#else
+            pclose(file_);
+#endif
+        }
+        else if(file_ != nullptr)
+        {
+            std::fclose(file_);
+        }
+        if(debug_)
+        {
+            std::cout << "Dumped " << written_ << " frames";
+            if(skipped_ > 0)
+            {
+                std::cout << ", skipped " << skipped_ << " of another size";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    bool FrameDump::valid() const
+    {
+        return file_ != nullptr;
+    }
+
+    FrameDumpFormat FrameDump::FormatFor(const std::string& path)
+    {
+        std::string extension = std::filesystem::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+        {
+            return static_cast<char>(std::tolower(c));
+        });
+        return extension == ".y4m" ? FrameDumpFormat::eY4M : FrameDumpFormat::eRaw;
+    }
+
+    void FrameDump::write(const ReadbackFrame& frame)
+    {
+        if(file_ == nullptr)
+        {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        drained_.wait(lock, [this]()
+        {
+            return queue_.size() < kMaxQueued;
+        });
+        QueuedFrame queued;
+        if(!free_.empty())
+        {
+            queued = std::move(free_.back());
+            free_.pop_back();
+        }
+        queued.extent = frame.extent;
+        queued.format = frame.format;
+        queued.pixels.assign(frame.pixels, frame.pixels + frame.size);
+        queue_.push_back(std::move(queued));
+        lock.unlock();
+        queued_.notify_one();
+    }
+
+    void FrameDump::WriterLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(true)
+        {
+            queued_.wait(lock, [this]()
+            {
+                return stopping_ || !queue_.empty();
+            });
+            if(queue_.empty())
+            {
+                return;
+            }
+            QueuedFrame frame = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            if(format_ == FrameDumpFormat::eY4M)
+            {
+                WriteY4M(frame);
+            }
+            else
+            {
+                std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), file_);
+                ++written_;
+            }
+            lock.lock();
+            free_.push_back(std::move(frame));
+            drained_.notify_one();
+        }
+    }
+
+    void FrameDump::WriteY4M(const QueuedFrame& frame)
+    {
+        if(written_ + skipped_ == 0)
+        {
+            stream_extent_ = frame.extent;
+            // C420jpeg places chroma between the four texels it was averaged from
+            std::fprintf(file_, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", frame.extent.width, frame.extent.height, fps_);
+        }
+        if(frame.extent != stream_extent_)
+        {
+            ++skipped_;
+            return;
+        }
+        bool bgra = frame.format == vk::Format::eB8G8R8A8Unorm || frame.format == vk::Format::eB8G8R8A8Srgb;
+        size_t red = bgra ? 2 : 0;
+        size_t blue = bgra ? 0 : 2;
+        size_t width = frame.extent.width;
+        size_t height = frame.extent.height;
+        size_t chromaWidth = (width + 1) / 2;
+        size_t chromaHeight = (height + 1) / 2;
+        planes_.resize(width * height + 2 * chromaWidth * chromaHeight);
+        uint8_t* luma = planes_.data();
+        uint8_t* cb = luma + width * height;
+        uint8_t* cr = cb + chromaWidth * chromaHeight;
+        const std::byte* pixels = frame.pixels.data();
+
+        // BT.601 limited range in 8 bit fixed point
+        for(size_t i = 0; i < width * height; ++i)
+        {
+            int r = std::to_integer<int>(pixels[i * 4 + red]);
+            int g = std::to_integer<int>(pixels[i * 4 + 1]);
+            int b = std::to_integer<int>(pixels[i * 4 + blue]);
+            luma[i] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+        for(size_t cy = 0; cy < chromaHeight; ++cy)
+        {
+            for(size_t cx = 0; cx < chromaWidth; ++cx)
+            {
+                // average the 2x2 block, clamped at odd right and bottom edges
+                int r = 0;
+                int g = 0;
+                int b = 0;
+                for(size_t dy = 0; dy < 2; ++dy)
+                {
+                    for(size_t dx = 0; dx < 2; ++dx)
+                    {
+                        size_t x = std::min(cx * 2 + dx, width - 1);
+                        size_t y = std::min(cy * 2 + dy, height - 1);
+                        const std::byte* texel = pixels + (y * width + x) * 4;
+                        r += std::to_integer<int>(texel[red]);
+                        g += std::to_integer<int>(texel[1]);
+                        b += std::to_integer<int>(texel[blue]);
+                    }
+                }
+                r = (r + 2) / 4;
+                g = (g + 2) / 4;
+                b = (b + 2) / 4;
+                cb[cy * chromaWidth + cx] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                cr[cy * chromaWidth + cx] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+        }
+        std::fputs("FRAME\n", file_);
+        std::fwrite(planes_.data(), 1, planes_.size(), file_);
+        ++written_;
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file frame_dump.hpp
+ * @brief Defines the FrameDump class, which streams read back frames to a file or pipe.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_FRAME_DUMP_HPP
+#define INC_3DLOADERVK_FRAME_DUMP_HPP
+#include "readback.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vkutil
+{
+    enum class FrameDumpFormat
+    {
+        // the texels as rendered, BGRA or RGBA depending on the format
+        eRaw,
+        // YUV4MPEG2, 4:2:0 in BT.601 limited range, which most video tools read directly
+        eY4M
+    };
+
+    /**
+     * @class FrameDump
+     * @brief Writes frames to a file, or to the standard input of a command when the path starts with '|'.
+     *
+     * write() copies the pixels and returns, a thread of its own converts and writes them, so a slow
+     * disk or encoder only holds up rendering once a few frames are queued. A Y4M stream's size is
+     * fixed by its first frame, frames of any other size are skipped.
+     */
+    class FrameDump
+    {
+    public:
+        /**
+         * @param path The file to write, or '|' followed by a command to pipe the frames to.
+         * @param format How frames are written.
+         * @param fps The frame rate written in the Y4M header.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        FrameDump(const std::string& path, FrameDumpFormat format, uint32_t fps, bool debug);
+        /**
+         * @brief Writes the frames still queued and closes the file.
+         */
+        ~FrameDump();
+        FrameDump(const FrameDump&) = delete;
+        FrameDump& operator=(const FrameDump&) = delete;
+        [[nodiscard]] bool valid() const;
+        /**
+         * @brief Queues a frame, blocking only while the queue is full.
+         */
+        void write(const ReadbackFrame& frame);
+        /**
+         * @brief Picks the format from the extension, Y4M for .y4m and raw otherwise.
+         */
+        static FrameDumpFormat FormatFor(const std::string& path);
+    private:
+        struct QueuedFrame
+        {
+            vk::Extent2D extent;
+            vk::Format format = vk::Format::eUndefined;
+            std::vector<std::byte> pixels;
+        };
+        static constexpr size_t kMaxQueued = 4;
+
+        void WriterLoop();
+        void WriteY4M(const QueuedFrame& frame);
+
+        std::FILE* file_;
+        bool pipe_;
+        FrameDumpFormat format_;
+        uint32_t fps_;
+        bool debug_;
+        vk::Extent2D stream_extent_;
+        uint64_t written_;
+        uint64_t skipped_;
+        std::vector<uint8_t> planes_;
+
+        std::mutex mutex_;
+        std::condition_variable queued_;
+        std::condition_variable drained_;
+        std::deque<QueuedFrame> queue_;
+        // frames written are recycled so steady state streaming doesn't allocate
+        std::vector<QueuedFrame> free_;
+        bool stopping_;
+        std::thread writer_;
+    };
+}
+#endif //INC_3DLOADERVK_FRAME_DUMP_HPP
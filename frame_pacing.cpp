@@ -0,0 +1,155 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "frame_pacing.hpp"
+#include <thread>
+namespace vkutil
+{
+    FrameLimiter::FrameLimiter(double target_fps)
+    {
+        enabled_ = target_fps > 0.0;
+        period_ = enabled_
+                ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / target_fps))
+                : std::chrono::steady_clock::duration::zero();
+        deadline_ = std::chrono::steady_clock::time_point();
+    }
+
+    void FrameLimiter::wait()
+    {
+        if(!enabled_)
+        {
+            return;
+        }
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if(deadline_ == std::chrono::steady_clock::time_point() || now > deadline_ + period_)
+        {
+            // first frame, or more than a whole frame late: restart the schedule from now
+            deadline_ = now + period_;
+            return;
+        }
+        if(now < deadline_)
+        {
+            std::this_thread::sleep_until(deadline_);
+        }
+        deadline_ += period_;
+    }
+
+    FramePacer::FramePacer(const FramePacingSettings& settings, bool present_wait_supported, bool debug)
+        : settings_(settings), limiter_(settings.targetFps)
+    {
+        present_wait_ = present_wait_supported;
+        debug_ = debug;
+        next_present_id_ = 0;
+        latency_samples_ = 0;
+        last_latency_ms_ = 0.0;
+        average_latency_ms_ = 0.0;
+        if(debug)
+        {
+            std::cout << "Frame pacing: requested present mode " << vk::to_string(settings.presentMode)
+                      << ", " << settings.framesInFlight << " frames in flight";
+            if(settings.targetFps > 0.0)
+            {
+                std::cout << ", limited to " << settings.targetFps << " fps";
+            }
+            std::cout << (present_wait_supported ? ", present wait enabled\n" : ", present wait unavailable\n");
+        }
+    }
+
+    const FramePacingSettings& FramePacer::settings() const
+    {
+        return settings_;
+    }
+
+    bool FramePacer::uses_present_wait() const
+    {
+        return present_wait_;
+    }
+
+    void FramePacer::begin_frame(vk::Device device, vk::SwapchainKHR swapchain, Timeline& timeline, const vk::DispatchLoaderDynamic& dispatch)
+    {
+        limiter_.wait();
+        if(!present_wait_)
+        {
+            while(!pending_.empty() && timeline.is_complete(pending_.front().timelineValue))
+            {
+                Record(pending_.front());
+                pending_.pop_front();
+            }
+            return;
+        }
+        while(!pending_.empty() && WaitForPresent(device, swapchain, pending_.front().presentId, 0, dispatch))
+        {
+            Record(pending_.front());
+            pending_.pop_front();
+        }
+        while(settings_.maxQueuedPresents > 0 && pending_.size() > settings_.maxQueuedPresents)
+        {
+            if(!WaitForPresent(device, swapchain, pending_.front().presentId, UINT64_MAX, dispatch))
+            {
+                break;
+            }
+            Record(pending_.front());
+            pending_.pop_front();
+        }
+    }
+
+    uint64_t FramePacer::on_submit(uint64_t timeline_value)
+    {
+        PendingPresent present = { };
+        present.presentId = ++next_present_id_;
+        present.timelineValue = timeline_value;
+        present.submitted = std::chrono::steady_clock::now();
+        pending_.push_back(present);
+        return present.presentId;
+    }
+
+    void FramePacer::on_swapchain_recreated()
+    {
+        pending_.clear();
+    }
+
+    double FramePacer::last_latency_ms() const
+    {
+        return last_latency_ms_;
+    }
+
+    double FramePacer::average_latency_ms() const
+    {
+        return average_latency_ms_;
+    }
+
+    bool FramePacer::WaitForPresent(vk::Device device, vk::SwapchainKHR swapchain, uint64_t present_id, uint64_t timeout, const vk::DispatchLoaderDynamic& dispatch)
+    {
+        try
+        {
+            vk::Result result = device.waitForPresentKHR(swapchain, present_id, timeout, dispatch);
+            return result == vk::Result::eSuccess || result == vk::Result::eSuboptimalKHR;
+        }
+        catch(vk::SystemError &err)
+        {
+            // the swap chain is out of date, none of the pending ids will ever be reported
+            if(debug_)
+            {
+                std::cout << "Failed to wait for present " << present_id << ": " << err.what() << std::endl;
+            }
+            pending_.clear();
+            return false;
+        }
+    }
+
+    /**
+     * @brief Adds one latency sample.
+     *
+     * A present found complete by polling is only noticed at the start of a later frame, so its
+     * sample is an upper bound; presents the pacer had to block on are measured exactly.
+     */
+    void FramePacer::Record(const PendingPresent& present)
+    {
+        last_latency_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - present.submitted).count();
+        average_latency_ms_ = latency_samples_ == 0
+                ? last_latency_ms_
+                : average_latency_ms_ + 0.1 * (last_latency_ms_ - average_latency_ms_);
+        latency_samples_++;
+    }
+}
@@ -0,0 +1,137 @@
+/**
+ * @file frame_pacing.hpp
+ * @brief Defines the frame pacing settings, the CPU frame limiter and the FramePacer that measures present latency.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_FRAME_PACING_HPP
+#define INC_3DLOADERVK_FRAME_PACING_HPP
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include "timeline.hpp"
+
+namespace vkutil
+{
+    /**
+     * @struct FramePacingSettings
+     * @brief Latency related choices for the swap chain and the render loop.
+     *
+     * presentMode is one of FIFO, FIFO_RELAXED, MAILBOX or IMMEDIATE and falls back to FIFO when the
+     * surface doesn't support it. An imageCount of zero keeps the driver minimum plus one, a targetFps
+     * of zero disables the CPU limiter and a maxQueuedPresents of zero disables present-wait throttling.
+     */
+    struct FramePacingSettings
+    {
+        vk::PresentModeKHR presentMode = vk::PresentModeKHR::eMailbox;
+        uint32_t imageCount = 0;
+        int framesInFlight = 2;
+        double targetFps = 0.0;
+        uint32_t maxQueuedPresents = 2;
+    };
+
+    /**
+     * @struct FrameStageTimes
+     * @brief CPU time a renderer spent in each stage of its frames, summed over every frame rendered.
+     *
+     * pace is the frame limiter and present throttling, wait the wait for a frame in flight to free
+     * up, which is where a GPU bound renderer spends its time, and readback the delivery of frames
+     * read back. Divide by frames for per frame averages.
+     */
+    struct FrameStageTimes
+    {
+        uint64_t frames = 0;
+        double paceMs = 0.0;
+        double waitMs = 0.0;
+        double readbackMs = 0.0;
+        double acquireMs = 0.0;
+        double recordMs = 0.0;
+        double submitMs = 0.0;
+        double presentMs = 0.0;
+    };
+
+    /**
+     * @class FrameLimiter
+     * @brief Sleeps the calling thread until the next frame deadline instead of spinning.
+     *
+     * Deadlines advance by a fixed period so sleep overshoot doesn't accumulate into drift, and a frame
+     * that is already late restarts the schedule rather than rushing to catch up.
+     */
+    class FrameLimiter
+    {
+    public:
+        /**
+         * @param target_fps Frames per second to pace to, zero or less disables the limiter.
+         */
+        explicit FrameLimiter(double target_fps);
+        /**
+         * @brief Blocks until the next frame is due.
+         */
+        void wait();
+    private:
+        bool enabled_;
+        std::chrono::steady_clock::duration period_;
+        std::chrono::steady_clock::time_point deadline_;
+    };
+
+    /**
+     * @class FramePacer
+     * @brief Applies the frame pacing settings and measures CPU submit to present latency.
+     *
+     * With VK_KHR_present_wait every present carries an id, and a present is considered done when
+     * vkWaitForPresentKHR returns for it. Without the extension the latency falls back to submit to
+     * GPU completion, read from the frame timeline.
+     */
+    class FramePacer
+    {
+    public:
+        FramePacer(const FramePacingSettings& settings, bool present_wait_supported, bool debug);
+        [[nodiscard]] const FramePacingSettings& settings() const;
+        [[nodiscard]] bool uses_present_wait() const;
+        /**
+         * @brief Paces the start of a frame and collects the latency of finished presents.
+         *
+         * Sleeps on the frame limiter, then records every present that has completed since the last
+         * call, and finally blocks until no more than maxQueuedPresents presents are outstanding.
+         *
+         * @param device The Vulkan logical device.
+         * @param swapchain The swap chain the pending presents were queued on.
+         * @param timeline The frame timeline, used when present wait is unavailable.
+         * @param dispatch Dispatcher holding the device level VK_KHR_present_wait entry point.
+         */
+        void begin_frame(vk::Device device, vk::SwapchainKHR swapchain, Timeline& timeline, const vk::DispatchLoaderDynamic& dispatch);
+        /**
+         * @brief Records a frame submission.
+         * @param timeline_value The frame timeline value the submission signals.
+         * @return The present id to attach to this frame's present.
+         */
+        uint64_t on_submit(uint64_t timeline_value);
+        /**
+         * @brief Forgets presents queued on a swap chain that has just been replaced.
+         */
+        void on_swapchain_recreated();
+        [[nodiscard]] double last_latency_ms() const;
+        [[nodiscard]] double average_latency_ms() const;
+    private:
+        struct PendingPresent
+        {
+            uint64_t presentId;
+            uint64_t timelineValue;
+            std::chrono::steady_clock::time_point submitted;
+        };
+        bool WaitForPresent(vk::Device device, vk::SwapchainKHR swapchain, uint64_t present_id, uint64_t timeout, const vk::DispatchLoaderDynamic& dispatch);
+        void Record(const PendingPresent& present);
+
+        FramePacingSettings settings_;
+        FrameLimiter limiter_;
+        bool present_wait_;
+        bool debug_;
+        uint64_t next_present_id_;
+        std::deque<PendingPresent> pending_;
+        uint64_t latency_samples_;
+        double last_latency_ms_;
+        double average_latency_ms_;
+    };
+}
+#endif //INC_3DLOADERVK_FRAME_PACING_HPP
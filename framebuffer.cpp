@@ -2,35 +2,34 @@
 
 namespace vkinit
 {
-    void make_framebuffers(framebufferInput inputChunk, std::vector<vkutil::SwapChainFrame>& frames, bool debug)
+    vk::Framebuffer make_framebuffer(const framebufferInput& inputChunk, const std::vector<vk::ImageView>& attachments, bool debug)
     {
-        for(size_t i = 0; i < frames.size(); i++)
-        {
-            std::vector<vk::ImageView> attachments = { frames[i].imageView };
-            vk::FramebufferCreateInfo framebufferInfo = {};
-            framebufferInfo.flags = vk::FramebufferCreateFlags();
-            framebufferInfo.renderPass = inputChunk.renderpass;
-            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-            framebufferInfo.pAttachments = attachments.data();
-            framebufferInfo.width = inputChunk.swapchainExtent.width;
-            framebufferInfo.height = inputChunk.swapchainExtent.height;
-            framebufferInfo.layers = 1;
+        vk::FramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.flags = vk::FramebufferCreateFlags();
+        framebufferInfo.renderPass = inputChunk.renderpass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = inputChunk.extent.width;
+        framebufferInfo.height = inputChunk.extent.height;
+        framebufferInfo.layers = 1;
 
-            try
+        try
+        {
+            vk::Framebuffer framebuffer = inputChunk.device.createFramebuffer(framebufferInfo);
+            if(debug)
             {
-                frames[i].framebuffer = inputChunk.device.createFramebuffer(framebufferInfo);
-                if(debug)
-                {
-                    std::cout << "Created framebuffer for frame " << i << std::endl;
-                }
+                std::cout << "Created a " << inputChunk.extent.width << "x" << inputChunk.extent.height << " framebuffer with "
+                          << attachments.size() << " attachments" << std::endl;
             }
-            catch(const vk::SystemError &err)
+            return framebuffer;
+        }
+        catch(const vk::SystemError &err)
+        {
+            if(debug)
             {
-                if(debug)
-                {
-                    std::cout << "Failed to create framebuffer for frame " << i << std::endl;
-                }
+                std::cout << "Failed to create framebuffer" << std::endl;
             }
+            return vk::Framebuffer{};
         }
     }
 }
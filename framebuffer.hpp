@@ -4,7 +4,6 @@
 #include <vulkan/vulkan.hpp>
 #include <vector>
 #include <iostream>
-#include "frame.hpp"
 
 namespace vkinit
 {
@@ -12,10 +11,14 @@ namespace vkinit
     {
         vk::Device device;
         vk::RenderPass renderpass;
-        vk::Extent2D swapchainExtent;
+        vk::Extent2D extent;
     };
 
-    void make_framebuffers(framebufferInput inputChunk, std::vector<vkutil::SwapChainFrame>& frames, bool debug);
+    /**
+     * @brief Creates a framebuffer for a render pass from one view per attachment.
+     * @return The framebuffer, or a null handle if creation failed.
+     */
+    vk::Framebuffer make_framebuffer(const framebufferInput& inputChunk, const std::vector<vk::ImageView>& attachments, bool debug);
 }
 
 #endif //INC_3DLOADERVK_FRAMEBUFFER_HPP
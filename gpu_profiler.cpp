@@ -0,0 +1,248 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "gpu_profiler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace vkutil
+{
+    GpuProfiler::GpuProfiler(vk::Device device, float timestamp_period, uint32_t timestamp_bits, uint32_t slot_count,
+                             uint32_t max_scopes, const std::string& trace_path, bool debug)
+    {
+        device_ = device;
+        period_ns_ = static_cast<double>(timestamp_period);
+        mask_ = timestamp_bits >= 64 ? UINT64_MAX : (uint64_t(1) << timestamp_bits) - 1;
+        max_queries_ = max_scopes * 2;
+        debug_ = debug;
+        recording_ = nullptr;
+        open_scopes_ = 0;
+        frames_recorded_ = 0;
+        dropped_ = 0;
+        first_event_ = true;
+        if(timestamp_bits == 0)
+        {
+            std::cout << "The graphics queue can't write timestamps, GPU times aren't measured\n";
+            return;
+        }
+
+        vk::QueryPoolCreateInfo poolInfo = { };
+        poolInfo.queryType = vk::QueryType::eTimestamp;
+        poolInfo.queryCount = max_queries_;
+        slots_.resize(slot_count);
+        for(Slot& slot : slots_)
+        {
+            try
+            {
+                slot.pool = device_.createQueryPool(poolInfo);
+            }
+            catch(vk::SystemError &err)
+            {
+                std::cout << "Failed to create a timestamp query pool: " << err.what() << "\n";
+                return;
+            }
+        }
+        if(!trace_path.empty())
+        {
+            trace_.open(trace_path, std::ios::out | std::ios::trunc);
+            if(!trace_)
+            {
+                std::cout << "Failed to open the GPU trace " << trace_path << "\n";
+            }
+            else
+            {
+                trace_ << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n"
+                       << R"({"name":"thread_name","ph":"M","pid":1,"tid":1,"args":{"name":"GPU graphics queue"}})";
+                first_event_ = false;
+            }
+        }
+        if(debug)
+        {
+            std::cout << "GPU profiler of " << slot_count << " query pools of " << max_queries_ << " timestamps, "
+                      << timestamp_period << " ns per tick\n";
+        }
+    }
+
+    GpuProfiler::~GpuProfiler()
+    {
+        // oldest first, so the trace stays in order
+        std::vector<Slot*> pending;
+        for(Slot& slot : slots_)
+        {
+            pending.push_back(&slot);
+        }
+        std::sort(pending.begin(), pending.end(), [](const Slot* a, const Slot* b)
+        {
+            return a->frame < b->frame;
+        });
+        for(Slot* slot : pending)
+        {
+            if(slot->pool)
+            {
+                Collect(*slot);
+            }
+            device_.destroyQueryPool(slot->pool);
+        }
+        if(trace_.is_open())
+        {
+            trace_ << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        }
+        if(debug_ && dropped_ > 0)
+        {
+            std::cout << "GPU profiler dropped " << dropped_ << " scopes whose timestamps weren't ready\n";
+        }
+    }
+
+    bool GpuProfiler::valid() const
+    {
+        return !slots_.empty() && slots_.back().pool;
+    }
+
+    void GpuProfiler::begin_frame(vk::CommandBuffer command_buffer, uint32_t slot)
+    {
+        recording_ = nullptr;
+        open_scopes_ = 0;
+        if(!valid())
+        {
+            return;
+        }
+        Slot& current = slots_[slot];
+        Collect(current);
+        current.recorded.clear();
+        current.queryCount = 0;
+        current.frame = frames_recorded_++;
+        // queries are written at most once between resets
+        command_buffer.resetQueryPool(current.pool, 0, max_queries_);
+        recording_ = &current;
+    }
+
+    void GpuProfiler::abandon_frame(uint32_t slot)
+    {
+        if(!valid())
+        {
+            return;
+        }
+        Slot& abandoned = slots_[slot];
+        abandoned.recorded.clear();
+        abandoned.queryCount = 0;
+        if(recording_ == &abandoned)
+        {
+            recording_ = nullptr;
+        }
+    }
+
+    uint32_t GpuProfiler::begin_scope(vk::CommandBuffer command_buffer, const std::string& name)
+    {
+        if(recording_ == nullptr || recording_->queryCount + 2 > max_queries_)
+        {
+            return UINT32_MAX;
+        }
+        Recorded recorded = { FindScope(name), recording_->queryCount };
+        recording_->recorded.push_back(recorded);
+        recording_->queryCount += 2;
+        ++open_scopes_;
+        command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, recording_->pool, recorded.query);
+        return static_cast<uint32_t>(recording_->recorded.size() - 1);
+    }
+
+    void GpuProfiler::end_scope(vk::CommandBuffer command_buffer, uint32_t scope)
+    {
+        if(recording_ == nullptr || scope >= recording_->recorded.size())
+        {
+            return;
+        }
+        --open_scopes_;
+        command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, recording_->pool, recording_->recorded[scope].query + 1);
+    }
+
+    const std::vector<GpuScopeTime>& GpuProfiler::scope_times() const
+    {
+        return scopes_;
+    }
+
+    uint32_t GpuProfiler::FindScope(const std::string& name)
+    {
+        for(size_t i = 0; i < scopes_.size(); ++i)
+        {
+            if(scopes_[i].name == name)
+            {
+                return static_cast<uint32_t>(i);
+            }
+        }
+        GpuScopeTime scope;
+        scope.name = name;
+        scope.depth = open_scopes_;
+        scopes_.push_back(scope);
+        last_frames_.push_back(UINT64_MAX);
+        return static_cast<uint32_t>(scopes_.size() - 1);
+    }
+
+    void GpuProfiler::Collect(Slot& slot)
+    {
+        if(slot.queryCount == 0)
+        {
+            return;
+        }
+        // a value and an availability word per query, without eWait unavailable ones are left at zero
+        std::vector<uint64_t> results(size_t(slot.queryCount) * 2, 0);
+        vk::Result result = device_.getQueryPoolResults(slot.pool, 0, slot.queryCount, results.size() * sizeof(uint64_t),
+                                                        results.data(), 2 * sizeof(uint64_t),
+                                                        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+        if(result != vk::Result::eSuccess && result != vk::Result::eNotReady)
+        {
+            dropped_ += slot.recorded.size();
+            slot.queryCount = 0;
+            return;
+        }
+        for(const Recorded& recorded : slot.recorded)
+        {
+            size_t begin = size_t(recorded.query) * 2;
+            if(results[begin + 1] == 0 || results[begin + 3] == 0)
+            {
+                ++dropped_;
+                continue;
+            }
+            double ms = static_cast<double>((results[begin + 2] - results[begin]) & mask_) * period_ns_ / 1e6;
+            GpuScopeTime& scope = scopes_[recorded.scope];
+            if(last_frames_[recorded.scope] == slot.frame)
+            {
+                scope.lastMs += ms;
+            }
+            else
+            {
+                last_frames_[recorded.scope] = slot.frame;
+                scope.lastMs = ms;
+                ++scope.frames;
+            }
+            scope.totalMs += ms;
+            if(trace_.is_open())
+            {
+                if(!trace_origin_)
+                {
+                    trace_origin_ = results[begin];
+                }
+                double start = static_cast<double>((results[begin] - *trace_origin_) & mask_) * period_ns_ / 1e3;
+                WriteTraceEvent(scope.name, start, ms * 1e3, slot.frame);
+            }
+        }
+        slot.queryCount = 0;
+    }
+
+    void GpuProfiler::WriteTraceEvent(const std::string& name, double start_us, double duration_us, uint64_t frame)
+    {
+        std::string escaped;
+        for(char c : name)
+        {
+            if(c == '"' || c == '\\')
+            {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        trace_ << (first_event_ ? "" : ",\n") << R"({"name":")" << escaped << R"(","cat":"gpu","ph":"X","pid":1,"tid":1,"ts":)"
+               << start_us << ",\"dur\":" << duration_us << ",\"args\":{\"frame\":" << frame << "}}";
+        first_event_ = false;
+    }
+}
@@ -0,0 +1,135 @@
+/**
+ * @file gpu_profiler.hpp
+ * @brief Defines the GpuProfiler class, which times scopes of command buffers on the GPU with timestamp queries.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_GPU_PROFILER_HPP
+#define INC_3DLOADERVK_GPU_PROFILER_HPP
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace vkutil
+{
+    /**
+     * @struct GpuScopeTime
+     * @brief GPU time spent in a named scope, summed over every frame whose results were read.
+     *
+     * depth is how many scopes the scope was nested in when first recorded. Divide by frames for
+     * per frame averages.
+     */
+    struct GpuScopeTime
+    {
+        std::string name;
+        uint32_t depth = 0;
+        uint64_t frames = 0;
+        double lastMs = 0.0;
+        double totalMs = 0.0;
+    };
+
+    /**
+     * @class GpuProfiler
+     * @brief Writes timestamps around scopes of a frame's command buffer and reads them back frames later.
+     *
+     * Every frame in flight has a query pool of its own, reset at the start of the frame it records.
+     * Before the reset the results of the slot's previous frame are read without waiting: the frame
+     * timeline already said that frame finished, so they are there, and a scope whose timestamps
+     * aren't is dropped rather than stalling the frame. Ticks become milliseconds through the
+     * device_'s timestampPeriod, masked to the bits the queue actually writes.
+     *
+     * Scopes are named; every scope of the same name adds to the same GpuScopeTime. With a trace
+     * path, every scope read is also streamed to a Chrome trace event file, which chrome://tracing
+     * and Perfetto open, timed from the first timestamp read. Timestamps are only compared to
+     * others of the same queue, so record scopes into command buffers of the graphics queue.
+     * Not thread safe, belongs to the thread rendering.
+     */
+    class GpuProfiler
+    {
+    public:
+        /**
+         * @param device The Vulkan logical device_.
+         * @param timestamp_period Nanoseconds per timestamp tick, from the device_ limits.
+         * @param timestamp_bits The bits of a timestamp that count, zero disables profiling.
+         * @param slot_count The number of frames in flight.
+         * @param max_scopes The most scopes a frame records, any more aren't timed.
+         * @param trace_path Where to write the trace, or empty for none.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        GpuProfiler(vk::Device device, float timestamp_period, uint32_t timestamp_bits, uint32_t slot_count,
+                    uint32_t max_scopes, const std::string& trace_path, bool debug);
+        /**
+         * @brief Reads the frames still pending, which must have completed, and closes the trace.
+         */
+        ~GpuProfiler();
+        GpuProfiler(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+        [[nodiscard]] bool valid() const;
+        /**
+         * @brief Reads the slot's previous frame and resets its queries, outside of any rendering.
+         * @param command_buffer The command buffer of the frame, just begun.
+         * @param slot The frame in flight, whose previous frame must have completed.
+         */
+        void begin_frame(vk::CommandBuffer command_buffer, uint32_t slot);
+        /**
+         * @brief Forgets the scopes of a frame that was recorded but never submitted.
+         *
+         * Its command buffer, query reset included, never runs, so the slot's queries hold nothing to read.
+         * @param slot The frame in flight that was abandoned.
+         */
+        void abandon_frame(uint32_t slot);
+        /**
+         * @brief Writes the timestamp opening a scope, nested in the scopes still open.
+         * @return The scope to pass to end_scope, which isn't timed when the frame ran out of queries.
+         */
+        uint32_t begin_scope(vk::CommandBuffer command_buffer, const std::string& name);
+        /**
+         * @brief Writes the timestamp closing a scope, once every earlier command finished.
+         */
+        void end_scope(vk::CommandBuffer command_buffer, uint32_t scope);
+        /**
+         * @brief The time of every scope read so far, in the order they were first recorded.
+         */
+        [[nodiscard]] const std::vector<GpuScopeTime>& scope_times() const;
+    private:
+        // a scope of a recorded frame, timed by the queries at query and query + 1
+        struct Recorded
+        {
+            uint32_t scope;
+            uint32_t query;
+        };
+        struct Slot
+        {
+            vk::QueryPool pool;
+            std::vector<Recorded> recorded;
+            uint32_t queryCount = 0;
+            uint64_t frame = 0;
+        };
+
+        uint32_t FindScope(const std::string& name);
+        void Collect(Slot& slot);
+        void WriteTraceEvent(const std::string& name, double start_us, double duration_us, uint64_t frame);
+
+        vk::Device device_;
+        double period_ns_;
+        uint64_t mask_;
+        uint32_t max_queries_;
+        bool debug_;
+        std::vector<Slot> slots_;
+        Slot* recording_;
+        uint32_t open_scopes_;
+        uint64_t frames_recorded_;
+        std::vector<GpuScopeTime> scopes_;
+        // the frame each scope was last read from, so scopes recorded twice in a frame add up
+        std::vector<uint64_t> last_frames_;
+        uint64_t dropped_;
+
+        std::ofstream trace_;
+        bool first_event_;
+        // the tick trace timestamps count from, set by the first scope read
+        std::optional<uint64_t> trace_origin_;
+    };
+}
+#endif //INC_3DLOADERVK_GPU_PROFILER_HPP
@@ -4,6 +4,7 @@
  * @date Created by Renato on 27-12-23.
  */
 #include "instance.hpp"
+#include <algorithm>
 /**
  * @brief Checks if the specified extensions and layers are supported.
  *
@@ -101,9 +102,40 @@ bool vkinit::supported(std::vector<const char*>& extensions, std::vector<const c
  *
  * @param debug Flag indicating whether to enable debug logging.
  * @param applicationName The name of the application.
+ * @param headless Whether to leave out the surface extensions, for rendering without a window_.
  * @return A Vulkan instance_, or nullptr if instance_ creation fails.
  */
-vk::Instance vkinit::make_instance(bool debug, const char* applicationName)
+/**
+ * @brief The API version instances are created for: the loader's, at least 1.2 and at most 1.3.
+ *
+ * 1.3 brings dynamic rendering and synchronization2 into core, which the engine uses on devices
+ * that have them. Nothing newer is used, so nothing newer is asked for.
+ */
+uint32_t vkinit::instance_api_version()
+{
+    uint32_t version{ 0 };
+    vkEnumerateInstanceVersion(&version);
+    version &= ~(0xFFFU);
+    return std::clamp(version, VK_MAKE_API_VERSION(0, 1, 2, 0), VK_MAKE_API_VERSION(0, 1, 3, 0));
+}
+/**
+ * @brief Whether the loader offers the instance_ extensions VK_EXT_swapchain_maintenance1 depends on.
+ *
+ * VK_EXT_surface_maintenance1 and the VK_KHR_get_surface_capabilities2 it builds on are optional,
+ * instances with a window_ enable them whenever they are there.
+ */
+bool vkinit::surface_maintenance_supported()
+{
+    bool surfaceMaintenance = false;
+    bool surfaceCapabilities2 = false;
+    for(const vk::ExtensionProperties& extension : vk::enumerateInstanceExtensionProperties())
+    {
+        surfaceMaintenance |= strcmp(extension.extensionName, VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME) == 0;
+        surfaceCapabilities2 |= strcmp(extension.extensionName, VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME) == 0;
+    }
+    return surfaceMaintenance && surfaceCapabilities2;
+}
+vk::Instance vkinit::make_instance(bool debug, const char* applicationName, bool headless)
 {
 
     if (debug)
@@ -154,8 +186,9 @@ vk::Instance vkinit::make_instance(bool debug, const char* applicationName)
     /*
     * Or drop down to an earlier version to ensure compatibility with more devices
     * VK_MAKE_API_VERSION(variant, major, minor, patch)
+    * 1.2 is the oldest version with timeline semaphores in core, which frame synchronization needs.
     */
-    version = VK_MAKE_API_VERSION(0, 1, 0, 0);
+    version = instance_api_version();
 
     /*
     * from vulkan_structs.hpp:
@@ -178,13 +211,21 @@ vk::Instance vkinit::make_instance(bool debug, const char* applicationName)
 
     /*
     * Everything with Vulkan is "opt-in", so we need to query which extensions glfw needs
-    * in order to interface with vulkan.
+    * in order to interface with vulkan. Headless there is no window_ and glfw is never initialized.
     */
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> extensions;
+    if (!headless)
+    {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        if (surface_maintenance_supported())
+        {
+            extensions.push_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+            extensions.push_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+        }
+    }
 
     //In order to hook in a custom validation callback
     if (debug)
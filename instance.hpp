@@ -22,8 +22,23 @@ namespace vkinit
 
         \param debug whether the system is being run in debug mode.
         \param applicationName the name of the application.
+        \param headless whether to skip the surface extensions glfw needs, for rendering without a window_.
         \returns the instance_ created.
     */
-    vk::Instance make_instance(bool debug, const char* applicationName);
+    vk::Instance make_instance(bool debug, const char* applicationName, bool headless = false);
+
+    /**
+        The API version instances are created for, which also caps the version devices are used at.
+
+        \returns the loader's version clamped to the range the engine uses, 1.2 to 1.3.
+    */
+    uint32_t instance_api_version();
+
+    /**
+        Whether instances with a window_ enable the surface extensions swap chain present fences need.
+
+        \returns whether the loader offers VK_EXT_surface_maintenance1 and VK_KHR_get_surface_capabilities2.
+    */
+    bool surface_maintenance_supported();
 }
 #endif //INC_3DLOADERVK_INSTANCE_HPP
\ No newline at end of file
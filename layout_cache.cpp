@@ -0,0 +1,219 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "layout_cache.hpp"
+namespace vkutil
+{
+    namespace
+    {
+        void append_bindings(std::vector<uint32_t>& key, const std::vector<vk::DescriptorSetLayoutBinding>& bindings)
+        {
+            key.push_back(static_cast<uint32_t>(bindings.size()));
+            for(const vk::DescriptorSetLayoutBinding& binding : bindings)
+            {
+                key.push_back(binding.binding);
+                key.push_back(static_cast<uint32_t>(binding.descriptorType));
+                key.push_back(binding.descriptorCount);
+                key.push_back(static_cast<VkShaderStageFlags>(binding.stageFlags));
+            }
+        }
+    }
+
+    LayoutCache::LayoutCache(vk::Device device)
+    {
+        device_ = device;
+    }
+
+    LayoutCache::~LayoutCache()
+    {
+        for(auto& entry : pipeline_layouts_)
+        {
+            device_.destroyPipelineLayout(entry.second);
+        }
+        for(auto& entry : set_layouts_)
+        {
+            device_.destroyDescriptorSetLayout(entry.second);
+        }
+        for(auto& entry : reserved_sets_)
+        {
+            device_.destroyDescriptorSetLayout(entry.second.layout);
+        }
+    }
+
+    vk::DescriptorSetLayout LayoutCache::set_layout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return SetLayout(bindings);
+    }
+
+    vk::DescriptorSetLayout LayoutCache::reserve_set(uint32_t set, const std::vector<vk::DescriptorSetLayoutBinding>& bindings,
+                                                     const std::vector<vk::DescriptorBindingFlags>& binding_flags,
+                                                     vk::DescriptorSetLayoutCreateFlags flags)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(reserved_sets_.contains(set))
+        {
+            std::cout << "Descriptor set " << set << " is already reserved\n";
+            return vk::DescriptorSetLayout{};
+        }
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo;
+        flagsInfo.bindingCount = static_cast<uint32_t>(binding_flags.size());
+        flagsInfo.pBindingFlags = binding_flags.data();
+        vk::DescriptorSetLayoutCreateInfo layoutInfo;
+        layoutInfo.flags = flags;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+        if(!binding_flags.empty())
+        {
+            layoutInfo.pNext = &flagsInfo;
+        }
+        try
+        {
+            vk::DescriptorSetLayout layout = device_.createDescriptorSetLayout(layoutInfo);
+            reserved_sets_.emplace(set, ReservedSet{ bindings, layout });
+            return layout;
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to create the layout of reserved descriptor set " << set << ": " << err.what() << "\n";
+            return vk::DescriptorSetLayout{};
+        }
+    }
+
+    vk::PipelineLayout LayoutCache::pipeline_layout(const PipelineInterface& requested)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::optional<PipelineInterface> interface = WithReservedSets(requested);
+        if(!interface)
+        {
+            return vk::PipelineLayout{};
+        }
+        std::vector<uint32_t> key;
+        for(const std::vector<vk::DescriptorSetLayoutBinding>& set : interface->sets)
+        {
+            append_bindings(key, set);
+        }
+        for(const vk::PushConstantRange& range : interface->pushConstants)
+        {
+            key.push_back(static_cast<VkShaderStageFlags>(range.stageFlags));
+            key.push_back(range.offset);
+            key.push_back(range.size);
+        }
+
+        auto found = pipeline_layouts_.find(key);
+        if(found != pipeline_layouts_.end())
+        {
+            return found->second;
+        }
+        // sets no shader uses still need a layout, an empty one
+        std::vector<vk::DescriptorSetLayout> set_layouts;
+        for(uint32_t set = 0; set < interface->sets.size(); set++)
+        {
+            auto reserved = reserved_sets_.find(set);
+            vk::DescriptorSetLayout set_layout = reserved != reserved_sets_.end() ? reserved->second.layout : SetLayout(interface->sets[set]);
+            if(!set_layout)
+            {
+                return vk::PipelineLayout{};
+            }
+            set_layouts.push_back(set_layout);
+        }
+        vk::PipelineLayoutCreateInfo layoutInfo;
+        layoutInfo.flags = vk::PipelineLayoutCreateFlags();
+        layoutInfo.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+        layoutInfo.pSetLayouts = set_layouts.data();
+        layoutInfo.pushConstantRangeCount = static_cast<uint32_t>(interface->pushConstants.size());
+        layoutInfo.pPushConstantRanges = interface->pushConstants.data();
+        vk::PipelineLayout layout;
+        try
+        {
+            layout = device_.createPipelineLayout(layoutInfo);
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to create pipeline_ layout: " << err.what() << "\n";
+            return vk::PipelineLayout{};
+        }
+        pipeline_layouts_.emplace(std::move(key), layout);
+        interfaces_.emplace(static_cast<VkPipelineLayout>(layout), std::move(*interface));
+        return layout;
+    }
+
+    std::optional<PipelineInterface> LayoutCache::find_interface(vk::PipelineLayout layout) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = interfaces_.find(static_cast<VkPipelineLayout>(layout));
+        if(found == interfaces_.end())
+        {
+            return std::nullopt;
+        }
+        return found->second;
+    }
+
+    vk::DescriptorSetLayout LayoutCache::SetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings)
+    {
+        std::vector<uint32_t> key;
+        append_bindings(key, bindings);
+        auto found = set_layouts_.find(key);
+        if(found != set_layouts_.end())
+        {
+            return found->second;
+        }
+        vk::DescriptorSetLayoutCreateInfo layoutInfo;
+        layoutInfo.flags = vk::DescriptorSetLayoutCreateFlags();
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+        try
+        {
+            vk::DescriptorSetLayout layout = device_.createDescriptorSetLayout(layoutInfo);
+            set_layouts_.emplace(std::move(key), layout);
+            return layout;
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to create descriptor set layout: " << err.what() << "\n";
+            return vk::DescriptorSetLayout{};
+        }
+    }
+
+    /**
+     * @brief Replaces the bindings of every reserved set with the reserved ones, after checking the shaders fit them.
+     */
+    std::optional<PipelineInterface> LayoutCache::WithReservedSets(const PipelineInterface& interface) const
+    {
+        PipelineInterface result = interface;
+        if(!reserved_sets_.empty())
+        {
+            result.sets.resize(std::max<size_t>(result.sets.size(), reserved_sets_.rbegin()->first + 1));
+        }
+        for(uint32_t set = 0; set < result.sets.size(); set++)
+        {
+            auto reserved = reserved_sets_.find(set);
+            if(reserved == reserved_sets_.end())
+            {
+                for(const vk::DescriptorSetLayoutBinding& binding : result.sets[set])
+                {
+                    if(binding.descriptorCount == 0)
+                    {
+                        std::cerr << "Set " << set << " binding " << binding.binding
+                                  << " is a runtime sized array outside of a reserved set\n";
+                        return std::nullopt;
+                    }
+                }
+                continue;
+            }
+            PipelineInterface shaders;
+            PipelineInterface layout;
+            shaders.sets.resize(set + 1);
+            layout.sets.resize(set + 1);
+            shaders.sets[set] = std::move(result.sets[set]);
+            layout.sets[set] = reserved->second.bindings;
+            if(!is_layout_compatible(layout, shaders, "Reserved set " + std::to_string(set)))
+            {
+                return std::nullopt;
+            }
+            result.sets[set] = std::move(layout.sets[set]);
+        }
+        return result;
+    }
+}
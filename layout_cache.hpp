@@ -0,0 +1,86 @@
+/**
+ * @file layout_cache.hpp
+ * @brief Defines the LayoutCache class, which deduplicates descriptor set and pipeline layouts.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_LAYOUT_CACHE_HPP
+#define INC_3DLOADERVK_LAYOUT_CACHE_HPP
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shader_reflection.hpp"
+
+namespace vkutil
+{
+    /**
+     * @class LayoutCache
+     * @brief Creates descriptor set and pipeline layouts from reflected shader interfaces, once each.
+     *
+     * Equal binding lists share one descriptor set layout and equal interfaces share one pipeline_
+     * layout, which keeps pipelines built from different shaders layout compatible whenever their
+     * resources agree. Owns every layout it returns. Thread safe.
+     *
+     * A set number can be reserved for a layout owned by a subsystem, such as the bindless table.
+     * Every pipeline_ layout then uses that layout at that number whether its shaders touch the set
+     * or not, so a set bound there once stays valid across pipelines. Runtime sized arrays are only
+     * allowed in reserved sets.
+     */
+    class LayoutCache
+    {
+    public:
+        explicit LayoutCache(vk::Device device);
+        ~LayoutCache();
+        LayoutCache(const LayoutCache&) = delete;
+        LayoutCache& operator=(const LayoutCache&) = delete;
+        /**
+         * @brief Returns the descriptor set layout for a list of bindings, creating it on first use.
+         * @return The layout, or a null handle if creation failed.
+         */
+        vk::DescriptorSetLayout set_layout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+        /**
+         * @brief Creates a layout with per binding flags and reserves a set number for it.
+         *
+         * Must be called before the pipeline_ layouts that should include the set are created.
+         * @param set The set number every pipeline_ layout uses the layout at.
+         * @param bindings The bindings of the set.
+         * @param binding_flags One entry per binding, such as update after bind or partially bound, or none.
+         * @param flags The layout's creation flags.
+         * @return The layout, or a null handle if creation failed or the number is already reserved.
+         */
+        vk::DescriptorSetLayout reserve_set(uint32_t set, const std::vector<vk::DescriptorSetLayoutBinding>& bindings,
+                                            const std::vector<vk::DescriptorBindingFlags>& binding_flags,
+                                            vk::DescriptorSetLayoutCreateFlags flags);
+        /**
+         * @brief Returns the pipeline_ layout for an interface's sets and push constants, creating it on first use.
+         * @return The layout, or a null handle if creation failed or the interface doesn't fit the reserved sets.
+         */
+        vk::PipelineLayout pipeline_layout(const PipelineInterface& interface);
+        /**
+         * @brief Returns the interface a pipeline_ layout of this cache was created for.
+         */
+        [[nodiscard]] std::optional<PipelineInterface> find_interface(vk::PipelineLayout layout) const;
+    private:
+        struct ReservedSet
+        {
+            std::vector<vk::DescriptorSetLayoutBinding> bindings;
+            vk::DescriptorSetLayout layout;
+        };
+
+        vk::DescriptorSetLayout SetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+        [[nodiscard]] std::optional<PipelineInterface> WithReservedSets(const PipelineInterface& interface) const;
+
+        vk::Device device_;
+        mutable std::mutex mutex_;
+        std::map<std::vector<uint32_t>, vk::DescriptorSetLayout> set_layouts_;
+        std::map<uint32_t, ReservedSet> reserved_sets_;
+        std::map<std::vector<uint32_t>, vk::PipelineLayout> pipeline_layouts_;
+        std::unordered_map<VkPipelineLayout, PipelineInterface> interfaces_;
+    };
+}
+#endif //INC_3DLOADERVK_LAYOUT_CACHE_HPP
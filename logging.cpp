@@ -223,9 +223,8 @@ This mode may result in visible tearing if rendering to the image is not timed c
     return "none/undefined";
 }
 
-void vkinit::log_device_properties(const vk::PhysicalDevice& device)
+void vkinit::log_device_properties(const vk::PhysicalDeviceProperties& properties)
 {
-    vk::PhysicalDeviceProperties properties = device.getProperties();
     std::cout << "Device name: " << properties.deviceName << '\n';
     std::cout << "Device type: ";
     switch(properties.deviceType)
@@ -23,7 +23,7 @@ namespace vkinit
     std::vector<std::string> log_alpha_composite_bits(vk::CompositeAlphaFlagsKHR bits);
     std::vector<std::string> log_image_usage_bits(vk::ImageUsageFlags bits);
     std::string log_present_mode(vk::PresentModeKHR presentMode);
-    void log_device_properties(const vk::PhysicalDevice& device);
+    void log_device_properties(const vk::PhysicalDeviceProperties& properties);
 }
 
 #endif //INC_3DLOADERVK_LOGGING_HPP
\ No newline at end of file
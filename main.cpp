@@ -1,8 +1,53 @@
 #include "app.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
 
-int main()
+int main(int argc, char** argv)
 {
-    App* application = new App(640, 480, true);
-    application -> run();
+    // --headless <frames> renders that many frames without a window, for machines without a display
+    // --dump <path> streams the rendered frames to a file, .y4m for video, or to a command after a '|'
+    // --device <index or name> renders on that GPU rather than the one scoring highest
+    // --gpu-trace <path> writes the GPU time of every frame and pass as a Chrome trace
+    vkutil::RenderSettings render;
+    int frames = 0;
+    std::string dump;
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if(option == "--headless")
+        {
+            render.headless = true;
+            frames = std::atoi(argv[i + 1]);
+        }
+        else if(option == "--dump")
+        {
+            dump = argv[i + 1];
+        }
+        else if(option == "--device")
+        {
+            render.device = argv[i + 1];
+        }
+        else if(option == "--gpu-trace")
+        {
+            render.gpuTrace = argv[i + 1];
+        }
+    }
+    App* application = nullptr;
+    try
+    {
+        application = new App(640, 480, true, vkutil::FramePacingSettings(), render);
+    }
+    catch(std::runtime_error &err)
+    {
+        std::cerr << err.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    if(!dump.empty())
+    {
+        application->dump_frames(dump);
+    }
+    application -> run(frames);
     delete application;
 }
@@ -0,0 +1,110 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "mapped_file.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace vkutil
+{
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::filesystem::path& path)
+    {
+        data_ = nullptr;
+        size_ = 0;
+        mapping_ = nullptr;
+        file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file_ == INVALID_HANDLE_VALUE)
+        {
+            file_ = nullptr;
+            return;
+        }
+        LARGE_INTEGER file_size;
+        if(!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0)
+        {
+            return;
+        }
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mapping_ == nullptr)
+        {
+            return;
+        }
+        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if(data_ != nullptr)
+        {
+            size_ = static_cast<size_t>(file_size.QuadPart);
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if(data_ != nullptr)
+        {
+            UnmapViewOfFile(data_);
+        }
+        if(mapping_ != nullptr)
+        {
+            CloseHandle(mapping_);
+        }
+        if(file_ != nullptr)
+        {
+            CloseHandle(file_);
+        }
+    }
+#else
+    MappedFile::MappedFile(const std::filesystem::path& path)
+    {
+        data_ = nullptr;
+        size_ = 0;
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if(descriptor < 0)
+        {
+            return;
+        }
+        struct stat status = { };
+        if(fstat(descriptor, &status) == 0 && status.st_size > 0)
+        {
+            void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if(mapped != MAP_FAILED)
+            {
+                data_ = static_cast<const uint8_t*>(mapped);
+                size_ = static_cast<size_t>(status.st_size);
+            }
+        }
+        // the mapping keeps the file alive on its own
+        close(descriptor);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if(data_ != nullptr)
+        {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+    }
+#endif
+
+    bool MappedFile::valid() const
+    {
+        return data_ != nullptr;
+    }
+
+    const uint8_t* MappedFile::data() const
+    {
+        return data_;
+    }
+
+    size_t MappedFile::size() const
+    {
+        return size_;
+    }
+}
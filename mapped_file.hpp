@@ -0,0 +1,43 @@
+/**
+ * @file mapped_file.hpp
+ * @brief Defines the MappedFile class, a read only memory mapping of a whole file.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_MAPPED_FILE_HPP
+#define INC_3DLOADERVK_MAPPED_FILE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace vkutil
+{
+    /**
+     * @class MappedFile
+     * @brief Maps a file into memory for reading, unmapping it on destruction.
+     *
+     * The pages are shared with the OS file cache, so nothing is copied until it is read.
+     * Mappings start on a page boundary, which satisfies the alignment SPIR-V needs.
+     */
+    class MappedFile
+    {
+    public:
+        /**
+         * @brief Maps the file at path, check valid() for the result.
+         */
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        [[nodiscard]] bool valid() const;
+        [[nodiscard]] const uint8_t* data() const;
+        [[nodiscard]] size_t size() const;
+    private:
+        const uint8_t* data_;
+        size_t size_;
+#ifdef _WIN32
+        void* file_;
+        void* mapping_;
+#endif
+    };
+}
+#endif //INC_3DLOADERVK_MAPPED_FILE_HPP
@@ -11,6 +11,12 @@ Buffer vkutil::createBuffer(BufferInput input)
     bufferInfo.size = input.size;
     bufferInfo.usage = input.usage;
     bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    if(input.sharing_families.size() > 1)
+    {
+        bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(input.sharing_families.size());
+        bufferInfo.pQueueFamilyIndices = input.sharing_families.data();
+    }
     Buffer buffer;
     buffer.buffer = input.logical_device.createBuffer(bufferInfo);
     allocateBufferMemory(buffer, input);
@@ -8,29 +8,33 @@
 
 namespace vkmesh
 {
-    vk::VertexInputBindingDescription getPosColorBindingDescription()
+    vk::VertexInputBindingDescription getBindingDescription(const std::vector<vkutil::ShaderVariable>& inputs)
     {
         vk::VertexInputBindingDescription bindingDescription{};
         bindingDescription.binding = 0;
-        bindingDescription.stride = 5 * sizeof(float);
+        bindingDescription.stride = 0;
+        for(const vkutil::ShaderVariable& input : inputs)
+        {
+            bindingDescription.stride += input.size;
+        }
         bindingDescription.inputRate = vk::VertexInputRate::eVertex;
         return bindingDescription;
     }
 
-    std::array<vk::VertexInputAttributeDescription, 2> getPosColorAttributeDescriptions()
+    std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions(const std::vector<vkutil::ShaderVariable>& inputs)
     {
-        std::array<vk::VertexInputAttributeDescription, 2> attributes{};
-        // Position
-        attributes[0].binding = 0;
-        attributes[0].location = 0;
-        attributes[0].format = vk::Format::eR32G32B32A32Sfloat;
-        attributes[0].offset = 0;
-        // Color
-        attributes[1].binding = 0;
-        attributes[1].location = 1;
-        attributes[1].format = vk::Format::eR32G32B32A32Sfloat;
-        attributes[1].offset = 2 * sizeof(float);
-
+        std::vector<vk::VertexInputAttributeDescription> attributes;
+        uint32_t offset = 0;
+        for(const vkutil::ShaderVariable& input : inputs)
+        {
+            vk::VertexInputAttributeDescription attribute{};
+            attribute.binding = 0;
+            attribute.location = input.location;
+            attribute.format = input.format;
+            attribute.offset = offset;
+            attributes.push_back(attribute);
+            offset += input.size;
+        }
         return attributes;
     }
 }
@@ -7,13 +7,22 @@
 #ifndef INC_3DLOADERVK_MESH_HPP
 #define INC_3DLOADERVK_MESH_HPP
 
-#include <array>
+#include <vector>
 #include <vulkan/vulkan.hpp>
+#include "shader_reflection.hpp"
 
 namespace vkmesh
 {
-    vk::VertexInputBindingDescription getPosColorBindingDescription();
-    std::array<vk::VertexInputAttributeDescription, 2> getPosColorAttributeDescriptions();
+    /**
+     * @brief The single interleaved vertex buffer binding a vertex shader's inputs are read from.
+     *
+     * Vertices hold the inputs tightly packed in location order, so the stride is the sum of their sizes.
+     */
+    vk::VertexInputBindingDescription getBindingDescription(const std::vector<vkutil::ShaderVariable>& inputs);
+    /**
+     * @brief One attribute per vertex shader input, at its offset in the interleaved vertex.
+     */
+    std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions(const std::vector<vkutil::ShaderVariable>& inputs);
 }
 
 #endif //INC_3DLOADERVK_MESH_HPP
\ No newline at end of file
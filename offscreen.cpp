@@ -0,0 +1,87 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "offscreen.hpp"
+#include "memory.hpp"
+#include <algorithm>
+
+namespace vkinit
+{
+    vk::Format choose_offscreen_format(vk::PhysicalDevice physicalDevice, bool debug)
+    {
+        vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eColorAttachment | vk::FormatFeatureFlagBits::eTransferSrc;
+        for(vk::Format format : { vk::Format::eB8G8R8A8Unorm, vk::Format::eR8G8B8A8Unorm })
+        {
+            if((physicalDevice.getFormatProperties(format).optimalTilingFeatures & required) == required)
+            {
+                if(debug)
+                {
+                    std::cout << "Rendering offscreen to " << vk::to_string(format) << '\n';
+                }
+                return format;
+            }
+        }
+        // every device_ renders to and copies from R8G8B8A8, the loop never gets here on a conformant one
+        return vk::Format::eR8G8B8A8Unorm;
+    }
+
+    SwapChainBundle create_offscreen_frames(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, int width, int height, uint32_t imageCount, bool debug)
+    {
+        SwapChainBundle bundle{ };
+        bundle.swapchain = nullptr;
+        bundle.format = choose_offscreen_format(physicalDevice, debug);
+        bundle.extent = vk::Extent2D(static_cast<uint32_t>(std::max(width, 1)), static_cast<uint32_t>(std::max(height, 1)));
+        bundle.presentMode = vk::PresentModeKHR::eImmediate;
+        if(debug)
+        {
+            std::cout << "Creating " << imageCount << " offscreen images of " << bundle.extent.width << "x" << bundle.extent.height << '\n';
+        }
+
+        vk::ImageCreateInfo imageInfo = { };
+        imageInfo.imageType = vk::ImageType::e2D;
+        imageInfo.format = bundle.format;
+        imageInfo.extent = vk::Extent3D(bundle.extent.width, bundle.extent.height, 1);
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = vk::SampleCountFlagBits::e1;
+        imageInfo.tiling = vk::ImageTiling::eOptimal;
+        // copied out of once rendered, the way a swap chain image would be presented
+        imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+        bundle.usage = imageInfo.usage;
+        imageInfo.sharingMode = vk::SharingMode::eExclusive;
+        imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+        bundle.frames.resize(imageCount);
+        for(vkutil::SwapChainFrame& frame : bundle.frames)
+        {
+            try
+            {
+                frame.image = logicalDevice.createImage(imageInfo);
+                vk::MemoryRequirements requirements = logicalDevice.getImageMemoryRequirements(frame.image);
+                vk::MemoryAllocateInfo allocInfo;
+                allocInfo.allocationSize = requirements.size;
+                allocInfo.memoryTypeIndex = vkutil::findMemoryTypeIndex(physicalDevice, requirements.memoryTypeBits,
+                                                                        vk::MemoryPropertyFlagBits::eDeviceLocal);
+                frame.memory = logicalDevice.allocateMemory(allocInfo);
+                logicalDevice.bindImageMemory(frame.image, frame.memory, 0);
+
+                vk::ImageViewCreateInfo imageViewCreateInfo = { };
+                imageViewCreateInfo.image = frame.image;
+                imageViewCreateInfo.viewType = vk::ImageViewType::e2D;
+                imageViewCreateInfo.format = bundle.format;
+                imageViewCreateInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+                imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+                imageViewCreateInfo.subresourceRange.levelCount = 1;
+                imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+                imageViewCreateInfo.subresourceRange.layerCount = 1;
+                frame.imageView = logicalDevice.createImageView(imageViewCreateInfo);
+            }
+            catch(vk::SystemError &err)
+            {
+                throw std::runtime_error("failed to create offscreen images!");
+            }
+        }
+        return bundle;
+    }
+}
@@ -0,0 +1,41 @@
+/**
+ * @file offscreen.hpp
+ * @brief Defines the images a headless engine renders into in place of a swap chain.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_OFFSCREEN_HPP
+#define INC_3DLOADERVK_OFFSCREEN_HPP
+#include "swapchain.hpp"
+#include <vulkan/vulkan.hpp>
+
+namespace vkinit
+{
+    /**
+     * @brief Chooses the format of offscreen frames, the one a swap chain is preferably created with.
+     *
+     * Falls back to R8G8B8A8 when the device_ can't render to and copy from B8G8R8A8, so the
+     * pipelines and the output are the same whether or not there is a window_.
+     *
+     * @param physicalDevice The Vulkan physical device_.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The format to create offscreen frames with.
+     */
+    vk::Format choose_offscreen_format(vk::PhysicalDevice physicalDevice, bool debug);
+
+    /**
+     * @brief Creates images to render into without a surface_, standing in for a swap chain.
+     *
+     * The images live in device_ local memory and can be copied from once rendered. The returned
+     * bundle has no swap chain, its frames own their images and memory.
+     *
+     * @param logicalDevice The Vulkan logical device_.
+     * @param physicalDevice The Vulkan physical device_.
+     * @param width The width_ of the images.
+     * @param height The height_ of the images.
+     * @param imageCount How many images to create, one per frame in flight is enough as none is ever presented.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return A SwapChainBundle holding the offscreen frames, their format and extent.
+     */
+    SwapChainBundle create_offscreen_frames(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, int width, int height, uint32_t imageCount, bool debug);
+}
+#endif //INC_3DLOADERVK_OFFSCREEN_HPP
@@ -3,8 +3,46 @@
 //
 
 #include "pipeline.hpp"
+#include "pipeline_library.hpp"
+#include <algorithm>
+#include <functional>
+#include <memory>
 namespace vkinit
 {
+    namespace
+    {
+        void hash_combine(size_t& seed, size_t value)
+        {
+            seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+        }
+    }
+
+    size_t PipelineDesc::hash() const
+    {
+        size_t seed = std::hash<std::string>{}(vertexShader);
+        hash_combine(seed, std::hash<std::string>{}(fragmentShader));
+        for(const std::string& define : defines)
+        {
+            hash_combine(seed, std::hash<std::string>{}(define));
+        }
+        for(const SpecializationConstant& constant : specialization)
+        {
+            hash_combine(seed, constant.id);
+            hash_combine(seed, constant.value);
+        }
+        hash_combine(seed, static_cast<size_t>(topology));
+        hash_combine(seed, static_cast<size_t>(polygonMode));
+        hash_combine(seed, static_cast<size_t>(static_cast<VkCullModeFlags>(cullMode)));
+        hash_combine(seed, static_cast<size_t>(frontFace));
+        hash_combine(seed, static_cast<size_t>(blendEnable));
+        hash_combine(seed, static_cast<size_t>(colorFormat));
+        hash_combine(seed, static_cast<size_t>(depthFormat));
+        hash_combine(seed, static_cast<size_t>(depthTest));
+        hash_combine(seed, static_cast<size_t>(depthWrite));
+        hash_combine(seed, static_cast<size_t>(depthCompare));
+        hash_combine(seed, static_cast<size_t>(samples));
+        return seed;
+    }
 
     /**
      * @brief Creates a Vulkan pipeline_ layout
@@ -15,69 +53,98 @@ namespace vkinit
      * @param debug Flag indicating whether to enable debug logging.
      * @return The created Vulkan pipeline_ layout.
      */
-    vk::PipelineLayout make_pipeline_layout(vk::Device device, bool debug)
+    vk::PipelineLayout make_pipeline_layout(vkutil::LayoutCache& layouts, const PipelineDesc& desc, bool debug)
     {
-        vk::PipelineLayoutCreateInfo layoutInfo;
-        layoutInfo.flags = vk::PipelineLayoutCreateFlags();
-        layoutInfo.setLayoutCount = 0;
-
-        layoutInfo.pushConstantRangeCount = 1;
-        vk::PushConstantRange pushConstantInfo;
-        pushConstantInfo.offset = 0;
-        pushConstantInfo.size = sizeof(vkutil::ObjectData);
-        pushConstantInfo.stageFlags = vk::ShaderStageFlagBits::eVertex;
-        layoutInfo.pPushConstantRanges = &pushConstantInfo;
-
-        try
-        {
-            return device.createPipelineLayout(layoutInfo);
-        }
-        catch(vk::SystemError &err)
+        std::optional<vkutil::PipelineInterface> interface = reflect_pipeline_interface(desc, debug);
+        if(!interface)
         {
-            if(debug)
-            {
-                std::cout << "Failed to create pipeline_ pipeline_layout_!" << std::endl;
-            }
             return vk::PipelineLayout{};
         }
+        return layouts.pipeline_layout(*interface);
     }
     /**
      * @brief Creates a Vulkan render pass.
      *
      * Initializes a render pass for the graphics pipeline_, specifying how color and depth attachments are handled.
+     * Pipelines are created against it, the render graph's passes with the same formats are compatible with it.
+     * The color attachment comes first, then its resolve attachment when multisampled and the depth
+     * attachment last, as the graph orders them.
      *
      * @param device The Vulkan logical device_.
-     * @param swapchainImageFormat The format of the swap chain images.
+     * @param colorFormat The format of the color attachment, eUndefined for none.
+     * @param depthFormat The format of the depth attachment, eUndefined for none.
+     * @param samples The sample count of both attachments, above one the color attachment is resolved.
      * @param debug Flag indicating whether to enable debug logging.
      * @return The created Vulkan render pass.
      */
-    vk::RenderPass make_renderpass(vk::Device device, vk::Format swapchainImageFormat, bool debug)
+    vk::RenderPass make_renderpass(vk::Device device, vk::Format colorFormat, vk::Format depthFormat,
+                                   vk::SampleCountFlagBits samples, bool debug)
     {
-        vk::AttachmentDescription colorAttachment = { };
-        colorAttachment.flags = vk::AttachmentDescriptionFlags();
-        colorAttachment.format = swapchainImageFormat;
-        colorAttachment.samples = vk::SampleCountFlagBits::e1;
-        colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
-        colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
-        colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-        colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-        colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-        colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
-
-        vk::AttachmentReference colorAttachmentRef = { };
-        colorAttachmentRef.attachment = 0;
-        colorAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
-
+        std::vector<vk::AttachmentDescription> attachments;
         vk::SubpassDescription subpass = { };
         subpass.flags = vk::SubpassDescriptionFlags();
         subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-        subpass.colorAttachmentCount = 1;
-        subpass.pColorAttachments = &colorAttachmentRef;
+
+        vk::AttachmentReference colorAttachmentRef = { };
+        if(colorFormat != vk::Format::eUndefined)
+        {
+            vk::AttachmentDescription colorAttachment = { };
+            colorAttachment.flags = vk::AttachmentDescriptionFlags();
+            colorAttachment.format = colorFormat;
+            colorAttachment.samples = samples;
+            colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+            colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+            colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+            colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+            colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
+            colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+
+            colorAttachmentRef.attachment = static_cast<uint32_t>(attachments.size());
+            colorAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
+            attachments.push_back(colorAttachment);
+            subpass.colorAttachmentCount = 1;
+            subpass.pColorAttachments = &colorAttachmentRef;
+        }
+
+        vk::AttachmentReference resolveAttachmentRef = { };
+        if(colorFormat != vk::Format::eUndefined && samples != vk::SampleCountFlagBits::e1)
+        {
+            vk::AttachmentDescription resolveAttachment = attachments.back();
+            resolveAttachment.samples = vk::SampleCountFlagBits::e1;
+            resolveAttachment.loadOp = vk::AttachmentLoadOp::eDontCare;
+            attachments.back().storeOp = vk::AttachmentStoreOp::eDontCare;
+            attachments.back().finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
+
+            resolveAttachmentRef.attachment = static_cast<uint32_t>(attachments.size());
+            resolveAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
+            attachments.push_back(resolveAttachment);
+            subpass.pResolveAttachments = &resolveAttachmentRef;
+        }
+
+        vk::AttachmentReference depthAttachmentRef = { };
+        if(depthFormat != vk::Format::eUndefined)
+        {
+            vk::AttachmentDescription depthAttachment = { };
+            depthAttachment.flags = vk::AttachmentDescriptionFlags();
+            depthAttachment.format = depthFormat;
+            depthAttachment.samples = samples;
+            depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+            depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+            depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+            depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+            depthAttachment.initialLayout = vk::ImageLayout::eUndefined;
+            depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+            depthAttachmentRef.attachment = static_cast<uint32_t>(attachments.size());
+            depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+            attachments.push_back(depthAttachment);
+            subpass.pDepthStencilAttachment = &depthAttachmentRef;
+        }
 
         vk::RenderPassCreateInfo renderpassInfo = { };
         renderpassInfo.flags = vk::RenderPassCreateFlags();
-        renderpassInfo.attachmentCount = 1;
-        renderpassInfo.pAttachments = &colorAttachment;
+        renderpassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderpassInfo.pAttachments = attachments.data();
         renderpassInfo.subpassCount = 1;
         renderpassInfo.pSubpasses = &subpass;
         try
@@ -93,11 +160,257 @@ namespace vkinit
             return vk::RenderPass{};
         }
     }
+    namespace
+    {
+        /**
+         * @struct FixedFunctionState
+         * @brief Every fixed function state block of a pipeline_, filled from a PipelineDesc.
+         *
+         * The create infos point into the struct itself, so it is filled in place and never copied.
+         * Monolithic pipelines use all of it, library parts only the blocks they own.
+         */
+        struct FixedFunctionState
+        {
+            vk::VertexInputBindingDescription bindingDescription;
+            std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
+            vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+            vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
+            vk::PipelineViewportStateCreateInfo viewportState;
+            std::array<vk::DynamicState, 2> dynamicStates;
+            vk::PipelineDynamicStateCreateInfo dynamicState;
+            vk::PipelineRasterizationStateCreateInfo rasterizer;
+            vk::PipelineMultisampleStateCreateInfo multisampling;
+            vk::PipelineDepthStencilStateCreateInfo depthStencil;
+            vk::PipelineColorBlendAttachmentState colorBlendAttachment;
+            vk::PipelineColorBlendStateCreateInfo colorBlending;
+            std::vector<vk::SpecializationMapEntry> specializationEntries;
+            std::vector<uint32_t> specializationData;
+            vk::SpecializationInfo specializationInfo;
+            vk::Format colorFormat;
+            vk::PipelineRenderingCreateInfo rendering;
+        };
+
+        void fill_fixed_function_state(const PipelineDesc& desc, const vkutil::PipelineInterface& interface, FixedFunctionState& state)
+        {
+            // vertex input, laid out after what the vertex shader reads
+            state.bindingDescription = vkmesh::getBindingDescription(interface.vertexInputs);
+            state.attributeDescriptions = vkmesh::getAttributeDescriptions(interface.vertexInputs);
+            state.vertexInputInfo = vk::PipelineVertexInputStateCreateInfo();
+            state.vertexInputInfo.flags = vk::PipelineVertexInputStateCreateFlags();
+            state.vertexInputInfo.vertexBindingDescriptionCount = state.attributeDescriptions.empty() ? 0 : 1;
+            state.vertexInputInfo.pVertexBindingDescriptions = &state.bindingDescription;
+            state.vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.attributeDescriptions.size());
+            state.vertexInputInfo.pVertexAttributeDescriptions = state.attributeDescriptions.data();
+
+            //Input Assembly
+            state.inputAssemblyInfo = vk::PipelineInputAssemblyStateCreateInfo();
+            state.inputAssemblyInfo.flags = vk::PipelineInputAssemblyStateCreateFlags();
+            state.inputAssemblyInfo.topology = desc.topology;
+
+            //viewport and scissor, set while recording so the pipeline_ outlives swap chain resizes
+            state.viewportState = vk::PipelineViewportStateCreateInfo();
+            state.viewportState.flags = vk::PipelineViewportStateCreateFlags();
+            state.viewportState.viewportCount = 1;
+            state.viewportState.pViewports = nullptr;
+            state.viewportState.scissorCount = 1;
+            state.viewportState.pScissors = nullptr;
+            state.dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+            state.dynamicState = vk::PipelineDynamicStateCreateInfo();
+            state.dynamicState.flags = vk::PipelineDynamicStateCreateFlags();
+            state.dynamicState.dynamicStateCount = static_cast<uint32_t>(state.dynamicStates.size());
+            state.dynamicState.pDynamicStates = state.dynamicStates.data();
+
+            //rasterizer
+            state.rasterizer = vk::PipelineRasterizationStateCreateInfo();
+            state.rasterizer.flags = vk::PipelineRasterizationStateCreateFlags();
+            state.rasterizer.depthClampEnable = VK_FALSE;
+            state.rasterizer.rasterizerDiscardEnable = VK_FALSE;
+            state.rasterizer.polygonMode = desc.polygonMode;
+            state.rasterizer.lineWidth = 1.0f;
+            state.rasterizer.cullMode = desc.cullMode;
+            state.rasterizer.frontFace = desc.frontFace;
+            state.rasterizer.depthBiasEnable = VK_FALSE;
+
+            //multisampling
+            state.multisampling = vk::PipelineMultisampleStateCreateInfo();
+            state.multisampling.flags = vk::PipelineMultisampleStateCreateFlags();
+            state.multisampling.sampleShadingEnable = VK_FALSE;
+            state.multisampling.rasterizationSamples = desc.samples;
+
+            //depth, ignored by render passes without a depth attachment
+            state.depthStencil = vk::PipelineDepthStencilStateCreateInfo();
+            state.depthStencil.flags = vk::PipelineDepthStencilStateCreateFlags();
+            state.depthStencil.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+            state.depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+            state.depthStencil.depthCompareOp = desc.depthCompare;
+            state.depthStencil.depthBoundsTestEnable = VK_FALSE;
+            state.depthStencil.stencilTestEnable = VK_FALSE;
+
+            //color blend
+            state.colorBlendAttachment = vk::PipelineColorBlendAttachmentState();
+            state.colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR |
+                                                        vk::ColorComponentFlagBits::eG |
+                                                        vk::ColorComponentFlagBits::eB |
+                                                        vk::ColorComponentFlagBits::eA;
+            state.colorBlendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+            state.colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+            state.colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+            state.colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+            state.colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+            state.colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
+            state.colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
+            state.colorBlending = vk::PipelineColorBlendStateCreateInfo();
+            state.colorBlending.flags = vk::PipelineColorBlendStateCreateFlags();
+            state.colorBlending.logicOpEnable = VK_FALSE;
+            state.colorBlending.logicOp = vk::LogicOp::eCopy;
+            // depth only pipelines have no color attachment to blend
+            state.colorBlending.attachmentCount = desc.colorFormat == vk::Format::eUndefined ? 0 : 1;
+            state.colorBlending.pAttachments = &state.colorBlendAttachment;
+            state.colorBlending.blendConstants[0] = 0.0f;
+            state.colorBlending.blendConstants[1] = 0.0f;
+            state.colorBlending.blendConstants[2] = 0.0f;
+            state.colorBlending.blendConstants[3] = 0.0f;
+
+            //specialization constants, one map shared by both shader stages
+            state.specializationEntries.clear();
+            state.specializationData.clear();
+            for(const SpecializationConstant& constant : desc.specialization)
+            {
+                uint32_t offset = static_cast<uint32_t>(state.specializationData.size() * sizeof(uint32_t));
+                state.specializationEntries.emplace_back(constant.id, offset, sizeof(uint32_t));
+                state.specializationData.push_back(constant.value);
+            }
+            state.specializationInfo = vk::SpecializationInfo();
+            state.specializationInfo.mapEntryCount = static_cast<uint32_t>(state.specializationEntries.size());
+            state.specializationInfo.pMapEntries = state.specializationEntries.data();
+            state.specializationInfo.dataSize = state.specializationData.size() * sizeof(uint32_t);
+            state.specializationInfo.pData = state.specializationData.data();
+
+            //attachment formats, what dynamic rendering has in place of a render pass
+            state.colorFormat = desc.colorFormat;
+            bool stencil = desc.depthFormat == vk::Format::eD16UnormS8Uint || desc.depthFormat == vk::Format::eD24UnormS8Uint ||
+                           desc.depthFormat == vk::Format::eD32SfloatS8Uint;
+            state.rendering = vk::PipelineRenderingCreateInfo();
+            state.rendering.colorAttachmentCount = desc.colorFormat == vk::Format::eUndefined ? 0 : 1;
+            state.rendering.pColorAttachmentFormats = &state.colorFormat;
+            state.rendering.depthAttachmentFormat = desc.depthFormat;
+            state.rendering.stencilAttachmentFormat = stencil ? desc.depthFormat : vk::Format::eUndefined;
+        }
+
+        vk::PipelineShaderStageCreateInfo make_shader_stage(vk::ShaderStageFlagBits stage, vk::ShaderModule shader, const FixedFunctionState& state)
+        {
+            vk::PipelineShaderStageCreateInfo shaderInfo = { };
+            shaderInfo.flags = vk::PipelineShaderStageCreateFlags();
+            shaderInfo.stage = stage;
+            shaderInfo.module = shader;
+            shaderInfo.pName = "main";
+            shaderInfo.pSpecializationInfo = state.specializationEntries.empty() ? nullptr : &state.specializationInfo;
+            return shaderInfo;
+        }
+
+        vk::Pipeline create_pipeline(vk::Device device, vk::PipelineCache cache, const vk::GraphicsPipelineCreateInfo& pipelineInfo, bool debug)
+        {
+            try
+            {
+                return (device.createGraphicsPipeline(cache, pipelineInfo)).value;
+            }
+            catch(vk::SystemError &err)
+            {
+                if(debug)
+                {
+                    std::cout << "Failed to create Graphics Pipeline!" << std::endl;
+                }
+                return vk::Pipeline{};
+            }
+        }
+
+        /**
+         * @brief Whether every specialization constant is set once and declared by one of the stages.
+         */
+        bool check_specialization(const PipelineDesc& desc, const vkutil::ShaderReflection& vertex,
+                                  const vkutil::ShaderReflection& fragment, const std::string& name)
+        {
+            for(size_t i = 0; i < desc.specialization.size(); i++)
+            {
+                uint32_t id = desc.specialization[i].id;
+                for(size_t j = 0; j < i; j++)
+                {
+                    if(desc.specialization[j].id == id)
+                    {
+                        std::cerr << name << ": specialization constant " << id << " is set twice\n";
+                        return false;
+                    }
+                }
+                if(!std::binary_search(vertex.specializationIds.begin(), vertex.specializationIds.end(), id)
+                   && !std::binary_search(fragment.specializationIds.begin(), fragment.specializationIds.end(), id))
+                {
+                    std::cerr << name << ": no shader declares specialization constant " << id << "\n";
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Whether the shaders fit the layout the pipeline_ is built with, when it is known.
+         */
+        bool check_layout(const GraphicsPipelineInBundle& specification, const vkutil::PipelineInterface& interface)
+        {
+            if(specification.layouts == nullptr)
+            {
+                return true;
+            }
+            std::optional<vkutil::PipelineInterface> layout = specification.layouts->find_interface(specification.layout);
+            return !layout || vkutil::is_layout_compatible(*layout, interface, specification.desc.vertexShader + " + " + specification.desc.fragmentShader);
+        }
+    }
+
+    std::optional<ShaderStages> load_shader_stages(const PipelineDesc& desc, bool debug)
+    {
+        ShaderStages stages;
+        stages.vertex = vkutil::loadShader(desc.vertexShader, debug, desc.defines);
+        stages.fragment = vkutil::loadShader(desc.fragmentShader, debug, desc.defines);
+        if(stages.vertex.words.empty() || stages.fragment.words.empty())
+        {
+            return std::nullopt;
+        }
+        std::optional<vkutil::ShaderReflection> vertex = vkutil::reflect_shader(stages.vertex.words, desc.vertexShader);
+        std::optional<vkutil::ShaderReflection> fragment = vkutil::reflect_shader(stages.fragment.words, desc.fragmentShader);
+        if(!vertex || !fragment)
+        {
+            return std::nullopt;
+        }
+        if(vertex->stage != vk::ShaderStageFlagBits::eVertex || fragment->stage != vk::ShaderStageFlagBits::eFragment)
+        {
+            std::cerr << desc.vertexShader << " + " << desc.fragmentShader << ": expected a vertex and a fragment shader\n";
+            return std::nullopt;
+        }
+        std::string name = desc.vertexShader + " + " + desc.fragmentShader;
+        std::optional<vkutil::PipelineInterface> interface = vkutil::link_shader_interface(*vertex, *fragment, name);
+        if(!interface || !check_specialization(desc, *vertex, *fragment, name))
+        {
+            return std::nullopt;
+        }
+        stages.interface = std::move(*interface);
+        return stages;
+    }
+
+    std::optional<vkutil::PipelineInterface> reflect_pipeline_interface(const PipelineDesc& desc, bool debug)
+    {
+        std::optional<ShaderStages> stages = load_shader_stages(desc, debug);
+        if(!stages)
+        {
+            return std::nullopt;
+        }
+        return std::move(stages->interface);
+    }
     /**
      * @brief Creates a Vulkan graphics pipeline_
      *
-     * Sets up the entire graphics pipeline_, including shader stages, viewport and scissor states,
+     * Sets up the entire graphics pipeline_, including shader stages, dynamic viewport and scissor states,
      * rasterization, multisampling, color blending, and more, based on the provided specifications.
+     * When the specification carries a pipeline_ library cache the pipeline_ is linked from library
+     * parts instead of compiled in one piece.
      *
      * @param specification The specifications for creating the graphics pipeline_.
      * @param debug Flag indicating whether to enable debug logging.
@@ -105,160 +418,247 @@ namespace vkinit
      */
     GraphicsPipelineOutBundle create_graphics_pipeline(GraphicsPipelineInBundle specification, bool debug)
     {
+        GraphicsPipelineOutBundle output = {};
+        // the library cache keeps the shaders of the parts it built, so relinking doesn't reload them
+        std::shared_ptr<const ShaderStages> stages;
+        if(specification.libraries != nullptr)
+        {
+            stages = specification.libraries->stages(specification.desc, debug);
+        }
+        else if(std::optional<ShaderStages> loaded = load_shader_stages(specification.desc, debug))
+        {
+            stages = std::make_shared<const ShaderStages>(std::move(*loaded));
+        }
+        if(!stages)
+        {
+            return output;
+        }
 
-        vk::GraphicsPipelineCreateInfo pipelineInfo = { };
+        //pipeline_ pipeline_layout_
+        if(!specification.layout && specification.layouts != nullptr)
+        {
+            if(debug)
+            {
+                std::cout << "Create Pipeline Layout" << std::endl;
+            }
+            specification.layout = specification.layouts->pipeline_layout(stages->interface);
+        }
+        if(!specification.layout || !check_layout(specification, stages->interface))
+        {
+            return output;
+        }
 
-        pipelineInfo.flags = vk::PipelineCreateFlags();
+        //Renderpass
+        if(!specification.renderpass && !specification.dynamicRendering)
+        {
+            if(debug)
+            {
+                std::cout << "Create RenderPass" << std::endl;
+            }
+            specification.renderpass = make_renderpass(specification.device, specification.desc.colorFormat,
+                                                       specification.desc.depthFormat, specification.desc.samples, debug);
+        }
+
+        output.layout = specification.layout;
+        output.renderpass = specification.renderpass;
+
+        if(specification.libraries != nullptr)
+        {
+            std::array<vk::Pipeline, 4> parts = specification.libraries->parts(specification, stages, debug);
+            output.pipeline = link_graphics_pipeline(specification, parts, specification.optimizeLink, debug);
+            return output;
+        }
 
-        std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
-
-        // vertex input
-        vk::VertexInputBindingDescription bindingDescription = vkmesh::getPosColorBindingDescription();
-        std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions = vkmesh::getPosColorAttributeDescriptions();
-        vk::PipelineVertexInputStateCreateInfo vertexInputInfo = { };
-        vertexInputInfo.flags = vk::PipelineVertexInputStateCreateFlags();
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.vertexAttributeDescriptionCount = 2;
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        //Input Assembly
-        vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo = { };
-        inputAssemblyInfo.flags = vk::PipelineInputAssemblyStateCreateFlags();
-//        inputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleList;
-        inputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleStrip;
-        pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+        FixedFunctionState state;
+        fill_fixed_function_state(specification.desc, stages->interface, state);
 
         //vertex shader
         if(debug)
         {
             std::cout << "Create vertex shader module" << std::endl;
         }
-        vk::ShaderModule vertexShader = vkutil::createModule(specification.vertexFilepath, specification.device, debug);
-        vk::PipelineShaderStageCreateInfo vertexShaderInfo = {};
-        vertexShaderInfo.flags = vk::PipelineShaderStageCreateFlags();
-        vertexShaderInfo.stage = vk::ShaderStageFlagBits::eVertex;
-        vertexShaderInfo.module = vertexShader;
-        vertexShaderInfo.pName = "main";
-        shaderStages.push_back(vertexShaderInfo);
-
-        //viewport and scissor
-        vk::Viewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(specification.swapchainExtent.width);
-        viewport.height = static_cast<float>(specification.swapchainExtent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vk::Rect2D scissor = { };
-        scissor.offset.x = 0.0f;
-        scissor.offset.y = 0.0f;
-        scissor.extent = specification.swapchainExtent;
-        vk::PipelineViewportStateCreateInfo viewportState = { };
-        viewportState.flags = vk::PipelineViewportStateCreateFlags();
-        viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
-        viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
-        pipelineInfo.pViewportState = &viewportState;
-
-        //rasterizer
-        vk::PipelineRasterizationStateCreateInfo rasterizer = {};
-        rasterizer.flags = vk::PipelineRasterizationStateCreateFlags();
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = vk::PolygonMode::eFill;
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = vk::CullModeFlagBits::eBack;
-        rasterizer.frontFace = vk::FrontFace::eClockwise;
-        rasterizer.depthBiasEnable = VK_FALSE;
-        pipelineInfo.pRasterizationState = &rasterizer;
-
-        //vertex shader
+        vk::ShaderModule vertexShader = vkutil::createModule(stages->vertex, specification.desc.vertexShader, specification.device, debug);
+        //fragment shader
         if(debug)
         {
             std::cout << "Create fragment shader module" << std::endl;
         }
-        vk::ShaderModule fragmentShader = vkutil::createModule(specification.fragmentFilepath, specification.device, debug);
-        vk::PipelineShaderStageCreateInfo fragmentShaderInfo = {};
-        fragmentShaderInfo.flags = vk::PipelineShaderStageCreateFlags();
-        fragmentShaderInfo.stage = vk::ShaderStageFlagBits::eFragment;
-        fragmentShaderInfo.module = fragmentShader;
-        fragmentShaderInfo.pName = "main";
-        shaderStages.push_back(fragmentShaderInfo);
+        vk::ShaderModule fragmentShader = vkutil::createModule(stages->fragment, specification.desc.fragmentShader, specification.device, debug);
+        std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = {
+                make_shader_stage(vk::ShaderStageFlagBits::eVertex, vertexShader, state),
+                make_shader_stage(vk::ShaderStageFlagBits::eFragment, fragmentShader, state)
+        };
+
+        vk::GraphicsPipelineCreateInfo pipelineInfo = { };
+        pipelineInfo.flags = vk::PipelineCreateFlags();
         pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
         pipelineInfo.pStages = shaderStages.data();
+        pipelineInfo.pVertexInputState = &state.vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &state.inputAssemblyInfo;
+        pipelineInfo.pViewportState = &state.viewportState;
+        pipelineInfo.pDynamicState = &state.dynamicState;
+        pipelineInfo.pRasterizationState = &state.rasterizer;
+        pipelineInfo.pMultisampleState = &state.multisampling;
+        pipelineInfo.pDepthStencilState = &state.depthStencil;
+        pipelineInfo.pColorBlendState = &state.colorBlending;
+        pipelineInfo.layout = specification.layout;
+        pipelineInfo.renderPass = specification.renderpass;
+        if(specification.dynamicRendering)
+        {
+            pipelineInfo.pNext = &state.rendering;
+        }
 
-        //multisampling
-        vk::PipelineMultisampleStateCreateInfo multisampling = { };
-        multisampling.flags = vk::PipelineMultisampleStateCreateFlags();
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
-        pipelineInfo.pMultisampleState = &multisampling;
-
-        //color blend
-        vk::PipelineColorBlendAttachmentState colorBlendAttachment = { };
-        colorBlendAttachment.colorWriteMask =   vk::ColorComponentFlagBits::eR |
-                                                vk::ColorComponentFlagBits::eG |
-                                                vk::ColorComponentFlagBits::eB |
-                                                vk::ColorComponentFlagBits::eA;
-        colorBlendAttachment.blendEnable = VK_FALSE;
-        vk::PipelineColorBlendStateCreateInfo colorBlending = { };
-        colorBlending.flags = vk::PipelineColorBlendStateCreateFlags();
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.logicOp = vk::LogicOp::eCopy;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-        colorBlending.blendConstants[0] = 0.0f;
-        colorBlending.blendConstants[1] = 0.0f;
-        colorBlending.blendConstants[2] = 0.0f;
-        colorBlending.blendConstants[3] = 0.0f;
-        pipelineInfo.pColorBlendState = &colorBlending;
+        //extra stuff
+        pipelineInfo.basePipelineHandle = nullptr;
 
-        //pipeline_ pipeline_layout_
+        //make the pipeline_
         if(debug)
         {
-            std::cout << "Create Pipeline Layout" << std::endl;
+            std::cout << "Create Graphics Pipeline" << std::endl;
         }
-        vk::PipelineLayout layout = make_pipeline_layout(specification.device, debug);
-        pipelineInfo.layout = layout;
+        output.pipeline = create_pipeline(specification.device, specification.pipelineCache, pipelineInfo, debug);
 
-        //Renderpass
-        if(debug)
+        specification.device.destroyShaderModule(vertexShader);
+        specification.device.destroyShaderModule(fragmentShader);
+        return output;
+    }
+    /**
+     * @brief Creates one graphics pipeline_ library part with VK_EXT_graphics_pipeline_library.
+     *
+     * Only the state owned by the part is provided: vertex input and input assembly for the vertex
+     * input interface, the vertex shader, viewport and rasterization for pre-rasterization, the
+     * fragment shader and depth testing for the fragment shader part, and blending and multisampling
+     * for the fragment output interface. Link time optimization info is retained so the parts can later be linked
+     * into an optimized pipeline_.
+     *
+     * @param specification Layout and render pass, or dynamic rendering, must be set, the pipeline_ cache is used if present.
+     * @param part The single part to create.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The library, or a null handle on failure.
+     */
+    vk::Pipeline create_graphics_pipeline_library(const GraphicsPipelineInBundle& specification, const ShaderStages& stages,
+                                                  vk::GraphicsPipelineLibraryFlagBitsEXT part, bool debug)
+    {
+        if(!check_layout(specification, stages.interface))
         {
-            std::cout << "Create RenderPass" << std::endl;
+            return vk::Pipeline{};
         }
-        vk::RenderPass renderpass = make_renderpass(specification.device, specification.swapchainImageFormat, debug);
-        pipelineInfo.renderPass = renderpass;
+        FixedFunctionState state;
+        fill_fixed_function_state(specification.desc, stages.interface, state);
 
-        //extra stuff
-        pipelineInfo.basePipelineHandle = nullptr;
+        vk::GraphicsPipelineLibraryCreateInfoEXT libraryInfo = { };
+        libraryInfo.flags = part;
+        if(specification.dynamicRendering)
+        {
+            // only read by the parts that would otherwise take the render pass
+            libraryInfo.pNext = &state.rendering;
+        }
+        vk::GraphicsPipelineCreateInfo pipelineInfo = { };
+        pipelineInfo.pNext = &libraryInfo;
+        pipelineInfo.flags = vk::PipelineCreateFlagBits::eLibraryKHR | vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
 
-        //make the pipeline_
-        if(debug)
+        vk::ShaderModule shader = nullptr;
+        vk::PipelineShaderStageCreateInfo shaderStage = { };
+        switch(part)
         {
-            std::cout << "Create Graphics Pipeline" << std::endl;
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface:
+                pipelineInfo.pVertexInputState = &state.vertexInputInfo;
+                pipelineInfo.pInputAssemblyState = &state.inputAssemblyInfo;
+                break;
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders:
+                shader = vkutil::createModule(stages.vertex, specification.desc.vertexShader, specification.device, debug);
+                shaderStage = make_shader_stage(vk::ShaderStageFlagBits::eVertex, shader, state);
+                pipelineInfo.stageCount = 1;
+                pipelineInfo.pStages = &shaderStage;
+                pipelineInfo.pViewportState = &state.viewportState;
+                pipelineInfo.pDynamicState = &state.dynamicState;
+                pipelineInfo.pRasterizationState = &state.rasterizer;
+                pipelineInfo.layout = specification.layout;
+                pipelineInfo.renderPass = specification.renderpass;
+                break;
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader:
+                shader = vkutil::createModule(stages.fragment, specification.desc.fragmentShader, specification.device, debug);
+                shaderStage = make_shader_stage(vk::ShaderStageFlagBits::eFragment, shader, state);
+                pipelineInfo.stageCount = 1;
+                pipelineInfo.pStages = &shaderStage;
+                pipelineInfo.pMultisampleState = &state.multisampling;
+                pipelineInfo.pDepthStencilState = &state.depthStencil;
+                pipelineInfo.layout = specification.layout;
+                pipelineInfo.renderPass = specification.renderpass;
+                break;
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface:
+                pipelineInfo.pMultisampleState = &state.multisampling;
+                pipelineInfo.pColorBlendState = &state.colorBlending;
+                pipelineInfo.renderPass = specification.renderpass;
+                break;
+            default:
+                return vk::Pipeline{};
         }
-        vk::Pipeline graphicsPipeline;
+
+        vk::Pipeline library = create_pipeline(specification.device, specification.pipelineCache, pipelineInfo, debug);
+        if(shader)
+        {
+            specification.device.destroyShaderModule(shader);
+        }
+        return library;
+    }
+    /**
+     * @brief Links the four library parts of a pipeline_ into an executable pipeline_.
+     *
+     * A fast link only stitches the parts together and is cheap enough to do while rendering.
+     * An optimized link runs link time optimization across the parts and costs about as much as
+     * a monolithic compile, in exchange for a faster pipeline_.
+     *
+     * @param specification Supplies the device_, pipeline_ cache and layout.
+     * @param libraries The vertex input, pre-rasterization, fragment shader and fragment output parts.
+     * @param optimize Whether to request link time optimization.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The linked pipeline_, or a null handle on failure.
+     */
+    vk::Pipeline link_graphics_pipeline(const GraphicsPipelineInBundle& specification, const std::array<vk::Pipeline, 4>& libraries, bool optimize, bool debug)
+    {
+        for(vk::Pipeline library : libraries)
+        {
+            if(!library)
+            {
+                return vk::Pipeline{};
+            }
+        }
+        vk::PipelineLibraryCreateInfoKHR libraryInfo = { };
+        libraryInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+        libraryInfo.pLibraries = libraries.data();
+        vk::GraphicsPipelineCreateInfo pipelineInfo = { };
+        pipelineInfo.pNext = &libraryInfo;
+        pipelineInfo.flags = optimize ? vk::PipelineCreateFlags(vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT) : vk::PipelineCreateFlags();
+        pipelineInfo.layout = specification.layout;
+        return create_pipeline(specification.device, specification.pipelineCache, pipelineInfo, debug);
+    }
+
+    vk::Pipeline create_compute_pipeline(vk::Device device, vk::PipelineCache cache, vk::PipelineLayout layout, const std::string& shader, bool debug)
+    {
+        vk::ShaderModule module = vkutil::createModule(shader, device, debug);
+        if(!module)
+        {
+            return vk::Pipeline{};
+        }
+        vk::ComputePipelineCreateInfo pipelineInfo = { };
+        pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = layout;
+        vk::Pipeline pipeline;
         try
         {
-            graphicsPipeline = (specification.device.createGraphicsPipeline(nullptr, pipelineInfo)).value;
+            pipeline = device.createComputePipeline(cache, pipelineInfo).value;
         }
         catch(vk::SystemError &err)
         {
             if(debug)
             {
-                std::cout << "Failed to create Graphics Pipeline!"<<std::endl;
+                std::cout << "Failed to create compute pipeline " << shader << std::endl;
             }
         }
-
-        GraphicsPipelineOutBundle output = {};
-        output.layout = layout;
-        output.renderpass = renderpass;
-        output.pipeline = graphicsPipeline;
-
-        specification.device.destroyShaderModule(vertexShader);
-        specification.device.destroyShaderModule(fragmentShader);
-        return output;
+        device.destroyShaderModule(module);
+        return pipeline;
     }
-}
\ No newline at end of file
+}
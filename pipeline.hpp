@@ -12,27 +12,111 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <optional>
 #include <string>
 #include "shaders.hpp"
 #include "render_structs.hpp"
 #include "mesh.hpp"
+#include "layout_cache.hpp"
+
+namespace vkutil
+{
+    class PipelineLibraryCache;
+}
 
 namespace vkinit
 {
+    /**
+     * @struct SpecializationConstant
+     * @brief The value of the specialization constant with a given constant_id.
+     *
+     * Every constant is 32 bits: a bool is a VkBool32 and a float is passed as its bits,
+     * std::bit_cast<uint32_t>(value).
+     */
+    struct SpecializationConstant
+    {
+        uint32_t id = 0;
+        uint32_t value = 0;
+
+        bool operator==(const SpecializationConstant& other) const = default;
+    };
+    /**
+     * @struct PipelineDesc
+     * @brief The state that distinguishes one graphics pipeline_ from another.
+     *
+     * Two equal descriptions always produce interchangeable pipelines, so the hash is used to
+     * deduplicate requests for the same variant. Viewport and scissor are dynamic state and
+     * are not part of the description.
+     *
+     * The attachment formats and sample count pick the render pass the pipeline_ is compatible with,
+     * or with dynamic rendering the formats it is declared to render to.
+     * A color format of eUndefined makes a depth only pipeline_ and a depth format of eUndefined one
+     * without depth.
+     */
+    struct PipelineDesc
+    {
+        std::string vertexShader;
+        std::string fragmentShader;
+        // preprocessor definitions applied to both shaders, "NAME" or "NAME=VALUE"
+        std::vector<std::string> defines;
+        // specialization constants applied to both shaders, each id must be declared by one of them
+        std::vector<SpecializationConstant> specialization;
+        vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+        vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+        vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+        vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+        bool blendEnable = false;
+        vk::Format colorFormat = vk::Format::eUndefined;
+        vk::Format depthFormat = vk::Format::eUndefined;
+        bool depthTest = false;
+        bool depthWrite = false;
+        vk::CompareOp depthCompare = vk::CompareOp::eLess;
+        vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+
+        bool operator==(const PipelineDesc& other) const = default;
+        /**
+         * @brief Combines every field into a single hash value.
+         */
+        [[nodiscard]] size_t hash() const;
+    };
+    /**
+     * @struct PipelineDescHash
+     * @brief Hash functor so PipelineDesc can key unordered containers.
+     */
+    struct PipelineDescHash
+    {
+        size_t operator()(const PipelineDesc& desc) const
+        {
+            return desc.hash();
+        }
+    };
     /**
      * @struct GraphicsPipelineInBundle
      * @brief Holds parameters required for creating a Vulkan graphics pipeline_.
      *
-     * This structures includes the Vulkan device_, file paths for vertex and fragment shaders,
-     * and specifications related to the swap chain such as image format and extent.
+     * This structures includes the Vulkan device_, the description of the pipeline_ state and the
+     * pipeline_ cache to compile through. A null render pass is created alongside the pipeline_ from
+     * the description's attachment formats; pipelines sharing one pass their own and keep ownership.
+     * With dynamicRendering there is no render pass, the formats are chained in a
+     * vk::PipelineRenderingCreateInfo instead and the device_ must have dynamic rendering enabled.
+     *
+     * With a library cache the pipeline_ is linked from VK_EXT_graphics_pipeline_library parts,
+     * optimizeLink choosing between a fast link and a link time optimized one.
+     *
+     * With a layout cache a null layout is taken from it, and a given layout that came from it is
+     * checked against what the shaders declare before anything is compiled.
      */
     struct GraphicsPipelineInBundle
     {
         vk::Device device;
-        std::string vertexFilepath;
-        std::string fragmentFilepath;
-        vk::Extent2D swapchainExtent;
-        vk::Format swapchainImageFormat;
+        PipelineDesc desc;
+        vk::PipelineCache pipelineCache;
+        vk::PipelineLayout layout;
+        vk::RenderPass renderpass;
+        bool dynamicRendering = false;
+        vkutil::PipelineLibraryCache* libraries = nullptr;
+        vkutil::LayoutCache* layouts = nullptr;
+        bool optimizeLink = false;
     };
     /**
      * @struct GraphicsPipelineOutBundle
@@ -46,31 +130,64 @@ namespace vkinit
         vk::RenderPass renderpass;
         vk::Pipeline pipeline;
     };
+    /**
+     * @struct ShaderStages
+     * @brief The loaded code of both shaders of a description and the interface they declare together.
+     */
+    struct ShaderStages
+    {
+        vkutil::ShaderCode vertex;
+        vkutil::ShaderCode fragment;
+        vkutil::PipelineInterface interface;
+    };
+    /**
+     * @brief Loads and reflects both shaders of a description, checking that the stages agree and
+     * that every specialization constant is declared.
+     *
+     * @param desc The pipeline_ whose shaders to load.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The shader code and their interface, or nullopt with the reason printed.
+     */
+    std::optional<ShaderStages> load_shader_stages(const PipelineDesc& desc, bool debug);
+    /**
+     * @brief Loads and reflects the shaders of a description, checking that the stages agree.
+     *
+     * @param desc The pipeline_ whose shaders to reflect.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The descriptor sets, push constants and vertex inputs the shaders declare, or nullopt
+     *         with the reason printed.
+     */
+    std::optional<vkutil::PipelineInterface> reflect_pipeline_interface(const PipelineDesc& desc, bool debug);
     /**
      * @brief Creates a Vulkan pipeline_ layout
      *
-     * Initializes a pipeline_ layout necessary for a Vulkan graphics pipeline_, including push constants
+     * Derives the descriptor set layouts and push constant ranges from the reflected shaders of a
+     * description, shared with every other description whose shaders declare the same resources.
      *
-     * @param device The Vulkan logical device_.
+     * @param layouts The cache that creates and owns the layout.
+     * @param desc The pipeline_ whose shaders to reflect.
      * @param debug Flag indicating whether to enable debug logging.
-     * @return The created Vulkan pipeline_ layout.
+     * @return The pipeline_ layout, or a null handle if the shaders can't be loaded or don't agree.
      */
-    vk::PipelineLayout make_pipeline_layout(vk::Device device, bool debug);
+    vk::PipelineLayout make_pipeline_layout(vkutil::LayoutCache& layouts, const PipelineDesc& desc, bool debug);
     /**
      * @brief Creates a Vulkan render pass.
      *
      * Initializes a render pass for the graphics pipeline_, specifying how color and depth attachments are handled.
      *
      * @param device The Vulkan logical device_.
-     * @param swapchainImageFormat The format of the swap chain images.
+     * @param colorFormat The format of the color attachment, eUndefined for none.
+     * @param depthFormat The format of the depth attachment, eUndefined for none.
+     * @param samples The sample count of both attachments, above one the color attachment is resolved.
      * @param debug Flag indicating whether to enable debug logging.
      * @return The created Vulkan render pass.
      */
-    vk::RenderPass make_renderpass(vk::Device device, vk::Format swapchainImageFormat, bool debug);
+    vk::RenderPass make_renderpass(vk::Device device, vk::Format colorFormat, vk::Format depthFormat,
+                                   vk::SampleCountFlagBits samples, bool debug);
     /**
      * @brief Creates a Vulkan graphics pipeline_
      *
-     * Sets up the entire graphics pipeline_, including shader stages, viewport and scissor states,
+     * Sets up the entire graphics pipeline_, including shader stages, dynamic viewport and scissor states,
      * rasterization, multisampling, color blending, and more, based on the provided specifications.
      *
      * @param specification The specifications for creating the graphics pipeline_.
@@ -78,5 +195,37 @@ namespace vkinit
      * @return A bundle containing the components of the created graphics pipeline_.
      */
     GraphicsPipelineOutBundle create_graphics_pipeline(GraphicsPipelineInBundle specification, bool debug);
+    /**
+     * @brief Creates one graphics pipeline_ library part with VK_EXT_graphics_pipeline_library.
+     *
+     * @param specification Layout and render pass, or dynamic rendering, must be set, the pipeline_ cache is used if present.
+     * @param stages The shaders of the description, from load_shader_stages().
+     * @param part The single part to create.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The library, or a null handle on failure.
+     */
+    vk::Pipeline create_graphics_pipeline_library(const GraphicsPipelineInBundle& specification, const ShaderStages& stages,
+                                                  vk::GraphicsPipelineLibraryFlagBitsEXT part, bool debug);
+    /**
+     * @brief Links the four library parts of a pipeline_ into an executable pipeline_.
+     *
+     * @param specification Supplies the device_, pipeline_ cache and layout.
+     * @param libraries The vertex input, pre-rasterization, fragment shader and fragment output parts.
+     * @param optimize Whether to request link time optimization.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The linked pipeline_, or a null handle on failure.
+     */
+    vk::Pipeline link_graphics_pipeline(const GraphicsPipelineInBundle& specification, const std::array<vk::Pipeline, 4>& libraries, bool optimize, bool debug);
+    /**
+     * @brief Creates a Vulkan compute pipeline_ from a compute shader.
+     *
+     * @param device The Vulkan logical device_.
+     * @param cache The pipeline_ cache to create it through, may be null.
+     * @param layout The pipeline_ layout matching the shader's resources.
+     * @param shader The shader name, such as "cull.comp".
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return The pipeline_, or a null handle if the shader can't be loaded or creation failed.
+     */
+    vk::Pipeline create_compute_pipeline(vk::Device device, vk::PipelineCache cache, vk::PipelineLayout layout, const std::string& shader, bool debug);
 }
 #endif //INC_3DLOADERVK_PIPELINE_HPP
@@ -0,0 +1,243 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "pipeline_cache.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+namespace vkutil
+{
+    namespace
+    {
+        constexpr uint32_t kCacheMagic = 0x43504B56; // "VKPC"
+        constexpr uint32_t kCacheVersion = 1;
+        // size of VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, UUID
+        constexpr size_t kDriverHeaderSize = 16 + VK_UUID_SIZE;
+
+        uint64_t Checksum(const uint8_t* data, size_t size)
+        {
+            // FNV-1a, enough to catch truncation and bit rot
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for(size_t i = 0; i < size; i++)
+            {
+                hash ^= data[i];
+                hash *= 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        uint32_t ReadU32(const uint8_t* data)
+        {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+    }
+
+    PipelineCache::PipelineCache(vk::Device device, vk::PhysicalDevice physical_device, std::string path, bool debug)
+        : path_(std::move(path))
+    {
+        device_ = device;
+        properties_ = physical_device.getProperties();
+        debug_ = debug;
+
+        std::vector<uint8_t> initial_data = Load();
+        warm_ = !initial_data.empty();
+
+        vk::PipelineCacheCreateInfo createInfo = { };
+        createInfo.flags = vk::PipelineCacheCreateFlags();
+        createInfo.initialDataSize = initial_data.size();
+        createInfo.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+        try
+        {
+            cache_ = device_.createPipelineCache(createInfo);
+        }
+        catch(vk::SystemError &err)
+        {
+            if(!warm_)
+            {
+                throw;
+            }
+            // the driver rejected data that passed our checks, start over with an empty cache
+            if(debug_)
+            {
+                std::cout << "Driver rejected the pipeline cache in " << path_ << ": " << err.what() << std::endl;
+            }
+            warm_ = false;
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+            cache_ = device_.createPipelineCache(createInfo);
+        }
+        if(debug_)
+        {
+            std::cout << (warm_ ? "Loaded pipeline cache from " : "Starting with an empty pipeline cache, will write ")
+                      << path_ << "\n";
+        }
+    }
+
+    PipelineCache::~PipelineCache()
+    {
+        device_.destroyPipelineCache(cache_);
+    }
+
+    vk::PipelineCache PipelineCache::get() const
+    {
+        return cache_;
+    }
+
+    bool PipelineCache::warm() const
+    {
+        return warm_;
+    }
+
+    vk::PipelineCache PipelineCache::make_thread_cache()
+    {
+        vk::PipelineCacheCreateInfo createInfo = { };
+        createInfo.flags = vk::PipelineCacheCreateFlags();
+        return device_.createPipelineCache(createInfo);
+    }
+
+    void PipelineCache::merge(vk::PipelineCache thread_cache)
+    {
+        {
+            // vkMergePipelineCaches requires the destination to be externally synchronized
+            std::lock_guard<std::mutex> lock(merge_mutex_);
+            device_.mergePipelineCaches(cache_, thread_cache);
+        }
+        device_.destroyPipelineCache(thread_cache);
+    }
+
+    /**
+     * @brief Writes the header and cache data next to the target, then renames it over the target.
+     *
+     * The rename is atomic, so a crash or a second instance exiting at the same time leaves either
+     * the old file or the new one on disk, never a partially written cache.
+     */
+    bool PipelineCache::save()
+    {
+        std::vector<uint8_t> data;
+        {
+            std::lock_guard<std::mutex> lock(merge_mutex_);
+            data = device_.getPipelineCacheData(cache_);
+        }
+        if(data.empty())
+        {
+            return false;
+        }
+
+        PipelineCacheFileHeader header = { };
+        header.magic = kCacheMagic;
+        header.version = kCacheVersion;
+        header.vendorID = properties_.vendorID;
+        header.deviceID = properties_.deviceID;
+        header.driverVersion = properties_.driverVersion;
+        std::memcpy(header.pipelineCacheUUID, properties_.pipelineCacheUUID.data(), VK_UUID_SIZE);
+        header.dataSize = data.size();
+        header.checksum = Checksum(data.data(), data.size());
+
+        std::string temp_path = path_ + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), static_cast<std::streamsize>(sizeof(header)));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            file.flush();
+            if(!file)
+            {
+                if(debug_)
+                {
+                    std::cout << "Failed to write pipeline cache to " << temp_path << "\n";
+                }
+                std::error_code ignored;
+                std::filesystem::remove(temp_path, ignored);
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temp_path, path_, error);
+        if(error)
+        {
+            if(debug_)
+            {
+                std::cout << "Failed to replace pipeline cache " << path_ << ": " << error.message() << "\n";
+            }
+            std::filesystem::remove(temp_path, error);
+            return false;
+        }
+        if(debug_)
+        {
+            std::cout << "Saved " << data.size() << " bytes of pipeline cache to " << path_ << "\n";
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads the cache file and returns its data if it belongs to this device and driver.
+     * @return The driver's cache data, or nothing if the file is missing, stale or damaged.
+     */
+    std::vector<uint8_t> PipelineCache::Load()
+    {
+        std::ifstream file(path_, std::ios::binary | std::ios::ate);
+        if(!file)
+        {
+            return { };
+        }
+        std::streamsize file_size = static_cast<std::streamsize>(file.tellg());
+        file.seekg(0);
+
+        auto reject = [this](const char* reason) {
+            if(debug_)
+            {
+                std::cout << "Ignoring pipeline cache " << path_ << ": " << reason << "\n";
+            }
+            return std::vector<uint8_t>();
+        };
+
+        PipelineCacheFileHeader header = { };
+        if(file_size < static_cast<std::streamsize>(sizeof(header))
+           || !file.read(reinterpret_cast<char*>(&header), static_cast<std::streamsize>(sizeof(header))))
+        {
+            return reject("file too small");
+        }
+        if(header.magic != kCacheMagic || header.version != kCacheVersion)
+        {
+            return reject("unknown file format");
+        }
+        if(header.vendorID != properties_.vendorID || header.deviceID != properties_.deviceID)
+        {
+            return reject("written for a different device");
+        }
+        if(header.driverVersion != properties_.driverVersion
+           || std::memcmp(header.pipelineCacheUUID, properties_.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0)
+        {
+            return reject("written by a different driver");
+        }
+        if(header.dataSize != static_cast<uint64_t>(file_size) - sizeof(header) || header.dataSize < kDriverHeaderSize)
+        {
+            return reject("truncated");
+        }
+
+        std::vector<uint8_t> data(header.dataSize);
+        if(!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())))
+        {
+            return reject("read failed");
+        }
+        if(Checksum(data.data(), data.size()) != header.checksum)
+        {
+            return reject("checksum mismatch");
+        }
+
+        // the driver's own header must agree with ours, otherwise the data was tampered with
+        uint32_t header_size = ReadU32(data.data());
+        uint32_t header_version = ReadU32(data.data() + 4);
+        if(header_size < kDriverHeaderSize || header_size > data.size()
+           || header_version != static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne)
+           || ReadU32(data.data() + 8) != properties_.vendorID
+           || ReadU32(data.data() + 12) != properties_.deviceID
+           || std::memcmp(data.data() + 16, properties_.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0)
+        {
+            return reject("driver header mismatch");
+        }
+        return data;
+    }
+}
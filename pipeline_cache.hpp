@@ -0,0 +1,94 @@
+/**
+ * @file pipeline_cache.hpp
+ * @brief Defines the PipelineCache class, a VkPipelineCache persisted to disk between runs.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_PIPELINE_CACHE_HPP
+#define INC_3DLOADERVK_PIPELINE_CACHE_HPP
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vkutil
+{
+    /**
+     * @struct PipelineCacheFileHeader
+     * @brief Prefix written in front of the driver's cache data on disk.
+     *
+     * The driver's own header identifies the device, but not the driver version, so a cache written
+     * by an older driver would be handed straight back to it. This header records both, along with
+     * the size and a checksum of the data to reject truncated or corrupted files.
+     */
+    struct PipelineCacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+
+    /**
+     * @class PipelineCache
+     * @brief Owns the VkPipelineCache every pipeline is created through.
+     *
+     * The cache is seeded from disk when the file matches the current device and driver, otherwise it
+     * starts empty. Threads compiling pipelines in parallel get their own caches which are merged back,
+     * and save() writes the result to a temporary file that atomically replaces the old one.
+     */
+    class PipelineCache
+    {
+    public:
+        /**
+         * @brief Creates the pipeline cache, seeded from the file at path if it is valid.
+         * @param device The Vulkan logical device.
+         * @param physical_device The physical device the cache data must belong to.
+         * @param path Where the cache is loaded from and saved to.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        PipelineCache(vk::Device device, vk::PhysicalDevice physical_device, std::string path, bool debug);
+        ~PipelineCache();
+        PipelineCache(const PipelineCache&) = delete;
+        PipelineCache& operator=(const PipelineCache&) = delete;
+        /**
+         * @brief The cache handle to pass to pipeline creation.
+         */
+        [[nodiscard]] vk::PipelineCache get() const;
+        /**
+         * @brief Whether the cache was seeded with data from a previous run.
+         */
+        [[nodiscard]] bool warm() const;
+        /**
+         * @brief Creates an empty cache for a worker thread, avoiding contention on the main one.
+         * @return A new cache, to be handed back with merge().
+         */
+        vk::PipelineCache make_thread_cache();
+        /**
+         * @brief Merges a worker thread's cache into the main one and destroys it.
+         * @param thread_cache A cache returned by make_thread_cache().
+         */
+        void merge(vk::PipelineCache thread_cache);
+        /**
+         * @brief Writes the cache to disk, replacing the previous file atomically.
+         * @return true if the file was written.
+         */
+        bool save();
+    private:
+        std::vector<uint8_t> Load();
+
+        vk::Device device_;
+        vk::PhysicalDeviceProperties properties_;
+        std::string path_;
+        bool debug_;
+        bool warm_;
+        vk::PipelineCache cache_;
+        std::mutex merge_mutex_;
+    };
+}
+#endif //INC_3DLOADERVK_PIPELINE_CACHE_HPP
@@ -0,0 +1,221 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "pipeline_library.hpp"
+#include <algorithm>
+#include <iterator>
+namespace vkutil
+{
+    namespace
+    {
+        constexpr std::array<vk::GraphicsPipelineLibraryFlagBitsEXT, PipelineLibraryCache::kPartCount> kParts = {
+                vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+                vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders,
+                vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+                vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface
+        };
+    }
+
+    PipelineLibraryCache::PipelineLibraryCache(vk::Device device)
+    {
+        device_ = device;
+    }
+
+    PipelineLibraryCache::~PipelineLibraryCache()
+    {
+        clear();
+    }
+
+    std::shared_ptr<const vkinit::ShaderStages> PipelineLibraryCache::stages(const vkinit::PipelineDesc& desc, bool debug)
+    {
+        vkinit::PipelineDesc key = ShaderKey(desc);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = stages_.find(key);
+            if(found != stages_.end())
+            {
+                return found->second;
+            }
+        }
+        // loaded outside the lock, shader I/O and reflection must not hold up a fast link
+        std::optional<vkinit::ShaderStages> loaded = vkinit::load_shader_stages(desc, debug);
+        if(!loaded)
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto entry = stages_.emplace(key, std::make_shared<const vkinit::ShaderStages>(std::move(*loaded))).first;
+        return entry->second;
+    }
+
+    std::array<vk::Pipeline, PipelineLibraryCache::kPartCount> PipelineLibraryCache::parts(const vkinit::GraphicsPipelineInBundle& specification,
+                                                                                         const std::shared_ptr<const vkinit::ShaderStages>& stages, bool debug)
+    {
+        std::array<vk::Pipeline, kPartCount> result;
+        for(size_t part = 0; part < kPartCount; part++)
+        {
+            vkinit::PipelineDesc key = PartKey(specification.desc, part);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto found = parts_[part].find(key);
+                if(found != parts_[part].end())
+                {
+                    result[part] = found->second.library;
+                    continue;
+                }
+            }
+            // built outside the lock, if another thread raced us to the same part ours is dropped
+            vk::Pipeline library = vkinit::create_graphics_pipeline_library(specification, *stages, kParts[part], debug);
+            if(!library)
+            {
+                result[part] = library;
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            // only the shader parts are created with the layout
+            bool shaders = kParts[part] == vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders
+                           || kParts[part] == vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader;
+            auto [entry, inserted] = parts_[part].emplace(key, Part{ library, shaders ? specification.layout : vk::PipelineLayout{} });
+            if(!inserted)
+            {
+                device_.destroyPipeline(library);
+            }
+            result[part] = entry->second.library;
+        }
+        return result;
+    }
+
+    vk::Pipeline PipelineLibraryCache::fast_link(const vkinit::PipelineDesc& desc, vk::PipelineCache cache, bool debug)
+    {
+        vkinit::GraphicsPipelineInBundle specification = { };
+        specification.device = device_;
+        specification.pipelineCache = cache;
+        std::array<vk::Pipeline, kPartCount> libraries;
+        // held across the link, so invalidate() can't destroy a part being linked
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(size_t part = 0; part < kPartCount; part++)
+        {
+            auto found = parts_[part].find(PartKey(desc, part));
+            if(found == parts_[part].end())
+            {
+                return vk::Pipeline{};
+            }
+            libraries[part] = found->second.library;
+            // the shader parts must agree on the layout the pipeline_ is linked with
+            if(found->second.layout)
+            {
+                if(specification.layout && specification.layout != found->second.layout)
+                {
+                    return vk::Pipeline{};
+                }
+                specification.layout = found->second.layout;
+            }
+        }
+        return vkinit::link_graphics_pipeline(specification, libraries, false, debug);
+    }
+
+    void PipelineLibraryCache::invalidate(const std::vector<std::string>& shaders)
+    {
+        auto stale = [&shaders](const vkinit::PipelineDesc& key)
+        {
+            return std::find_if(shaders.begin(), shaders.end(), [&key](const std::string& name)
+            {
+                return name == key.vertexShader || name == key.fragmentShader;
+            }) != shaders.end();
+        };
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto& libraries : parts_)
+        {
+            for(auto entry = libraries.begin(); entry != libraries.end();)
+            {
+                if(!stale(entry->first))
+                {
+                    ++entry;
+                    continue;
+                }
+                device_.destroyPipeline(entry->second.library);
+                entry = libraries.erase(entry);
+            }
+        }
+        for(auto entry = stages_.begin(); entry != stages_.end();)
+        {
+            entry = stale(entry->first) ? stages_.erase(entry) : std::next(entry);
+        }
+    }
+
+    void PipelineLibraryCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto& libraries : parts_)
+        {
+            for(auto& entry : libraries)
+            {
+                device_.destroyPipeline(entry.second.library);
+            }
+            libraries.clear();
+        }
+    }
+
+    /**
+     * @brief Keeps only the fields of a description that the given part depends on.
+     */
+    vkinit::PipelineDesc PipelineLibraryCache::PartKey(const vkinit::PipelineDesc& desc, size_t part)
+    {
+        vkinit::PipelineDesc key = { };
+        switch(kParts[part])
+        {
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface:
+                // the vertex layout is reflected from the vertex shader
+                key.vertexShader = desc.vertexShader;
+                key.defines = desc.defines;
+                key.topology = desc.topology;
+                break;
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders:
+                key.vertexShader = desc.vertexShader;
+                key.defines = desc.defines;
+                key.specialization = desc.specialization;
+                key.polygonMode = desc.polygonMode;
+                key.cullMode = desc.cullMode;
+                key.frontFace = desc.frontFace;
+                // the render pass the part is created with follows the attachments
+                key.colorFormat = desc.colorFormat;
+                key.depthFormat = desc.depthFormat;
+                key.samples = desc.samples;
+                break;
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader:
+                key.fragmentShader = desc.fragmentShader;
+                key.defines = desc.defines;
+                key.specialization = desc.specialization;
+                key.depthTest = desc.depthTest;
+                key.depthWrite = desc.depthWrite;
+                key.depthCompare = desc.depthCompare;
+                key.colorFormat = desc.colorFormat;
+                key.depthFormat = desc.depthFormat;
+                key.samples = desc.samples;
+                break;
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface:
+                key.blendEnable = desc.blendEnable;
+                key.colorFormat = desc.colorFormat;
+                key.depthFormat = desc.depthFormat;
+                key.samples = desc.samples;
+                break;
+            default:
+                break;
+        }
+        return key;
+    }
+
+    /**
+     * @brief Keeps only the fields of a description that loading and checking its shaders depends on.
+     */
+    vkinit::PipelineDesc PipelineLibraryCache::ShaderKey(const vkinit::PipelineDesc& desc)
+    {
+        vkinit::PipelineDesc key = { };
+        key.vertexShader = desc.vertexShader;
+        key.fragmentShader = desc.fragmentShader;
+        key.defines = desc.defines;
+        key.specialization = desc.specialization;
+        return key;
+    }
+}
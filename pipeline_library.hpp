@@ -0,0 +1,92 @@
+/**
+ * @file pipeline_library.hpp
+ * @brief Defines the PipelineLibraryCache class, which shares graphics pipeline library parts between pipelines.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_PIPELINE_LIBRARY_HPP
+#define INC_3DLOADERVK_PIPELINE_LIBRARY_HPP
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pipeline.hpp"
+
+namespace vkutil
+{
+    /**
+     * @class PipelineLibraryCache
+     * @brief Keeps the VK_EXT_graphics_pipeline_library parts built so far, keyed on the state they own.
+     *
+     * Each part is keyed on the fields of the PipelineDesc it depends on, so two pipelines that only
+     * differ in blending share their vertex input, pre-rasterization and fragment shader parts and
+     * only need a new fragment output part. The shader code and reflected interface the parts were
+     * built from are kept too, along with the layout of each part, so new parts reuse the loaded
+     * shaders and a fast link touches neither the shaders nor the file system. Thread safe.
+     */
+    class PipelineLibraryCache
+    {
+    public:
+        static constexpr size_t kPartCount = 4;
+
+        explicit PipelineLibraryCache(vk::Device device);
+        ~PipelineLibraryCache();
+        PipelineLibraryCache(const PipelineLibraryCache&) = delete;
+        PipelineLibraryCache& operator=(const PipelineLibraryCache&) = delete;
+        /**
+         * @brief Returns the loaded and reflected shaders of a description, loading them on first use.
+         * @return The shaders, or null when they failed to load, with the reason printed.
+         */
+        std::shared_ptr<const vkinit::ShaderStages> stages(const vkinit::PipelineDesc& desc, bool debug);
+        /**
+         * @brief Returns the four parts of a pipeline_, creating the ones that don't exist yet.
+         * @param specification The pipeline_ being built, layout and render pass must be set.
+         * @param stages The shaders of the description, from stages().
+         * @param debug Flag indicating whether to enable debug logging.
+         * @return The parts in link order, a failed part is a null handle.
+         */
+        std::array<vk::Pipeline, kPartCount> parts(const vkinit::GraphicsPipelineInBundle& specification,
+                                                   const std::shared_ptr<const vkinit::ShaderStages>& stages, bool debug);
+        /**
+         * @brief Fast links a pipeline_ from parts that already exist, with the layout they were built with.
+         *
+         * Never loads a shader or creates a part, so it is cheap enough to call while rendering.
+         *
+         * @param desc The pipeline_ to link.
+         * @param cache The pipeline_ cache to link through.
+         * @param debug Flag indicating whether to enable debug logging.
+         * @return The linked pipeline_, or a null handle when a part is missing or the link failed.
+         */
+        vk::Pipeline fast_link(const vkinit::PipelineDesc& desc, vk::PipelineCache cache, bool debug);
+        /**
+         * @brief Destroys the parts and drops the shader code built from any of the given shaders, so they get rebuilt.
+         *
+         * Pipelines already linked from them stay valid. The caller must make sure no link using
+         * them is in progress.
+         */
+        void invalidate(const std::vector<std::string>& shaders);
+        /**
+         * @brief Destroys every part, for when the layout or render pass they were built against changes.
+         *
+         * The loaded shaders don't depend on either and are kept.
+         */
+        void clear();
+    private:
+        struct Part
+        {
+            vk::Pipeline library;
+            vk::PipelineLayout layout;
+        };
+
+        static vkinit::PipelineDesc PartKey(const vkinit::PipelineDesc& desc, size_t part);
+        static vkinit::PipelineDesc ShaderKey(const vkinit::PipelineDesc& desc);
+
+        vk::Device device_;
+        mutable std::mutex mutex_;
+        std::array<std::unordered_map<vkinit::PipelineDesc, Part, vkinit::PipelineDescHash>, kPartCount> parts_;
+        std::unordered_map<vkinit::PipelineDesc, std::shared_ptr<const vkinit::ShaderStages>, vkinit::PipelineDescHash> stages_;
+    };
+}
+#endif //INC_3DLOADERVK_PIPELINE_LIBRARY_HPP
@@ -0,0 +1,483 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "pipeline_state_cache.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+namespace vkutil
+{
+    PipelineStateCache::PipelineStateCache(vk::Device device, PipelineCache& pipeline_cache, LayoutCache& layouts, vk::PipelineLayout layout,
+                                           bool use_pipeline_library, bool dynamic_rendering, bool debug)
+        : pipeline_cache_(pipeline_cache), layouts_(layouts), libraries_(device)
+    {
+        device_ = device;
+        use_library_ = use_pipeline_library;
+        dynamic_rendering_ = dynamic_rendering;
+        layout_ = layout;
+        debug_ = debug;
+        stop_ = false;
+        generation_ = 0;
+        compile_thread_ = std::thread(&PipelineStateCache::CompileLoop, this);
+    }
+
+    PipelineStateCache::~PipelineStateCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            queue_.clear();
+        }
+        queue_changed_.notify_all();
+        compile_thread_.join();
+        DestroyAll();
+        for(auto& entry : renderpasses_)
+        {
+            device_.destroyRenderPass(entry.second);
+        }
+    }
+
+    vk::Pipeline PipelineStateCache::get(const vkinit::PipelineDesc& desc)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = pipelines_.find(desc);
+            if(found != pipelines_.end())
+            {
+                return found->second;
+            }
+        }
+        // compile outside the lock, a concurrent request for the same desc loses the race below
+        vk::Pipeline pipeline;
+        {
+            std::lock_guard<std::mutex> compiling(compile_mutex_);
+            pipeline = Compile(desc, pipeline_cache_.get(), debug_, true);
+        }
+        if(!pipeline)
+        {
+            return pipeline;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [entry, inserted] = pipelines_.emplace(desc, pipeline);
+        if(!inserted)
+        {
+            device_.destroyPipeline(pipeline);
+        }
+        return entry->second;
+    }
+
+    /**
+     * @brief Returns the pipeline_ for a description without ever blocking on compilation.
+     *
+     * With graphics pipeline_ libraries, a variant whose parts all exist is fast linked right away,
+     * which costs next to nothing, and the optimized link is left to the background thread. That is
+     * skipped while the background thread is busy, since it may be replacing the very parts needed.
+     */
+    vk::Pipeline PipelineStateCache::get_async(const vkinit::PipelineDesc& desc)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = pipelines_.find(desc);
+            if(found != pipelines_.end())
+            {
+                return found->second;
+            }
+            if(queued_.find(desc) != queued_.end())
+            {
+                return Fallback();
+            }
+        }
+        std::chrono::steady_clock::time_point requested = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> compiling(compile_mutex_, std::try_to_lock);
+        if(use_library_ && compiling.owns_lock())
+        {
+            vk::Pipeline pipeline = libraries_.fast_link(desc, pipeline_cache_.get(), false);
+            compiling.unlock();
+            if(pipeline)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto [entry, inserted] = pipelines_.emplace(desc, pipeline);
+                if(!inserted)
+                {
+                    device_.destroyPipeline(pipeline);
+                    return entry->second;
+                }
+                RecordReady(requested);
+                Enqueue({ desc, requested, CompileKind::eOptimize });
+                return pipeline;
+            }
+        }
+        else if(compiling.owns_lock())
+        {
+            compiling.unlock();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(queued_.emplace(desc, true).second)
+        {
+            Enqueue({ desc, requested, CompileKind::eBuild });
+        }
+        return Fallback();
+    }
+
+    void PipelineStateCache::set_fallback(const vkinit::PipelineDesc& desc)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fallback_ = desc;
+    }
+
+    /**
+     * @brief Rebuilds every pipeline_ that uses one of the given shaders.
+     *
+     * The current pipelines stay in use until the rebuilt ones are swapped in by apply_swaps().
+     */
+    void PipelineStateCache::reload(const std::vector<std::string>& shaders)
+    {
+        auto is_changed = [&shaders](const std::string& name)
+        {
+            return !name.empty() && std::find(shaders.begin(), shaders.end(), name) != shaders.end();
+        };
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::chrono::steady_clock::time_point requested = std::chrono::steady_clock::now();
+        size_t rebuilt = 0;
+        for(const auto& entry : pipelines_)
+        {
+            bool vertex = is_changed(entry.first.vertexShader);
+            bool fragment = is_changed(entry.first.fragmentShader);
+            if(!vertex && !fragment)
+            {
+                continue;
+            }
+            if(vertex)
+            {
+                stale_shaders_.push_back(entry.first.vertexShader);
+            }
+            if(fragment)
+            {
+                stale_shaders_.push_back(entry.first.fragmentShader);
+            }
+            Enqueue({ entry.first, requested, CompileKind::eReload });
+            rebuilt++;
+        }
+        if(debug_)
+        {
+            std::cout << "Reloading " << rebuilt << " pipelines for " << shaders.size() << " changed shaders\n";
+        }
+    }
+
+    /**
+     * @brief Puts every pipeline_ rebuilt in the background in place of the one it replaces.
+     *
+     * Called by the render thread between frames, so a frame never mixes old and new versions.
+     *
+     * @return The replaced pipelines, to be destroyed once no frame in flight uses them.
+     */
+    std::vector<vk::Pipeline> PipelineStateCache::apply_swaps()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<vk::Pipeline> replaced;
+        for(auto& swap : swaps_)
+        {
+            auto found = pipelines_.find(swap.first);
+            if(found == pipelines_.end())
+            {
+                replaced.push_back(swap.second);
+                continue;
+            }
+            replaced.push_back(found->second);
+            found->second = swap.second;
+        }
+        swaps_.clear();
+        return replaced;
+    }
+
+    PipelineCompileStats PipelineStateCache::stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    vk::Pipeline PipelineStateCache::find(const vkinit::PipelineDesc& desc) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = pipelines_.find(desc);
+        return found != pipelines_.end() ? found->second : vk::Pipeline{};
+    }
+
+    std::vector<vk::Pipeline> PipelineStateCache::build_batch(const std::vector<vkinit::PipelineDesc>& descs, unsigned thread_count)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // keeps the background thread from touching the library parts the workers share
+        std::unique_lock<std::mutex> compiling(compile_mutex_);
+        // unique descriptions that still need compiling
+        std::vector<const vkinit::PipelineDesc*> misses;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::unordered_map<vkinit::PipelineDesc, bool, vkinit::PipelineDescHash> seen;
+            for(const vkinit::PipelineDesc& desc : descs)
+            {
+                if(pipelines_.find(desc) == pipelines_.end() && seen.emplace(desc, true).second)
+                {
+                    misses.push_back(&desc);
+                }
+            }
+        }
+
+        std::vector<vk::Pipeline> compiled(misses.size());
+        if(!misses.empty())
+        {
+            if(thread_count == 0)
+            {
+                thread_count = std::max(1u, std::thread::hardware_concurrency());
+            }
+            thread_count = std::min(thread_count, static_cast<unsigned>(misses.size()));
+            std::atomic<size_t> next{ 0 };
+            auto worker = [this, &misses, &compiled, &next]()
+            {
+                // a private cache per thread, so workers never contend on the persistent one
+                vk::PipelineCache thread_cache = pipeline_cache_.make_thread_cache();
+                for(size_t i = next.fetch_add(1); i < misses.size(); i = next.fetch_add(1))
+                {
+                    compiled[i] = Compile(*misses[i], thread_cache, false, true);
+                }
+                pipeline_cache_.merge(thread_cache);
+            };
+            std::vector<std::thread> workers;
+            for(unsigned i = 1; i < thread_count; i++)
+            {
+                workers.emplace_back(worker);
+            }
+            worker();
+            for(std::thread& thread : workers)
+            {
+                thread.join();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(size_t i = 0; i < misses.size(); i++)
+            {
+                if(!compiled[i])
+                {
+                    continue;
+                }
+                if(!pipelines_.emplace(*misses[i], compiled[i]).second)
+                {
+                    // built by get() on another thread in the meantime
+                    device_.destroyPipeline(compiled[i]);
+                }
+            }
+        }
+
+        std::vector<vk::Pipeline> result;
+        result.reserve(descs.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(const vkinit::PipelineDesc& desc : descs)
+            {
+                auto found = pipelines_.find(desc);
+                result.push_back(found != pipelines_.end() ? found->second : vk::Pipeline{});
+            }
+        }
+        compiling.unlock();
+        if(debug_)
+        {
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Built " << misses.size() << " of " << descs.size() << " requested pipelines on "
+                      << (misses.empty() ? 0 : thread_count) << " threads in " << elapsed << " ms\n";
+        }
+        return result;
+    }
+
+    void PipelineStateCache::reset()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.clear();
+            queued_.clear();
+            stale_shaders_.clear();
+            stats_.queueDepth = 0;
+            generation_++;
+        }
+        // let a compile in progress finish before destroying what it may link against
+        std::lock_guard<std::mutex> compiling(compile_mutex_);
+        DestroyAll();
+        libraries_.clear();
+    }
+
+    size_t PipelineStateCache::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pipelines_.size();
+    }
+
+    vk::Pipeline PipelineStateCache::Compile(const vkinit::PipelineDesc& desc, vk::PipelineCache cache, bool debug, bool optimize)
+    {
+        vkinit::GraphicsPipelineInBundle specification = { };
+        specification.device = device_;
+        specification.desc = desc;
+        specification.pipelineCache = cache;
+        specification.layout = layout_;
+        specification.dynamicRendering = dynamic_rendering_;
+        if(!dynamic_rendering_)
+        {
+            specification.renderpass = RenderPass(desc);
+            if(!specification.renderpass)
+            {
+                return vk::Pipeline{};
+            }
+        }
+        specification.libraries = use_library_ ? &libraries_ : nullptr;
+        specification.layouts = &layouts_;
+        specification.optimizeLink = optimize;
+        return vkinit::create_graphics_pipeline(specification, debug).pipeline;
+    }
+
+    /**
+     * @brief Returns the render pass for the description's attachments, creating it on first use.
+     *
+     * Render passes with the same formats and sample count are compatible, so one per combination is enough for
+     * every pipeline_. They exist only for that compatibility: the render graph creates its own passes, which the
+     * pipelines are then used with.
+     */
+    vk::RenderPass PipelineStateCache::RenderPass(const vkinit::PipelineDesc& desc)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        vk::RenderPass& renderpass = renderpasses_[{ desc.colorFormat, desc.depthFormat, desc.samples }];
+        if(!renderpass)
+        {
+            renderpass = vkinit::make_renderpass(device_, desc.colorFormat, desc.depthFormat, desc.samples, debug_);
+        }
+        return renderpass;
+    }
+
+    void PipelineStateCache::DestroyAll()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto& entry : pipelines_)
+        {
+            device_.destroyPipeline(entry.second);
+        }
+        pipelines_.clear();
+        for(auto& swap : swaps_)
+        {
+            device_.destroyPipeline(swap.second);
+        }
+        swaps_.clear();
+        fallback_.reset();
+    }
+
+    vk::Pipeline PipelineStateCache::Fallback() const
+    {
+        if(!fallback_)
+        {
+            return vk::Pipeline{};
+        }
+        auto found = pipelines_.find(*fallback_);
+        return found != pipelines_.end() ? found->second : vk::Pipeline{};
+    }
+
+    void PipelineStateCache::Enqueue(PendingCompile pending)
+    {
+        queue_.push_back(std::move(pending));
+        stats_.queueDepth = queue_.size();
+        queue_changed_.notify_one();
+    }
+
+    void PipelineStateCache::RecordReady(std::chrono::steady_clock::time_point requested)
+    {
+        double ready = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - requested).count();
+        stats_.lastTimeToReadyMs = ready;
+        stats_.maxTimeToReadyMs = std::max(stats_.maxTimeToReadyMs, ready);
+        stats_.averageTimeToReadyMs += (ready - stats_.averageTimeToReadyMs) / static_cast<double>(stats_.compiled + 1);
+        stats_.compiled++;
+        if(debug_)
+        {
+            std::cout << "Pipeline variant ready " << ready << " ms after it was requested, "
+                      << stats_.queueDepth << " still queued\n";
+        }
+    }
+
+    /**
+     * @brief Body of the background thread, compiles queued pipelines one at a time.
+     *
+     * Compilation goes through the persistent pipeline_ cache directly, which is internally
+     * synchronized, so warm variants come back quickly. A new variant is inserted as soon as it is
+     * built. With graphics pipeline_ libraries it is only fast linked, and queued again for an optimized
+     * link. Optimized and reloaded pipelines replace one that may be in use, so they are staged
+     * for apply_swaps() instead.
+     */
+    void PipelineStateCache::CompileLoop()
+    {
+        while(true)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_changed_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if(stop_)
+            {
+                return;
+            }
+            PendingCompile pending = std::move(queue_.front());
+            queue_.pop_front();
+            std::vector<std::string> stale;
+            stale.swap(stale_shaders_);
+            uint64_t generation = generation_;
+            lock.unlock();
+
+            vk::Pipeline pipeline;
+            {
+                std::lock_guard<std::mutex> compiling(compile_mutex_);
+                if(!stale.empty())
+                {
+                    libraries_.invalidate(stale);
+                }
+                pipeline = Compile(pending.desc, pipeline_cache_.get(), false, pending.kind == CompileKind::eOptimize);
+            }
+
+            lock.lock();
+            // reset() ran in the meantime, the pipeline_ may target a stale render pass
+            if(generation != generation_)
+            {
+                if(pipeline)
+                {
+                    device_.destroyPipeline(pipeline);
+                }
+                continue;
+            }
+            stats_.queueDepth = queue_.size();
+            if(!pipeline)
+            {
+                // a failed build stays marked as queued so a broken variant isn't retried every frame
+                stats_.failed++;
+                continue;
+            }
+            if(pending.kind == CompileKind::eBuild)
+            {
+                queued_.erase(pending.desc);
+                if(!pipelines_.emplace(pending.desc, pipeline).second)
+                {
+                    device_.destroyPipeline(pipeline);
+                    continue;
+                }
+                RecordReady(pending.requested);
+            }
+            else
+            {
+                swaps_.emplace_back(pending.desc, pipeline);
+                if(pending.kind == CompileKind::eOptimize)
+                {
+                    stats_.optimized++;
+                }
+                else
+                {
+                    stats_.reloaded++;
+                }
+            }
+            if(use_library_ && pending.kind != CompileKind::eOptimize)
+            {
+                Enqueue({ pending.desc, pending.requested, CompileKind::eOptimize });
+            }
+        }
+    }
+}
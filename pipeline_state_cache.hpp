@@ -0,0 +1,195 @@
+/**
+ * @file pipeline_state_cache.hpp
+ * @brief Defines the PipelineStateCache class, which deduplicates graphics pipelines by their description.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_PIPELINE_STATE_CACHE_HPP
+#define INC_3DLOADERVK_PIPELINE_STATE_CACHE_HPP
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "pipeline.hpp"
+#include "pipeline_cache.hpp"
+#include "layout_cache.hpp"
+#include "pipeline_library.hpp"
+
+namespace vkutil
+{
+    /**
+     * @struct PipelineCompileStats
+     * @brief Counters for pipelines compiled in the background.
+     *
+     * Time to ready runs from the first request of a pipeline_ to the moment it can be drawn with,
+     * optimized counts fast linked pipelines since replaced by their link time optimized version and
+     * reloaded counts pipelines rebuilt because their shaders changed.
+     */
+    struct PipelineCompileStats
+    {
+        size_t queueDepth = 0;
+        uint64_t compiled = 0;
+        uint64_t failed = 0;
+        uint64_t optimized = 0;
+        uint64_t reloaded = 0;
+        double lastTimeToReadyMs = 0.0;
+        double averageTimeToReadyMs = 0.0;
+        double maxTimeToReadyMs = 0.0;
+    };
+
+    /**
+     * @class PipelineStateCache
+     * @brief Owns every graphics pipeline_, keyed on the hash of its PipelineDesc.
+     *
+     * Requesting a description that was already built returns the existing pipeline_. All pipelines
+     * share one layout and are compiled through the persistent pipeline_ cache, against a render pass
+     * made once per combination of attachment formats and sample count, or with dynamic rendering
+     * against the formats alone. Lookups are thread safe.
+     *
+     * Pipelines needed while rendering are requested with get_async(), which never compiles on the
+     * calling thread: a missing pipeline_ is queued for a background thread and the fallback pipeline_
+     * is returned until it is ready.
+     *
+     * When the device_ supports VK_EXT_graphics_pipeline_library pipelines are linked from shared
+     * library parts, fast linked first and replaced by an optimized link in the background.
+     *
+     * Replacing a pipeline_ that may be in use, with an optimized link or after a shader reload, is
+     * staged and only happens when the render thread calls apply_swaps() between frames.
+     */
+    class PipelineStateCache
+    {
+    public:
+        /**
+         * @param device The Vulkan logical device_.
+         * @param pipeline_cache The driver cache pipelines are compiled through.
+         * @param layouts The cache the shared layout came from, shaders are checked against it.
+         * @param layout The pipeline_ layout shared by every pipeline_, not owned.
+         * @param use_pipeline_library Link pipelines from graphics pipeline_ library parts.
+         * @param dynamic_rendering Build pipelines for dynamic rendering rather than render passes.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        PipelineStateCache(vk::Device device, PipelineCache& pipeline_cache, LayoutCache& layouts, vk::PipelineLayout layout,
+                           bool use_pipeline_library, bool dynamic_rendering, bool debug);
+        ~PipelineStateCache();
+        PipelineStateCache(const PipelineStateCache&) = delete;
+        PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+        /**
+         * @brief Returns the pipeline_ for a description, compiling it on the calling thread if needed.
+         * @return The pipeline_, or a null handle if compilation failed.
+         */
+        vk::Pipeline get(const vkinit::PipelineDesc& desc);
+        /**
+         * @brief Returns the pipeline_ for a description without ever blocking on compilation.
+         *
+         * A pipeline_ that isn't built yet is queued for the background thread, once, and the
+         * fallback is returned in the meantime.
+         *
+         * @return The pipeline_, the fallback, or a null handle if there is no fallback and the
+         *         caller should skip the draw.
+         */
+        vk::Pipeline get_async(const vkinit::PipelineDesc& desc);
+        /**
+         * @brief Sets the pipeline_ returned by get_async() while a variant is still compiling.
+         * @param desc The description of a pipeline_ in this cache. Draws are skipped until one is set.
+         */
+        void set_fallback(const vkinit::PipelineDesc& desc);
+        /**
+         * @brief Rebuilds, in the background, every pipeline_ that uses one of the given shaders.
+         * @param shaders The names of the shaders that changed, as used in PipelineDesc.
+         */
+        void reload(const std::vector<std::string>& shaders);
+        /**
+         * @brief Swaps in the pipelines rebuilt in the background, to be called between frames.
+         * @return The replaced pipelines, which the caller destroys once no frame uses them.
+         */
+        std::vector<vk::Pipeline> apply_swaps();
+        /**
+         * @brief Snapshot of the background compilation counters.
+         */
+        [[nodiscard]] PipelineCompileStats stats() const;
+        /**
+         * @brief Returns the pipeline_ for a description if it was already built.
+         */
+        [[nodiscard]] vk::Pipeline find(const vkinit::PipelineDesc& desc) const;
+        /**
+         * @brief Compiles every description not yet cached, spread over worker threads.
+         *
+         * Duplicate descriptions in the batch are compiled once. Each worker compiles into its own
+         * driver cache, which is merged into the persistent cache when the worker finishes. The
+         * background thread is paused for the duration.
+         *
+         * @param descs The descriptions to build.
+         * @param thread_count Number of workers, zero picks one per hardware thread.
+         * @return The pipelines, in the same order as descs.
+         */
+        std::vector<vk::Pipeline> build_batch(const std::vector<vkinit::PipelineDesc>& descs, unsigned thread_count = 0);
+        /**
+         * @brief Destroys every pipeline_.
+         *
+         * Pending background compiles are dropped and one already running is waited for. The
+         * caller must make sure none of the pipelines are still in use by the device_.
+         */
+        void reset();
+        [[nodiscard]] size_t size() const;
+    private:
+        enum class CompileKind
+        {
+            eBuild,
+            eOptimize,
+            eReload
+        };
+        struct PendingCompile
+        {
+            vkinit::PipelineDesc desc;
+            std::chrono::steady_clock::time_point requested;
+            CompileKind kind;
+        };
+        vk::Pipeline Compile(const vkinit::PipelineDesc& desc, vk::PipelineCache cache, bool debug, bool optimize);
+        vk::RenderPass RenderPass(const vkinit::PipelineDesc& desc);
+        void DestroyAll();
+        [[nodiscard]] vk::Pipeline Fallback() const;
+        void Enqueue(PendingCompile pending);
+        void RecordReady(std::chrono::steady_clock::time_point requested);
+        void CompileLoop();
+
+        vk::Device device_;
+        PipelineCache& pipeline_cache_;
+        LayoutCache& layouts_;
+        vk::PipelineLayout layout_;
+        bool debug_;
+        bool use_library_;
+        bool dynamic_rendering_;
+        PipelineLibraryCache libraries_;
+        mutable std::mutex mutex_;
+        std::unordered_map<vkinit::PipelineDesc, vk::Pipeline, vkinit::PipelineDescHash> pipelines_;
+        // rebuilt pipelines waiting for apply_swaps()
+        std::vector<std::pair<vkinit::PipelineDesc, vk::Pipeline>> swaps_;
+        std::optional<vkinit::PipelineDesc> fallback_;
+        // keyed on the color and depth formats and the sample count
+        std::map<std::tuple<vk::Format, vk::Format, vk::SampleCountFlagBits>, vk::RenderPass> renderpasses_;
+
+        // background compilation, the queue and stats are guarded by mutex_
+        std::deque<PendingCompile> queue_;
+        std::unordered_map<vkinit::PipelineDesc, bool, vkinit::PipelineDescHash> queued_;
+        // shaders whose library parts must be rebuilt before the next compile
+        std::vector<std::string> stale_shaders_;
+        PipelineCompileStats stats_;
+        bool stop_;
+        uint64_t generation_;
+        std::condition_variable queue_changed_;
+        // held while compiling, so reset() can wait out the background thread and shader reloads
+        // never replace library parts under a link in progress
+        std::mutex compile_mutex_;
+        std::thread compile_thread_;
+    };
+}
+#endif //INC_3DLOADERVK_PIPELINE_STATE_CACHE_HPP
@@ -0,0 +1,153 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "present_tracker.hpp"
+#include <iostream>
+#include <utility>
+
+namespace vkutil
+{
+    PresentTracker::PresentTracker(vk::Device device, bool present_fences, bool debug)
+    {
+        device_ = device;
+        present_fences_ = present_fences;
+        debug_ = debug;
+        presents_queued_ = 0;
+        presents_completed_ = 0;
+        images_left_ = 0;
+        if(debug)
+        {
+            std::cout << "Replaced swap chains are retired once "
+                      << (present_fences ? "their present fences signal\n" : "every image of the new one was presented\n");
+        }
+    }
+
+    PresentTracker::~PresentTracker()
+    {
+        for(const Pending& pending : pending_)
+        {
+            device_.destroyFence(pending.fence);
+        }
+        for(vk::Fence fence : free_fences_)
+        {
+            device_.destroyFence(fence);
+        }
+    }
+
+    vk::Fence PresentTracker::next_fence()
+    {
+        if(!present_fences_)
+        {
+            return nullptr;
+        }
+        if(!free_fences_.empty())
+        {
+            vk::Fence fence = free_fences_.back();
+            free_fences_.pop_back();
+            return fence;
+        }
+        try
+        {
+            return device_.createFence(vk::FenceCreateInfo());
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to create a present fence: " << err.what() << "\n";
+            return nullptr;
+        }
+    }
+
+    void PresentTracker::presented(uint32_t image_index, vk::Fence fence)
+    {
+        ++presents_queued_;
+        // a present without a fence completes no later than the first fenced one after it
+        if(fence)
+        {
+            pending_.push_back({ presents_queued_, fence });
+        }
+        if(image_index < images_presented_.size() && !images_presented_[image_index])
+        {
+            images_presented_[image_index] = true;
+            --images_left_;
+        }
+    }
+
+    void PresentTracker::retire(uint64_t timeline_value, uint32_t image_count, std::function<void()> deleter)
+    {
+        retired_.push_back({ timeline_value, presents_queued_, std::move(deleter) });
+        // swap chains retired earlier wait on the newest one too, its presents come after theirs
+        images_presented_.assign(image_count, false);
+        images_left_ = image_count;
+    }
+
+    /**
+     * @brief Recycles the fences of finished presents and runs every callback they and the timeline allow.
+     *
+     * Presents are queued one after the other on the same queue, so fences are only checked from
+     * the oldest on and a retired swap chain waits for the presents before it, in order.
+     */
+    void PresentTracker::collect(Timeline& timeline)
+    {
+        try
+        {
+            while(!pending_.empty() && device_.getFenceStatus(pending_.front().fence) == vk::Result::eSuccess)
+            {
+                device_.resetFences(pending_.front().fence);
+                free_fences_.push_back(pending_.front().fence);
+                presents_completed_ = pending_.front().present;
+                pending_.pop_front();
+            }
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cout << "Failed to check a present fence: " << err.what() << "\n";
+            return;
+        }
+        if(pending_.empty())
+        {
+            presents_completed_ = presents_queued_;
+        }
+        while(!retired_.empty() && timeline.is_complete(retired_.front().timelineValue))
+        {
+            bool presentsDone = present_fences_ ? presents_completed_ >= retired_.front().presents : images_left_ == 0;
+            if(!presentsDone)
+            {
+                return;
+            }
+            std::function<void()> deleter = std::move(retired_.front().deleter);
+            retired_.pop_front();
+            deleter();
+        }
+    }
+
+    void PresentTracker::flush_all()
+    {
+        if(!pending_.empty())
+        {
+            std::vector<vk::Fence> fences;
+            for(const Pending& pending : pending_)
+            {
+                fences.push_back(pending.fence);
+            }
+            try
+            {
+                // bounded, a surface_ that went away may never finish its presents
+                if(device_.waitForFences(fences, VK_TRUE, 1000000000) != vk::Result::eSuccess && debug_)
+                {
+                    std::cout << "Timed out waiting for presents to finish\n";
+                }
+            }
+            catch(vk::SystemError &err)
+            {
+                std::cout << "Failed to wait for presents to finish: " << err.what() << "\n";
+            }
+        }
+        while(!retired_.empty())
+        {
+            std::function<void()> deleter = std::move(retired_.front().deleter);
+            retired_.pop_front();
+            deleter();
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * @file present_tracker.hpp
+ * @brief Defines the PresentTracker class, which defers destruction of swap chain resources until their presents are done.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_PRESENT_TRACKER_HPP
+#define INC_3DLOADERVK_PRESENT_TRACKER_HPP
+#include <vulkan/vulkan.hpp>
+#include "timeline.hpp"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace vkutil
+{
+    /**
+     * @class PresentTracker
+     * @brief Retires replaced swap chains once the presentation engine is done with them.
+     *
+     * The frame timeline reaching a value only says the GPU finished rendering, a present queued
+     * before may still be waiting on its semaphore or holding its swap chain. With
+     * VK_EXT_swapchain_maintenance1 every present signals a fence once it no longer uses its
+     * semaphores, and a retired swap chain is released when every present queued before it was
+     * retired signaled. Without it, presents of the swap chain replacing it are the only hint:
+     * once every image of the newest swap chain has been presented, the presentation engine has
+     * moved past everything queued on the swap chains before it.
+     * Not thread safe, belongs to the thread rendering.
+     */
+    class PresentTracker
+    {
+    public:
+        /**
+         * @param device The Vulkan logical device_.
+         * @param present_fences Whether the device_ was created with swapchain maintenance1 enabled.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        PresentTracker(vk::Device device, bool present_fences, bool debug);
+        /**
+         * @brief Destroys the fences, after flush_all().
+         */
+        ~PresentTracker();
+        PresentTracker(const PresentTracker&) = delete;
+        PresentTracker& operator=(const PresentTracker&) = delete;
+        /**
+         * @brief The fence the next present signals, chain it with a SwapchainPresentFenceInfoEXT.
+         * @return A fence, or a null handle without present fences.
+         */
+        vk::Fence next_fence();
+        /**
+         * @brief Records a present that was queued, whether or not it reported the swap chain out of date.
+         * @param image_index The image presented.
+         * @param fence The fence from next_fence() the present signals.
+         */
+        void presented(uint32_t image_index, vk::Fence fence);
+        /**
+         * @brief Queues a callback destroying a replaced swap chain and what belongs to it.
+         * @param timeline_value The frame timeline value the last frame rendered to it signals.
+         * @param image_count The number of images of the swap chain replacing it.
+         * @param deleter The callback destroying the resources.
+         */
+        void retire(uint64_t timeline_value, uint32_t image_count, std::function<void()> deleter);
+        /**
+         * @brief Runs every callback whose frames and presents completed, without blocking.
+         */
+        void collect(Timeline& timeline);
+        /**
+         * @brief Runs every callback, for use once the device_ is idle. Waits for pending present fences first.
+         */
+        void flush_all();
+    private:
+        struct Retired
+        {
+            uint64_t timelineValue;
+            // with present fences, the presents queued before the retire
+            uint64_t presents;
+            std::function<void()> deleter;
+        };
+        struct Pending
+        {
+            uint64_t present;
+            vk::Fence fence;
+        };
+
+        vk::Device device_;
+        bool present_fences_;
+        bool debug_;
+        std::deque<Retired> retired_;
+
+        // with present fences
+        uint64_t presents_queued_;
+        uint64_t presents_completed_;
+        std::deque<Pending> pending_;
+        std::vector<vk::Fence> free_fences_;
+
+        // without, the images of the newest swap chain presented since the last retire
+        std::vector<bool> images_presented_;
+        uint32_t images_left_;
+    };
+}
+#endif //INC_3DLOADERVK_PRESENT_TRACKER_HPP
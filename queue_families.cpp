@@ -9,14 +9,21 @@ namespace vkutil {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
 
+    bool QueueFamilyIndices::hasAsyncCompute() const
+    {
+        return computeFamily.has_value() && computeFamily != graphicsFamily;
+    }
+
     /**
      * @brief Finds queue families that support specific capabilities on a physical device_.
      *
      * Identifies and returns the indices of queue families that support graphics and presentation
-     * capabilities on the specified physical device_ and surface_.
+     * capabilities on the specified physical device_ and surface_, presenting from the graphics family
+     * whenever it can. Compute and transfer prefer the first family dedicated to them: compute without
+     * graphics, transfer without graphics or compute. Both fall back to the graphics family.
      *
      * @param device The Vulkan physical device_.
-     * @param surface The Vulkan surface_.
+     * @param surface The Vulkan surface_, or nullptr when rendering headless.
      * @param debug Flag indicating whether to enable debug logging.
      * @return QueueFamilyIndices with the indices of the suitable queue families.
      */
@@ -26,27 +33,50 @@ namespace vkutil {
         if (debug) {
             std::cout << "System can support " << queueFamilies.size() << " queue families.\n";
         }
-        int i = 0;
+        uint32_t i = 0;
         for (vk::QueueFamilyProperties queueFamily: queueFamilies) {
-            if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
+            bool graphics = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics);
+            bool compute = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eCompute);
+            bool transfer = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eTransfer);
+            if (graphics && !indices.graphicsFamily.has_value()) {
                 indices.graphicsFamily = i;
-                indices.presentFamily = i;
-
                 if (debug) {
                     std::cout << "Queue Family " << i << " is suitable for graphics.\n";
                 }
             }
-            if (device.getSurfaceSupportKHR(static_cast<uint32_t>(i), surface)) {
+            // a present family other than the graphics one costs a queue ownership transfer every frame
+            if (surface && (!indices.presentFamily.has_value() || indices.graphicsFamily == i) &&
+                device.getSurfaceSupportKHR(i, surface)) {
                 indices.presentFamily = i;
                 if (debug) {
                     std::cout << "Queue Family " << i << " is suitable for presenting.\n";
                 }
             }
-            if (indices.isComplete()) {
-                break;
+            if (compute && !graphics && !indices.computeFamily.has_value()) {
+                indices.computeFamily = i;
+                if (debug) {
+                    std::cout << "Queue Family " << i << " is dedicated to compute.\n";
+                }
+            }
+            if (transfer && !graphics && !compute && !indices.transferFamily.has_value()) {
+                indices.transferFamily = i;
+                if (debug) {
+                    std::cout << "Queue Family " << i << " is dedicated to transfers.\n";
+                }
             }
             i++;
         }
+        // without a surface_ nothing is presented and the graphics family stands in
+        if (!surface) {
+            indices.presentFamily = indices.graphicsFamily;
+        }
+        // graphics families support compute in practice, and either implies transfers
+        if (!indices.computeFamily.has_value()) {
+            indices.computeFamily = indices.graphicsFamily;
+        }
+        if (!indices.transferFamily.has_value()) {
+            indices.transferFamily = indices.graphicsFamily;
+        }
         return indices;
     }
 }
@@ -7,12 +7,25 @@
 
 namespace vkutil
 {
+    /**
+     * @struct QueueFamilyIndices
+     * @brief The queue families the engine submits to.
+     *
+     * computeFamily and transferFamily are dedicated families without graphics when the device_
+     * has them, so their work overlaps the graphics queue's, and the graphics family otherwise.
+     */
     struct QueueFamilyIndices
     {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> computeFamily;
+        std::optional<uint32_t> transferFamily;
 
         [[nodiscard]] bool isComplete() const;
+        /**
+         * @brief Whether compute work has a queue family of its own to run on.
+         */
+        [[nodiscard]] bool hasAsyncCompute() const;
     };
 
     QueueFamilyIndices findQueueFamilies(vk::PhysicalDevice device, vk::SurfaceKHR surface, bool debug);
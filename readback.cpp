@@ -0,0 +1,189 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "readback.hpp"
+#include "memory.hpp"
+#include <iostream>
+#include <utility>
+
+namespace vkutil
+{
+    ReadbackRing::ReadbackRing(vk::Device device, vk::PhysicalDevice physical_device, vk::Extent2D extent, vk::Format format,
+                               uint32_t slot_count, ReadbackCallback callback, bool debug)
+    {
+        device_ = device;
+        extent_ = extent;
+        format_ = format;
+        size_ = vk::DeviceSize(extent.width) * extent.height * 4;
+        callback_ = std::move(callback);
+        debug_ = debug;
+        oldest_ = 0;
+        in_flight_ = 0;
+        sequence_ = 0;
+        dropped_ = 0;
+
+        vk::BufferCreateInfo bufferInfo;
+        bufferInfo.size = size_;
+        bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        slots_.resize(slot_count);
+        for(Slot& slot : slots_)
+        {
+            try
+            {
+                slot.buffer.buffer = device_.createBuffer(bufferInfo);
+                vk::MemoryRequirements requirements = device_.getBufferMemoryRequirements(slot.buffer.buffer);
+                vk::MemoryAllocateInfo allocInfo;
+                allocInfo.allocationSize = requirements.size;
+                vk::MemoryPropertyFlags coherent = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+                // uncached memory is slow to read from the CPU, cached is preferred where there is any
+                try
+                {
+                    allocInfo.memoryTypeIndex = findMemoryTypeIndex(physical_device, requirements.memoryTypeBits,
+                                                                    coherent | vk::MemoryPropertyFlagBits::eHostCached);
+                }
+                catch(std::runtime_error &err)
+                {
+                    allocInfo.memoryTypeIndex = findMemoryTypeIndex(physical_device, requirements.memoryTypeBits, coherent);
+                }
+                slot.buffer.buffer_memory = device_.allocateMemory(allocInfo);
+                device_.bindBufferMemory(slot.buffer.buffer, slot.buffer.buffer_memory, 0);
+                slot.mapped = device_.mapMemory(slot.buffer.buffer_memory, 0, VK_WHOLE_SIZE);
+            }
+            catch(std::exception &err)
+            {
+                std::cout << "Failed to create a readback buffer: " << err.what() << "\n";
+                return;
+            }
+        }
+        if(debug)
+        {
+            std::cout << "Readback ring of " << slot_count << " buffers of " << size_ << " bytes\n";
+        }
+    }
+
+    ReadbackRing::~ReadbackRing()
+    {
+        for(Slot& slot : slots_)
+        {
+            if(slot.mapped != nullptr)
+            {
+                device_.unmapMemory(slot.buffer.buffer_memory);
+            }
+            device_.destroyBuffer(slot.buffer.buffer);
+            device_.freeMemory(slot.buffer.buffer_memory);
+        }
+        if(debug_ && dropped_ > 0)
+        {
+            std::cout << "Readback dropped " << dropped_ << " of " << sequence_ + dropped_ << " frames\n";
+        }
+    }
+
+    bool ReadbackRing::valid() const
+    {
+        return !slots_.empty() && slots_.back().mapped != nullptr;
+    }
+
+    bool ReadbackRing::record(vk::CommandBuffer command_buffer, vk::Image image)
+    {
+        if(!valid() || in_flight_ == slots_.size())
+        {
+            ++dropped_;
+            return false;
+        }
+        Slot& slot = slots_[(oldest_ + in_flight_) % slots_.size()];
+        slot.timelineValue = 0;
+        ++in_flight_;
+
+        vk::BufferImageCopy region = { };
+        region.bufferOffset = 0;
+        // zero row length and image height mean tightly packed
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = vk::Extent3D(extent_.width, extent_.height, 1);
+        command_buffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, slot.buffer.buffer, region);
+        // the timeline signal alone doesn't make the copy visible to host reads
+        vk::MemoryBarrier hostRead(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, { },
+                                       hostRead, nullptr, nullptr);
+        return true;
+    }
+
+    void ReadbackRing::submitted(uint64_t timeline_value)
+    {
+        for(uint32_t i = 0; i < in_flight_; ++i)
+        {
+            Slot& slot = slots_[(oldest_ + i) % slots_.size()];
+            if(slot.timelineValue == 0)
+            {
+                slot.timelineValue = timeline_value;
+            }
+        }
+    }
+
+    void ReadbackRing::abandon()
+    {
+        // copies not yet submitted are always the newest
+        while(in_flight_ > 0 && slots_[(oldest_ + in_flight_ - 1) % slots_.size()].timelineValue == 0)
+        {
+            --in_flight_;
+            ++dropped_;
+        }
+    }
+
+    void ReadbackRing::collect(Timeline& timeline)
+    {
+        while(in_flight_ > 0)
+        {
+            Slot& slot = slots_[oldest_];
+            if(slot.timelineValue == 0 || !timeline.is_complete(slot.timelineValue))
+            {
+                return;
+            }
+            Deliver(slot);
+        }
+    }
+
+    void ReadbackRing::drain(Timeline& timeline)
+    {
+        while(in_flight_ > 0)
+        {
+            Slot& slot = slots_[oldest_];
+            if(slot.timelineValue == 0 || !timeline.wait(slot.timelineValue))
+            {
+                // never submitted, or the device_ was lost, either way there is nothing to read
+                oldest_ = (oldest_ + in_flight_) % static_cast<uint32_t>(slots_.size());
+                in_flight_ = 0;
+                return;
+            }
+            Deliver(slot);
+        }
+    }
+
+    uint64_t ReadbackRing::dropped() const
+    {
+        return dropped_;
+    }
+
+    void ReadbackRing::Deliver(Slot& slot)
+    {
+        ReadbackFrame frame;
+        frame.sequence = sequence_++;
+        frame.extent = extent_;
+        frame.format = format_;
+        frame.pixels = static_cast<const std::byte*>(slot.mapped);
+        frame.size = size_;
+        if(callback_)
+        {
+            callback_(frame);
+        }
+        slot.timelineValue = 0;
+        oldest_ = (oldest_ + 1) % static_cast<uint32_t>(slots_.size());
+        --in_flight_;
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file readback.hpp
+ * @brief Defines the ReadbackRing class, which copies rendered images back to the CPU without stalling.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_READBACK_HPP
+#define INC_3DLOADERVK_READBACK_HPP
+#include <vulkan/vulkan.hpp>
+#include "config.hpp"
+#include "timeline.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vkutil
+{
+    /**
+     * @struct ReadbackFrame
+     * @brief A frame read back to the CPU, only valid for the duration of the callback it is passed to.
+     */
+    struct ReadbackFrame
+    {
+        // counts the frames read back by one ring, from zero
+        uint64_t sequence = 0;
+        vk::Extent2D extent;
+        vk::Format format = vk::Format::eUndefined;
+        // tightly packed rows of four byte texels, top row first
+        const std::byte* pixels = nullptr;
+        size_t size = 0;
+    };
+
+    using ReadbackCallback = std::function<void(const ReadbackFrame&)>;
+
+    /**
+     * @class ReadbackRing
+     * @brief A ring of host visible buffers rendered images are copied into, delivered a few frames later.
+     *
+     * record() copies an image into the next free buffer as part of a frame's command buffer and
+     * submitted() tags it with the frame timeline value of that frame. collect() then polls the
+     * timeline and hands every finished copy to the callback, oldest first, so the render loop never
+     * waits on the GPU for a readback. When every buffer is still in flight the frame is dropped and
+     * counted rather than waited for; with one more buffer than frames in flight that never happens.
+     *
+     * Buffers are host cached where the device_ has such memory, since the CPU reads every byte.
+     * Only four byte color formats are supported. Not thread safe, the callback runs on the thread
+     * calling collect().
+     */
+    class ReadbackRing
+    {
+    public:
+        /**
+         * @param device The Vulkan logical device_.
+         * @param physical_device The Vulkan physical device_, to pick the memory type.
+         * @param extent The size of the images to read back.
+         * @param format The format of the images to read back.
+         * @param slot_count The number of buffers in the ring.
+         * @param callback Receives the frames once their copies completed.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        ReadbackRing(vk::Device device, vk::PhysicalDevice physical_device, vk::Extent2D extent, vk::Format format,
+                     uint32_t slot_count, ReadbackCallback callback, bool debug);
+        ~ReadbackRing();
+        ReadbackRing(const ReadbackRing&) = delete;
+        ReadbackRing& operator=(const ReadbackRing&) = delete;
+        [[nodiscard]] bool valid() const;
+        /**
+         * @brief Records the copy of an image in TRANSFER_SRC_OPTIMAL layout into the next free buffer.
+         * @return false if the frame was dropped because no buffer is free.
+         */
+        bool record(vk::CommandBuffer command_buffer, vk::Image image);
+        /**
+         * @brief Tags the copies recorded since the last call with the timeline value their submission signals.
+         */
+        void submitted(uint64_t timeline_value);
+        /**
+         * @brief Drops the copies recorded since the last call, when their submission failed.
+         */
+        void abandon();
+        /**
+         * @brief Delivers every frame whose copy completed, without blocking.
+         */
+        void collect(Timeline& timeline);
+        /**
+         * @brief Waits for every submitted copy and delivers it. Copies never submitted are discarded.
+         */
+        void drain(Timeline& timeline);
+        /**
+         * @brief The number of frames dropped because every buffer was in flight.
+         */
+        [[nodiscard]] uint64_t dropped() const;
+    private:
+        struct Slot
+        {
+            Buffer buffer;
+            void* mapped = nullptr;
+            // zero until the submission carrying the copy is known
+            uint64_t timelineValue = 0;
+        };
+
+        void Deliver(Slot& slot);
+
+        vk::Device device_;
+        vk::Extent2D extent_;
+        vk::Format format_;
+        vk::DeviceSize size_;
+        ReadbackCallback callback_;
+        bool debug_;
+        std::vector<Slot> slots_;
+        // slots in use are the in_flight_ ones starting at oldest_, in the order they were recorded
+        uint32_t oldest_;
+        uint32_t in_flight_;
+        uint64_t sequence_;
+        uint64_t dropped_;
+    };
+}
+#endif //INC_3DLOADERVK_READBACK_HPP
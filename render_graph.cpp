@@ -0,0 +1,915 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "render_graph.hpp"
+#include <algorithm>
+#include "framebuffer.hpp"
+#include "gpu_profiler.hpp"
+#include "memory.hpp"
+namespace vkutil
+{
+    namespace
+    {
+        bool writes(vk::AccessFlags access)
+        {
+            return static_cast<bool>(access & (vk::AccessFlagBits::eColorAttachmentWrite |
+                                               vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                                               vk::AccessFlagBits::eTransferWrite |
+                                               vk::AccessFlagBits::eShaderWrite));
+        }
+
+        vk::AccessFlags write_bits(vk::AccessFlags access)
+        {
+            return access & (vk::AccessFlagBits::eColorAttachmentWrite |
+                             vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                             vk::AccessFlagBits::eTransferWrite |
+                             vk::AccessFlagBits::eShaderWrite);
+        }
+
+        bool has_stencil(vk::Format format)
+        {
+            return format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint ||
+                   format == vk::Format::eD32SfloatS8Uint || format == vk::Format::eS8Uint;
+        }
+
+        vk::ImageAspectFlags aspect_of(vk::Format format)
+        {
+            if(format == vk::Format::eD16Unorm || format == vk::Format::eX8D24UnormPack32 || format == vk::Format::eD32Sfloat)
+            {
+                return vk::ImageAspectFlagBits::eDepth;
+            }
+            if(has_stencil(format))
+            {
+                return format == vk::Format::eS8Uint ? vk::ImageAspectFlags(vk::ImageAspectFlagBits::eStencil)
+                                                     : vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+            }
+            return vk::ImageAspectFlagBits::eColor;
+        }
+
+        // the legacy stage and access bits keep their values in the 64 bit flags of synchronization2
+        vk::PipelineStageFlags2 stages2(vk::PipelineStageFlags stages)
+        {
+            return vk::PipelineStageFlags2(static_cast<VkPipelineStageFlags2>(static_cast<VkPipelineStageFlags>(stages)));
+        }
+
+        vk::AccessFlags2 access2(vk::AccessFlags access)
+        {
+            return vk::AccessFlags2(static_cast<VkAccessFlags2>(static_cast<VkAccessFlags>(access)));
+        }
+    }
+
+    RenderGraphPass::RenderGraphPass(RenderGraph& graph, uint32_t index)
+        : graph_(graph), index_(index)
+    {
+    }
+
+    RenderGraphPass& RenderGraphPass::write_color(RenderGraphImage image, std::optional<vk::ClearColorValue> clear)
+    {
+        std::optional<vk::ClearValue> value;
+        if(clear)
+        {
+            value = vk::ClearValue(*clear);
+        }
+        graph_.passes_[index_].accesses.push_back({ image.index, RenderGraph::AccessKind::eColorAttachment, { }, value });
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::resolve(RenderGraphImage image)
+    {
+        graph_.passes_[index_].accesses.push_back({ image.index, RenderGraph::AccessKind::eResolve, { }, std::nullopt });
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::write_depth(RenderGraphImage image, std::optional<vk::ClearDepthStencilValue> clear)
+    {
+        std::optional<vk::ClearValue> value;
+        if(clear)
+        {
+            value = vk::ClearValue(*clear);
+        }
+        graph_.passes_[index_].accesses.push_back({ image.index, RenderGraph::AccessKind::eDepthAttachment, { }, value });
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::read_depth(RenderGraphImage image)
+    {
+        graph_.passes_[index_].accesses.push_back({ image.index, RenderGraph::AccessKind::eDepthRead, { }, std::nullopt });
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::sample(RenderGraphImage image, vk::PipelineStageFlags stages)
+    {
+        graph_.passes_[index_].accesses.push_back({ image.index, RenderGraph::AccessKind::eSampled, stages, std::nullopt });
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::copy_from(RenderGraphImage image)
+    {
+        graph_.passes_[index_].accesses.push_back({ image.index, RenderGraph::AccessKind::eTransferSrc, { }, std::nullopt });
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::copy_to(RenderGraphImage image)
+    {
+        graph_.passes_[index_].accesses.push_back({ image.index, RenderGraph::AccessKind::eTransferDst, { }, std::nullopt });
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::keep()
+    {
+        graph_.passes_[index_].keep = true;
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::execute(std::function<void(vk::CommandBuffer)> callback)
+    {
+        graph_.passes_[index_].callback = std::move(callback);
+        return *this;
+    }
+
+    RenderGraph::RenderGraph(vk::Device device, vk::PhysicalDevice physical_device, bool dynamic_rendering, bool synchronization2, bool debug)
+    {
+        device_ = device;
+        physical_device_ = physical_device;
+        dynamic_rendering_ = dynamic_rendering;
+        synchronization2_ = synchronization2;
+        debug_ = debug;
+        compiled_ = false;
+    }
+
+    RenderGraph::~RenderGraph()
+    {
+        for(Pass& pass : passes_)
+        {
+            for(auto& entry : pass.framebuffers)
+            {
+                device_.destroyFramebuffer(entry.second);
+            }
+            device_.destroyRenderPass(pass.renderPass);
+        }
+        for(Image& image : images_)
+        {
+            if(!image.imported)
+            {
+                device_.destroyImageView(image.view);
+                device_.destroyImage(image.image);
+            }
+        }
+        for(MemoryBlock& block : blocks_)
+        {
+            device_.freeMemory(block.memory);
+        }
+    }
+
+    RenderGraphImage RenderGraph::import_image(const std::string& name, const RenderGraphImageDesc& desc, vk::ImageLayout final_layout)
+    {
+        Image image;
+        image.name = name;
+        image.desc = desc;
+        image.imported = true;
+        image.finalLayout = final_layout;
+        images_.push_back(std::move(image));
+        compiled_ = false;
+        return RenderGraphImage{ static_cast<uint32_t>(images_.size() - 1) };
+    }
+
+    RenderGraphImage RenderGraph::create_image(const std::string& name, const RenderGraphImageDesc& desc)
+    {
+        Image image;
+        image.name = name;
+        image.desc = desc;
+        images_.push_back(std::move(image));
+        compiled_ = false;
+        return RenderGraphImage{ static_cast<uint32_t>(images_.size() - 1) };
+    }
+
+    RenderGraphPass RenderGraph::add_pass(const std::string& name)
+    {
+        Pass pass;
+        pass.name = name;
+        passes_.push_back(std::move(pass));
+        compiled_ = false;
+        return RenderGraphPass(*this, static_cast<uint32_t>(passes_.size() - 1));
+    }
+
+    bool RenderGraph::compile()
+    {
+        if(compiled_)
+        {
+            return true;
+        }
+        for(const Pass& pass : passes_)
+        {
+            for(const Access& access : pass.accesses)
+            {
+                if(access.image >= images_.size())
+                {
+                    std::cerr << "Render graph pass \"" << pass.name << "\" uses an image of another graph\n";
+                    return false;
+                }
+            }
+        }
+        Cull();
+        for(uint32_t index = 0; index < passes_.size(); index++)
+        {
+            if(passes_[index].culled)
+            {
+                continue;
+            }
+            for(const Access& access : passes_[index].accesses)
+            {
+                Image& image = images_[access.image];
+                image.firstPass = std::min(image.firstPass.value_or(index), index);
+                image.lastPass = index;
+            }
+        }
+        if(!CreateImages())
+        {
+            return false;
+        }
+        for(uint32_t index = 0; index < passes_.size(); index++)
+        {
+            if(passes_[index].culled)
+            {
+                continue;
+            }
+            if(!PlanAttachments(index) || (!dynamic_rendering_ && !CreateRenderPass(index)))
+            {
+                return false;
+            }
+        }
+        compiled_ = true;
+        if(debug_)
+        {
+            std::cout << "Render graph" << (dynamic_rendering_ ? " with dynamic rendering" : " with render passes")
+                      << (synchronization2_ ? " and synchronization2" : "") << ":\n";
+            for(const Pass& pass : passes_)
+            {
+                std::cout << "\t" << pass.name << (pass.culled ? " (culled)" : "") << "\n";
+            }
+        }
+        return true;
+    }
+
+    void RenderGraph::set_image(RenderGraphImage image, vk::Image handle, vk::ImageView view)
+    {
+        images_[image.index].image = handle;
+        images_[image.index].view = view;
+    }
+
+    vk::Image RenderGraph::image(RenderGraphImage image) const
+    {
+        return images_[image.index].image;
+    }
+
+    void RenderGraph::execute(vk::CommandBuffer command_buffer, GpuProfiler* profiler)
+    {
+        if(!compile())
+        {
+            return;
+        }
+        std::vector<Barrier> barriers;
+        for(Pass& pass : passes_)
+        {
+            if(pass.culled)
+            {
+                continue;
+            }
+            // a pass is timed with the barriers it waits on
+            uint32_t scope = profiler != nullptr ? profiler->begin_scope(command_buffer, pass.name) : UINT32_MAX;
+            RecordPass(command_buffer, pass, barriers);
+            if(profiler != nullptr)
+            {
+                profiler->end_scope(command_buffer, scope);
+            }
+        }
+
+        // imported images are handed back in their final layout, even when every pass using them was culled
+        barriers.clear();
+        for(Image& image : images_)
+        {
+            if(image.imported && image.image)
+            {
+                Transition(image, ImageState{ image.finalLayout, vk::PipelineStageFlagBits::eBottomOfPipe, { } }, false, barriers);
+            }
+        }
+        RecordBarriers(command_buffer, barriers);
+        for(Image& image : images_)
+        {
+            image.touched = false;
+        }
+    }
+
+    void RenderGraph::RecordPass(vk::CommandBuffer command_buffer, Pass& pass, std::vector<Barrier>& barriers)
+    {
+        barriers.clear();
+        for(const Access& access : pass.accesses)
+        {
+            Transition(images_[access.image], Describe(access).state, Overwrites(access), barriers);
+        }
+        RecordBarriers(command_buffer, barriers);
+        if(pass.attachments.empty())
+        {
+            if(pass.callback)
+            {
+                pass.callback(command_buffer);
+            }
+            return;
+        }
+        if(dynamic_rendering_)
+        {
+            BeginRendering(command_buffer, pass);
+            if(pass.callback)
+            {
+                pass.callback(command_buffer);
+            }
+            command_buffer.endRendering();
+            return;
+        }
+        vk::RenderPassBeginInfo renderPassInfo = { };
+        renderPassInfo.renderPass = pass.renderPass;
+        renderPassInfo.framebuffer = Framebuffer(pass);
+        renderPassInfo.renderArea.offset.x = 0;
+        renderPassInfo.renderArea.offset.y = 0;
+        renderPassInfo.renderArea.extent = pass.extent;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+        renderPassInfo.pClearValues = pass.clearValues.data();
+        command_buffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+        if(pass.callback)
+        {
+            pass.callback(command_buffer);
+        }
+        command_buffer.endRenderPass();
+    }
+
+    /**
+     * @brief The layout, stages and access a kind of access needs, and the usage it implies.
+     */
+    RenderGraph::Usage RenderGraph::Describe(const Access& access)
+    {
+        switch(access.kind)
+        {
+            case AccessKind::eColorAttachment:
+                return { { vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                           vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite },
+                         vk::ImageUsageFlagBits::eColorAttachment };
+            case AccessKind::eResolve:
+                return { { vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                           vk::AccessFlagBits::eColorAttachmentWrite },
+                         vk::ImageUsageFlagBits::eColorAttachment };
+            case AccessKind::eDepthAttachment:
+                return { { vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                           vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+                           vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite },
+                         vk::ImageUsageFlagBits::eDepthStencilAttachment };
+            case AccessKind::eDepthRead:
+                return { { vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+                           vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+                           vk::AccessFlagBits::eDepthStencilAttachmentRead },
+                         vk::ImageUsageFlagBits::eDepthStencilAttachment };
+            case AccessKind::eSampled:
+                return { { vk::ImageLayout::eShaderReadOnlyOptimal, access.stages, vk::AccessFlagBits::eShaderRead },
+                         vk::ImageUsageFlagBits::eSampled };
+            case AccessKind::eTransferSrc:
+                return { { vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead },
+                         vk::ImageUsageFlagBits::eTransferSrc };
+            case AccessKind::eTransferDst:
+                return { { vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite },
+                         vk::ImageUsageFlagBits::eTransferDst };
+            default:
+                break;
+        }
+        return { };
+    }
+
+    /**
+     * @brief Whether an access replaces the image's contents without reading them: clears, copies and resolves.
+     */
+    bool RenderGraph::Overwrites(const Access& access)
+    {
+        return access.clear.has_value() || access.kind == AccessKind::eTransferDst || access.kind == AccessKind::eResolve;
+    }
+
+    /**
+     * @brief Whether a transient image is only ever an attachment of a single pass, so never needs storing.
+     */
+    bool RenderGraph::IsPassLocal(uint32_t index) const
+    {
+        const Image& image = images_[index];
+        if(image.imported || !image.firstPass || *image.firstPass != image.lastPass || image.desc.usage)
+        {
+            return false;
+        }
+        for(const Access& access : passes_[image.lastPass].accesses)
+        {
+            if(access.image == index && access.kind != AccessKind::eColorAttachment && access.kind != AccessKind::eResolve &&
+               access.kind != AccessKind::eDepthAttachment && access.kind != AccessKind::eDepthRead)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Marks the passes nothing needs as culled.
+     *
+     * Walks the passes backwards tracking which images a later pass still needs the contents of,
+     * starting with the imported ones. A pass survives if it is kept or writes a needed image. Its
+     * reads and loads make their images needed, its clears and copies make the old contents unneeded.
+     */
+    void RenderGraph::Cull()
+    {
+        std::vector<bool> needed(images_.size());
+        for(size_t index = 0; index < images_.size(); index++)
+        {
+            needed[index] = images_[index].imported;
+        }
+        for(size_t index = passes_.size(); index-- > 0;)
+        {
+            Pass& pass = passes_[index];
+            bool alive = pass.keep;
+            for(const Access& access : pass.accesses)
+            {
+                alive = alive || (writes(Describe(access).state.access) && needed[access.image]);
+            }
+            pass.culled = !alive;
+            if(!alive)
+            {
+                continue;
+            }
+            for(const Access& access : pass.accesses)
+            {
+                needed[access.image] = !Overwrites(access);
+            }
+        }
+    }
+
+    /**
+     * @brief Creates the transient images, letting images whose lifetimes don't overlap share memory.
+     *
+     * Images are placed in order of first use into the first block whose last user ran before
+     * them and whose memory types they accept, and blocks grow to the largest image they hold.
+     * Images local to one pass are transient attachments and only share lazily allocated blocks.
+     */
+    bool RenderGraph::CreateImages()
+    {
+        std::vector<vk::ImageUsageFlags> usage(images_.size());
+        for(const Pass& pass : passes_)
+        {
+            for(const Access& access : pass.accesses)
+            {
+                if(!pass.culled)
+                {
+                    usage[access.image] |= Describe(access).usage;
+                }
+            }
+        }
+        std::vector<uint32_t> order;
+        for(uint32_t index = 0; index < images_.size(); index++)
+        {
+            if(!images_[index].imported && images_[index].firstPass)
+            {
+                order.push_back(index);
+            }
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+        {
+            return *images_[a].firstPass < *images_[b].firstPass;
+        });
+
+        vk::DeviceSize requested = 0;
+        for(uint32_t index : order)
+        {
+            Image& image = images_[index];
+            vk::ImageCreateInfo imageInfo;
+            imageInfo.imageType = vk::ImageType::e2D;
+            imageInfo.format = image.desc.format;
+            imageInfo.extent = vk::Extent3D(image.desc.extent.width, image.desc.extent.height, 1);
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = image.desc.samples;
+            imageInfo.tiling = vk::ImageTiling::eOptimal;
+            bool lazy = IsPassLocal(index);
+            imageInfo.usage = image.desc.usage | usage[index];
+            if(lazy)
+            {
+                imageInfo.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+            }
+            imageInfo.sharingMode = vk::SharingMode::eExclusive;
+            imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+            try
+            {
+                image.image = device_.createImage(imageInfo);
+            }
+            catch(vk::SystemError &err)
+            {
+                std::cerr << "Failed to create render graph image \"" << image.name << "\": " << err.what() << "\n";
+                return false;
+            }
+            vk::MemoryRequirements requirements = device_.getImageMemoryRequirements(image.image);
+            requested += requirements.size;
+            auto block = std::find_if(blocks_.begin(), blocks_.end(), [&image, &requirements, lazy](const MemoryBlock& candidate)
+            {
+                return candidate.lastPass < *image.firstPass && candidate.lazy == lazy &&
+                       (candidate.memoryTypeBits & requirements.memoryTypeBits) != 0;
+            });
+            if(block == blocks_.end())
+            {
+                block = blocks_.emplace(blocks_.end());
+                block->lazy = lazy;
+            }
+            // every image starts at offset 0, which an allocation satisfies any alignment for
+            block->size = std::max(block->size, requirements.size);
+            block->memoryTypeBits &= requirements.memoryTypeBits;
+            block->lastPass = image.lastPass;
+            image.block = static_cast<uint32_t>(block - blocks_.begin());
+        }
+
+        vk::DeviceSize allocated = 0;
+        vk::DeviceSize lazily_allocated = 0;
+        for(MemoryBlock& block : blocks_)
+        {
+            try
+            {
+                vk::MemoryAllocateInfo allocInfo;
+                allocInfo.allocationSize = block.size;
+                bool lazy = false;
+                if(block.lazy)
+                {
+                    // desktop GPUs have no lazily allocated memory, transient images then take ordinary memory
+                    try
+                    {
+                        allocInfo.memoryTypeIndex = findMemoryTypeIndex(physical_device_, block.memoryTypeBits,
+                                                                        vk::MemoryPropertyFlagBits::eLazilyAllocated);
+                        lazy = true;
+                    }
+                    catch(std::runtime_error&)
+                    {
+                    }
+                }
+                if(!lazy)
+                {
+                    allocInfo.memoryTypeIndex = findMemoryTypeIndex(physical_device_, block.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+                }
+                block.memory = device_.allocateMemory(allocInfo);
+                (lazy ? lazily_allocated : allocated) += block.size;
+            }
+            catch(std::exception &err)
+            {
+                std::cerr << "Failed to allocate render graph memory: " << err.what() << "\n";
+                return false;
+            }
+        }
+        for(uint32_t index : order)
+        {
+            Image& image = images_[index];
+            vk::ImageViewCreateInfo viewInfo;
+            viewInfo.image = image.image;
+            viewInfo.viewType = vk::ImageViewType::e2D;
+            viewInfo.format = image.desc.format;
+            viewInfo.subresourceRange = vk::ImageSubresourceRange(aspect_of(image.desc.format), 0, 1, 0, 1);
+            try
+            {
+                device_.bindImageMemory(image.image, blocks_[image.block].memory, 0);
+                image.view = device_.createImageView(viewInfo);
+            }
+            catch(vk::SystemError &err)
+            {
+                std::cerr << "Failed to create render graph image \"" << image.name << "\": " << err.what() << "\n";
+                return false;
+            }
+        }
+        if(debug_ && !order.empty())
+        {
+            std::cout << "Render graph holds " << order.size() << " transient images in " << blocks_.size()
+                      << " allocations, " << allocated << " bytes instead of " << requested << " and "
+                      << lazily_allocated << " lazily allocated\n";
+        }
+        return true;
+    }
+
+    /**
+     * @brief Works out the attachments of a pass and what its rendering loads and stores.
+     *
+     * Layout transitions all happen in the graph's barriers, so every attachment is rendered in the
+     * layout the pass uses it in. Contents are loaded only when an earlier pass wrote them and
+     * stored only when a later pass or the owner of an imported image reads them.
+     */
+    bool RenderGraph::PlanAttachments(uint32_t index)
+    {
+        Pass& pass = passes_[index];
+        size_t colors = 0;
+        size_t resolves = 0;
+        size_t depths = 0;
+        for(const Access& access : pass.accesses)
+        {
+            if(access.kind != AccessKind::eColorAttachment && access.kind != AccessKind::eResolve &&
+               access.kind != AccessKind::eDepthAttachment && access.kind != AccessKind::eDepthRead)
+            {
+                continue;
+            }
+            const Image& image = images_[access.image];
+            if(pass.attachments.empty())
+            {
+                pass.extent = image.desc.extent;
+            }
+            else if(pass.extent != image.desc.extent)
+            {
+                std::cerr << "Render graph pass \"" << pass.name << "\" has attachments of different sizes\n";
+                return false;
+            }
+            bool written_before = false;
+            for(uint32_t earlier = 0; earlier < index; earlier++)
+            {
+                for(const Access& other : passes_[earlier].accesses)
+                {
+                    written_before = written_before || (!passes_[earlier].culled && other.image == access.image &&
+                                                        writes(Describe(other).state.access));
+                }
+            }
+            bool read_after = image.imported || image.lastPass > index;
+
+            Attachment attachment = { };
+            attachment.image = access.image;
+            attachment.kind = access.kind;
+            attachment.layout = Describe(access).state.layout;
+            attachment.loadOp = access.clear ? vk::AttachmentLoadOp::eClear
+                                             : (written_before && !Overwrites(access) ? vk::AttachmentLoadOp::eLoad
+                                                                                      : vk::AttachmentLoadOp::eDontCare);
+            attachment.storeOp = read_after ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+            colors += access.kind == AccessKind::eColorAttachment ? 1 : 0;
+            resolves += access.kind == AccessKind::eResolve ? 1 : 0;
+            depths += access.kind == AccessKind::eDepthAttachment || access.kind == AccessKind::eDepthRead ? 1 : 0;
+            pass.attachments.push_back(attachment);
+            pass.clearValues.push_back(access.clear.value_or(vk::ClearValue()));
+        }
+        if(depths > 1)
+        {
+            std::cerr << "Render graph pass \"" << pass.name << "\" has two depth attachments\n";
+            return false;
+        }
+        if(resolves != 0 && resolves != colors)
+        {
+            std::cerr << "Render graph pass \"" << pass.name << "\" must resolve every color attachment or none\n";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Creates the render pass of a pass with attachments, when rendering without dynamic rendering.
+     *
+     * Every attachment starts and ends the render pass in the layout the pass uses it in, with the
+     * load and store operations PlanAttachments chose.
+     */
+    bool RenderGraph::CreateRenderPass(uint32_t index)
+    {
+        Pass& pass = passes_[index];
+        if(pass.attachments.empty())
+        {
+            return true;
+        }
+        std::vector<vk::AttachmentDescription> descriptions;
+        std::vector<vk::AttachmentReference> colorRefs;
+        std::vector<vk::AttachmentReference> resolveRefs;
+        std::optional<vk::AttachmentReference> depthRef;
+        for(const Attachment& attachment : pass.attachments)
+        {
+            const Image& image = images_[attachment.image];
+            vk::AttachmentDescription description = { };
+            description.format = image.desc.format;
+            description.samples = image.desc.samples;
+            description.loadOp = attachment.loadOp;
+            description.storeOp = attachment.storeOp;
+            description.stencilLoadOp = has_stencil(image.desc.format) ? description.loadOp : vk::AttachmentLoadOp::eDontCare;
+            description.stencilStoreOp = has_stencil(image.desc.format) ? description.storeOp : vk::AttachmentStoreOp::eDontCare;
+            description.initialLayout = attachment.layout;
+            description.finalLayout = attachment.layout;
+            vk::AttachmentReference reference(static_cast<uint32_t>(descriptions.size()), attachment.layout);
+            if(attachment.kind == AccessKind::eColorAttachment)
+            {
+                colorRefs.push_back(reference);
+            }
+            else if(attachment.kind == AccessKind::eResolve)
+            {
+                resolveRefs.push_back(reference);
+            }
+            else
+            {
+                depthRef = reference;
+            }
+            descriptions.push_back(description);
+        }
+
+        // resolves happen at the end of the subpass, the multisampled attachments need never leave tile memory
+        vk::SubpassDescription subpass = { };
+        subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+        subpass.pColorAttachments = colorRefs.data();
+        subpass.pResolveAttachments = resolveRefs.empty() ? nullptr : resolveRefs.data();
+        subpass.pDepthStencilAttachment = depthRef ? &*depthRef : nullptr;
+        vk::RenderPassCreateInfo renderpassInfo = { };
+        renderpassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+        renderpassInfo.pAttachments = descriptions.data();
+        renderpassInfo.subpassCount = 1;
+        renderpassInfo.pSubpasses = &subpass;
+        try
+        {
+            pass.renderPass = device_.createRenderPass(renderpassInfo);
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cerr << "Failed to create the render pass of \"" << pass.name << "\": " << err.what() << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns the pass's framebuffer for the current image views, one is kept per distinct set.
+     */
+    vk::Framebuffer RenderGraph::Framebuffer(Pass& pass)
+    {
+        std::vector<VkImageView> key;
+        std::vector<vk::ImageView> views;
+        for(const Attachment& attachment : pass.attachments)
+        {
+            views.push_back(images_[attachment.image].view);
+            key.push_back(static_cast<VkImageView>(images_[attachment.image].view));
+        }
+        auto found = pass.framebuffers.find(key);
+        if(found != pass.framebuffers.end())
+        {
+            return found->second;
+        }
+        vkinit::framebufferInput input;
+        input.device = device_;
+        input.renderpass = pass.renderPass;
+        input.extent = pass.extent;
+        vk::Framebuffer framebuffer = vkinit::make_framebuffer(input, views, debug_);
+        pass.framebuffers.emplace(std::move(key), framebuffer);
+        return framebuffer;
+    }
+
+    /**
+     * @brief Brings an image into the state an access needs, adding a barrier unless reads follow reads.
+     *
+     * An image's first access in a frame treats its contents as undefined, but still waits for the
+     * last access to its memory, which may belong to the previous frame or to an image it aliases.
+     * Imported images wait for the color attachment output stage instead, where the swap chain's
+     * acquire semaphore is waited on.
+     */
+    void RenderGraph::Transition(Image& image, const ImageState& required, bool discard, std::vector<Barrier>& barriers)
+    {
+        ImageState& current = image.state;
+        if(!image.touched)
+        {
+            image.touched = true;
+            if(image.imported)
+            {
+                current = ImageState{ vk::ImageLayout::eUndefined, vk::PipelineStageFlagBits::eColorAttachmentOutput, { } };
+            }
+            else
+            {
+                const ImageState& last = blocks_[image.block].last;
+                current = ImageState{ vk::ImageLayout::eUndefined, last.stages, last.access };
+            }
+        }
+        if(current.layout == required.layout && !writes(current.access) && !writes(required.access))
+        {
+            current.stages |= required.stages;
+            current.access |= required.access;
+        }
+        else
+        {
+            Barrier barrier;
+            barrier.barrier.srcAccessMask = write_bits(current.access);
+            barrier.barrier.dstAccessMask = required.access;
+            barrier.barrier.oldLayout = discard ? vk::ImageLayout::eUndefined : current.layout;
+            barrier.barrier.newLayout = required.layout;
+            barrier.barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.barrier.image = image.image;
+            barrier.barrier.subresourceRange = vk::ImageSubresourceRange(aspect_of(image.desc.format), 0, 1, 0, 1);
+            barrier.src = current.stages ? current.stages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+            barrier.dst = required.stages;
+            barriers.push_back(barrier);
+            current = required;
+        }
+        if(!image.imported)
+        {
+            blocks_[image.block].last = current;
+        }
+    }
+
+    /**
+     * @brief Begins dynamic rendering of a pass on the current image views.
+     *
+     * Resolve attachments pair with the color attachments in the order both were declared, as
+     * they do in a subpass, and resolve by averaging as render passes do for the color formats.
+     */
+    void RenderGraph::BeginRendering(vk::CommandBuffer command_buffer, const Pass& pass)
+    {
+        std::vector<vk::RenderingAttachmentInfo> colors;
+        std::optional<vk::RenderingAttachmentInfo> depth;
+        bool stencil = false;
+        for(size_t i = 0; i < pass.attachments.size(); i++)
+        {
+            const Attachment& attachment = pass.attachments[i];
+            if(attachment.kind == AccessKind::eResolve)
+            {
+                continue;
+            }
+            vk::RenderingAttachmentInfo info;
+            info.imageView = images_[attachment.image].view;
+            info.imageLayout = attachment.layout;
+            info.loadOp = attachment.loadOp;
+            info.storeOp = attachment.storeOp;
+            info.clearValue = pass.clearValues[i];
+            if(attachment.kind == AccessKind::eColorAttachment)
+            {
+                colors.push_back(info);
+            }
+            else
+            {
+                depth = info;
+                stencil = has_stencil(images_[attachment.image].desc.format);
+            }
+        }
+        size_t resolved = 0;
+        for(const Attachment& attachment : pass.attachments)
+        {
+            if(attachment.kind == AccessKind::eResolve)
+            {
+                colors[resolved].resolveMode = vk::ResolveModeFlagBits::eAverage;
+                colors[resolved].resolveImageView = images_[attachment.image].view;
+                colors[resolved].resolveImageLayout = attachment.layout;
+                resolved++;
+            }
+        }
+
+        vk::RenderingInfo renderingInfo = { };
+        renderingInfo.renderArea.offset.x = 0;
+        renderingInfo.renderArea.offset.y = 0;
+        renderingInfo.renderArea.extent = pass.extent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colors.size());
+        renderingInfo.pColorAttachments = colors.data();
+        renderingInfo.pDepthAttachment = depth ? &*depth : nullptr;
+        renderingInfo.pStencilAttachment = depth && stencil ? &*depth : nullptr;
+        command_buffer.beginRendering(renderingInfo);
+    }
+
+    /**
+     * @brief Records the barriers of a pass, one dependency of per image stages with synchronization2.
+     *
+     * Without it a single pipeline barrier waits on the union of the source stages and blocks the
+     * union of the destination stages, so an image needed late in the pipeline_ holds up the
+     * stages before it along with the images needed early.
+     */
+    void RenderGraph::RecordBarriers(vk::CommandBuffer command_buffer, const std::vector<Barrier>& barriers) const
+    {
+        if(barriers.empty())
+        {
+            return;
+        }
+        if(synchronization2_)
+        {
+            std::vector<vk::ImageMemoryBarrier2> barriers2;
+            barriers2.reserve(barriers.size());
+            for(const Barrier& barrier : barriers)
+            {
+                vk::ImageMemoryBarrier2 barrier2;
+                barrier2.srcStageMask = stages2(barrier.src);
+                barrier2.srcAccessMask = access2(barrier.barrier.srcAccessMask);
+                barrier2.dstStageMask = stages2(barrier.dst);
+                barrier2.dstAccessMask = access2(barrier.barrier.dstAccessMask);
+                barrier2.oldLayout = barrier.barrier.oldLayout;
+                barrier2.newLayout = barrier.barrier.newLayout;
+                barrier2.srcQueueFamilyIndex = barrier.barrier.srcQueueFamilyIndex;
+                barrier2.dstQueueFamilyIndex = barrier.barrier.dstQueueFamilyIndex;
+                barrier2.image = barrier.barrier.image;
+                barrier2.subresourceRange = barrier.barrier.subresourceRange;
+                barriers2.push_back(barrier2);
+            }
+            vk::DependencyInfo dependency = { };
+            dependency.imageMemoryBarrierCount = static_cast<uint32_t>(barriers2.size());
+            dependency.pImageMemoryBarriers = barriers2.data();
+            command_buffer.pipelineBarrier2(dependency);
+            return;
+        }
+        std::vector<vk::ImageMemoryBarrier> legacy;
+        legacy.reserve(barriers.size());
+        vk::PipelineStageFlags src;
+        vk::PipelineStageFlags dst;
+        for(const Barrier& barrier : barriers)
+        {
+            legacy.push_back(barrier.barrier);
+            src |= barrier.src;
+            dst |= barrier.dst;
+        }
+        command_buffer.pipelineBarrier(src, dst, vk::DependencyFlags(), nullptr, nullptr, legacy);
+    }
+}
@@ -0,0 +1,277 @@
+/**
+ * @file render_graph.hpp
+ * @brief Defines the RenderGraph class, which orders passes, places their barriers and aliases their transient images.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_RENDER_GRAPH_HPP
+#define INC_3DLOADERVK_RENDER_GRAPH_HPP
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace vkutil
+{
+    /**
+     * @struct RenderGraphImage
+     * @brief A handle to an image of a render graph, only meaningful to the graph that returned it.
+     */
+    struct RenderGraphImage
+    {
+        uint32_t index = UINT32_MAX;
+        [[nodiscard]] bool valid() const
+        {
+            return index != UINT32_MAX;
+        }
+    };
+
+    /**
+     * @struct RenderGraphImageDesc
+     * @brief What a graph image looks like. The usage the passes imply is added, usage only names extra bits.
+     */
+    struct RenderGraphImageDesc
+    {
+        vk::Format format = vk::Format::eUndefined;
+        vk::Extent2D extent;
+        vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+        vk::ImageUsageFlags usage;
+    };
+
+    class RenderGraph;
+    class GpuProfiler;
+
+    /**
+     * @class RenderGraphPass
+     * @brief Declares what one pass of a render graph reads and writes, returned by RenderGraph::add_pass.
+     *
+     * Passes run in the order they were added. A pass with attachments is recorded inside a render
+     * pass the graph creates, or between beginRendering and endRendering with dynamic rendering, a
+     * pass without runs its callback as is, for copies and compute.
+     */
+    class RenderGraphPass
+    {
+    public:
+        RenderGraphPass(RenderGraph& graph, uint32_t index);
+        /**
+         * @brief Renders to a color attachment, cleared first when a clear value is given and loaded otherwise.
+         */
+        RenderGraphPass& write_color(RenderGraphImage image, std::optional<vk::ClearColorValue> clear = std::nullopt);
+        /**
+         * @brief Resolves the pass's multisampled color attachments into an image, in the order they were written.
+         */
+        RenderGraphPass& resolve(RenderGraphImage image);
+        /**
+         * @brief Tests against and writes a depth attachment, cleared first when a clear value is given.
+         */
+        RenderGraphPass& write_depth(RenderGraphImage image, std::optional<vk::ClearDepthStencilValue> clear = std::nullopt);
+        /**
+         * @brief Tests against a depth attachment without writing it.
+         */
+        RenderGraphPass& read_depth(RenderGraphImage image);
+        /**
+         * @brief Samples an image in shaders of the given stages.
+         */
+        RenderGraphPass& sample(RenderGraphImage image, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader);
+        /**
+         * @brief Copies from an image.
+         */
+        RenderGraphPass& copy_from(RenderGraphImage image);
+        /**
+         * @brief Copies into an image, which is not loaded first.
+         */
+        RenderGraphPass& copy_to(RenderGraphImage image);
+        /**
+         * @brief Keeps the pass even when nothing in the graph reads what it writes, for effects outside the graph.
+         */
+        RenderGraphPass& keep();
+        /**
+         * @brief Sets what the pass records. Called inside the pass's rendering when it has attachments.
+         */
+        RenderGraphPass& execute(std::function<void(vk::CommandBuffer)> callback);
+    private:
+        RenderGraph& graph_;
+        uint32_t index_;
+    };
+
+    /**
+     * @class RenderGraph
+     * @brief A frame declared as passes and the images they read and write.
+     *
+     * compile() culls every pass whose results nothing needs, works out each transient image's
+     * lifetime and lets images whose lifetimes don't overlap share memory. Attachments that live
+     * within a single pass, such as multisampled color resolved at the end of it, are never stored
+     * and get lazily allocated memory where the device_ has it, which tile based GPUs never back. execute() then records
+     * the passes with the barriers and layout transitions between them computed from the declared
+     * accesses: a pass gets a single pipeline barrier, and reads following reads in the same layout
+     * get none.
+     *
+     * Built once and executed every frame. Imported images, such as the swap chain image, are set
+     * before every execute, start the frame with undefined contents once the color attachment
+     * output stage is reached, and end it in their final layout. Not thread safe.
+     *
+     * With dynamic rendering passes begin rendering straight on the image views, and neither render
+     * passes nor framebuffers exist. With synchronization2 every barrier of a pass waits on and
+     * blocks only the stages of its own image rather than the union over the pass. Without either
+     * the graph falls back to render pass objects and the original barriers, for drivers before 1.3.
+     */
+    class RenderGraph
+    {
+    public:
+        /**
+         * @param device The Vulkan logical device_.
+         * @param physical_device The Vulkan physical device_, transient memory is allocated from.
+         * @param dynamic_rendering Whether the device_ was created with dynamic rendering enabled.
+         * @param synchronization2 Whether the device_ was created with synchronization2 enabled.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        RenderGraph(vk::Device device, vk::PhysicalDevice physical_device, bool dynamic_rendering, bool synchronization2, bool debug);
+        ~RenderGraph();
+        RenderGraph(const RenderGraph&) = delete;
+        RenderGraph& operator=(const RenderGraph&) = delete;
+        /**
+         * @brief Adds an image owned outside the graph. Passes writing it are never culled.
+         * @param name The image's name, for debug output.
+         * @param desc The image's format and extent.
+         * @param final_layout The layout the image is left in at the end of a frame.
+         */
+        RenderGraphImage import_image(const std::string& name, const RenderGraphImageDesc& desc, vk::ImageLayout final_layout);
+        /**
+         * @brief Adds an image the graph creates, which only lives within a frame.
+         */
+        RenderGraphImage create_image(const std::string& name, const RenderGraphImageDesc& desc);
+        RenderGraphPass add_pass(const std::string& name);
+        /**
+         * @brief Culls passes, creates transient images, render passes and memory.
+         * @return False with the reason printed if the graph is invalid or creating its objects failed.
+         */
+        bool compile();
+        /**
+         * @brief Sets the image an imported image refers to for the next execute.
+         */
+        void set_image(RenderGraphImage image, vk::Image handle, vk::ImageView view);
+        /**
+         * @brief The image a graph image refers to, for pass callbacks recording commands on it by hand.
+         */
+        [[nodiscard]] vk::Image image(RenderGraphImage image) const;
+        /**
+         * @brief Records every pass that survived culling.
+         * @param command_buffer The command buffer to record into.
+         * @param profiler Times every pass in a scope of the pass's name, or nullptr not to.
+         */
+        void execute(vk::CommandBuffer command_buffer, GpuProfiler* profiler = nullptr);
+    private:
+        friend class RenderGraphPass;
+
+        enum class AccessKind
+        {
+            eColorAttachment,
+            eResolve,
+            eDepthAttachment,
+            eDepthRead,
+            eSampled,
+            eTransferSrc,
+            eTransferDst
+        };
+        struct Access
+        {
+            uint32_t image;
+            AccessKind kind;
+            vk::PipelineStageFlags stages;
+            std::optional<vk::ClearValue> clear;
+        };
+        struct ImageState
+        {
+            vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+            vk::PipelineStageFlags stages;
+            vk::AccessFlags access;
+        };
+        struct Usage
+        {
+            ImageState state;
+            vk::ImageUsageFlags usage;
+        };
+        // an image barrier with the stages of its own access, folded together without synchronization2
+        struct Barrier
+        {
+            vk::ImageMemoryBarrier barrier;
+            vk::PipelineStageFlags src;
+            vk::PipelineStageFlags dst;
+        };
+        // an attachment of a pass, in declaration order, with what its rendering does to it
+        struct Attachment
+        {
+            uint32_t image;
+            AccessKind kind;
+            vk::ImageLayout layout;
+            vk::AttachmentLoadOp loadOp;
+            vk::AttachmentStoreOp storeOp;
+        };
+        struct Image
+        {
+            std::string name;
+            RenderGraphImageDesc desc;
+            bool imported = false;
+            vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+            vk::Image image;
+            vk::ImageView view;
+            // the passes using the image, when it survived culling
+            std::optional<uint32_t> firstPass;
+            uint32_t lastPass = 0;
+            uint32_t block = UINT32_MAX;
+            ImageState state;
+            bool touched = false;
+        };
+        struct Pass
+        {
+            std::string name;
+            std::vector<Access> accesses;
+            std::function<void(vk::CommandBuffer)> callback;
+            bool keep = false;
+            bool culled = false;
+            vk::RenderPass renderPass;
+            vk::Extent2D extent;
+            std::vector<Attachment> attachments;
+            std::vector<vk::ClearValue> clearValues;
+            std::map<std::vector<VkImageView>, vk::Framebuffer> framebuffers;
+        };
+        // transient images sharing memory, used one after the other
+        struct MemoryBlock
+        {
+            vk::DeviceSize size = 0;
+            uint32_t memoryTypeBits = UINT32_MAX;
+            uint32_t lastPass = 0;
+            bool lazy = false;
+            vk::DeviceMemory memory;
+            // the last access to any image in the block, across frames
+            ImageState last;
+        };
+
+        static Usage Describe(const Access& access);
+        static bool Overwrites(const Access& access);
+        [[nodiscard]] bool IsPassLocal(uint32_t image) const;
+        void Cull();
+        bool CreateImages();
+        bool PlanAttachments(uint32_t pass);
+        bool CreateRenderPass(uint32_t pass);
+        vk::Framebuffer Framebuffer(Pass& pass);
+        void RecordPass(vk::CommandBuffer command_buffer, Pass& pass, std::vector<Barrier>& barriers);
+        void BeginRendering(vk::CommandBuffer command_buffer, const Pass& pass);
+        void Transition(Image& image, const ImageState& required, bool discard, std::vector<Barrier>& barriers);
+        void RecordBarriers(vk::CommandBuffer command_buffer, const std::vector<Barrier>& barriers) const;
+
+        vk::Device device_;
+        vk::PhysicalDevice physical_device_;
+        bool dynamic_rendering_;
+        bool synchronization2_;
+        bool debug_;
+        bool compiled_;
+        std::vector<Image> images_;
+        std::vector<Pass> passes_;
+        std::vector<MemoryBlock> blocks_;
+    };
+}
+#endif //INC_3DLOADERVK_RENDER_GRAPH_HPP
@@ -0,0 +1,44 @@
+/**
+ * @file render_settings.hpp
+ * @brief Defines the RenderSettings struct, the choices that shape the passes of a frame.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_RENDER_SETTINGS_HPP
+#define INC_3DLOADERVK_RENDER_SETTINGS_HPP
+#include <vulkan/vulkan.hpp>
+#include <string>
+
+namespace vkutil
+{
+    /**
+     * @struct RenderSettings
+     * @brief How the engine renders a frame, fixed for the lifetime of the engine.
+     *
+     * depthPrepass lays down depth in a pass of its own before the color pass, which then only
+     * shades the fragments that pass an equal test. It pays on scenes with heavy overdraw and costs
+     * a second geometry pass everywhere else.
+     *
+     * samples is the MSAA sample count, lowered to what the device_ supports. Above one, color and
+     * depth are rendered multisampled into transient attachments and resolved into the swap chain
+     * image at the end of the color pass.
+     *
+     * headless renders without a window_ or surface_ into offscreen images the engine creates, one
+     * per frame in flight, left ready to be copied from. The draw code is the same, only acquiring
+     * and presenting are skipped, so it runs on devices and drivers that can't present, such as lavapipe.
+     *
+     * device picks the GPU over the one scoring highest, by its index in enumeration order or part
+     * of its name. Empty falls back to the VKLOADER_DEVICE environment variable, then to the score.
+     *
+     * gpuTrace is a file the GPU time of every frame and pass is written to as Chrome trace events.
+     * Empty falls back to the VKLOADER_GPU_TRACE environment variable, then to no trace.
+     */
+    struct RenderSettings
+    {
+        bool depthPrepass = false;
+        vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+        bool headless = false;
+        std::string device;
+        std::string gpuTrace;
+    };
+}
+#endif //INC_3DLOADERVK_RENDER_SETTINGS_HPP
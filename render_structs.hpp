@@ -4,12 +4,54 @@
 #ifndef INC_3DLOADERVK_RENDER_STRUCTS_HPP
 #define INC_3DLOADERVK_RENDER_STRUCTS_HPP
 #include <glm/glm.hpp>
+#include <cstdint>
 
 namespace vkutil
 {
+    /**
+     * @struct ObjectData
+     * @brief An object of the scene_ as shaders see it, std430 to match Object in shaders/object.glsl.
+     */
     struct ObjectData
     {
         glm::mat4 model;
+        // multiplies the vertex colors
+        glm::vec4 color;
+    };
+    /**
+     * @struct DrawIds
+     * @brief The push constants of a draw: the bindless buffer holding the frame's objects and the object drawn.
+     */
+    struct DrawIds
+    {
+        uint32_t objectBuffer;
+        uint32_t object;
+    };
+    /**
+     * @struct CameraData
+     * @brief The camera as shaders see it, std140 to match the Camera block in shaders/camera.glsl.
+     *
+     * The frustum planes point inwards as (normal, distance), a point is inside when
+     * dot(plane.xyz, point) + plane.w >= 0 for all six, so culling and LOD read the same data.
+     */
+    struct CameraData
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::vec4 position;
+        glm::vec4 frustum[6];
+    };
+    /**
+     * @struct CullingData
+     * @brief The push constants of shaders/cull.comp.
+     */
+    struct CullingData
+    {
+        glm::vec4 frustum[6];
+        uint32_t objectCount;
+        // vertices every visible object's draw command draws
+        uint32_t vertexCount;
     };
 }
 #endif //INC_3DLOADERVK_RENDER_STRUCTS_HPP
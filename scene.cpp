@@ -2,9 +2,14 @@
 // Created by daily on 01-01-24.
 //
 #include "scene.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
 
 Scene::Scene()
 {
+    sequence_ = 0;
+    time_ = 0.0;
 //eTriangleList
 
 //    for(float x = -1.0f; x < 1.0f; x += 0.2f)
@@ -18,4 +23,70 @@ Scene::Scene()
 //eTriangleStrip
     triangle_positions_.emplace_back(-0.5f, 0.0f, 0.0f);
     triangle_positions_.emplace_back(0.5f, 0.0f, 0.0f);
+}
+
+void Scene::update(double time)
+{
+    time_ = time;
+    sequence_++;
+}
+
+bool Scene::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if(!file)
+    {
+        std::cout << "Failed to open scene " << path << "\n";
+        return false;
+    }
+    std::vector<glm::vec3> positions;
+    Camera camera = camera_;
+    std::string line;
+    int number = 0;
+    while(std::getline(file, line))
+    {
+        ++number;
+        std::istringstream statement(line.substr(0, line.find('#')));
+        std::string keyword;
+        if(!(statement >> keyword))
+        {
+            continue;
+        }
+        glm::vec3 position(0.0f);
+        glm::vec3 target(0.0f);
+        float fov = 0.0f;
+        bool parsed = false;
+        if(keyword == "quad")
+        {
+            parsed = static_cast<bool>(statement >> position.x >> position.y >> position.z);
+            positions.push_back(position);
+        }
+        else if(keyword == "camera")
+        {
+            parsed = static_cast<bool>(statement >> position.x >> position.y >> position.z >> target.x >> target.y >> target.z);
+            camera.look_at(position, target);
+        }
+        else if(keyword == "fov")
+        {
+            parsed = static_cast<bool>(statement >> fov);
+            camera.set_perspective(glm::radians(fov), 0.1f, 100.0f);
+        }
+        std::string rest;
+        if(!parsed || statement >> rest)
+        {
+            std::cout << path << ":" << number << ": can't parse \"" << line << "\"\n";
+            return false;
+        }
+    }
+    triangle_positions_ = positions;
+    camera_ = camera;
+    return true;
+}
+
+void Scene::snapshot(SceneSnapshot& out) const
+{
+    out.sequence = sequence_;
+    out.time = time_;
+    out.triangle_positions.assign(triangle_positions_.begin(), triangle_positions_.end());
+    out.camera = camera_;
 }
\ No newline at end of file
@@ -3,12 +3,56 @@
 //
 #ifndef INC_3DLOADERVK_SCENE_HPP
 #define INC_3DLOADERVK_SCENE_HPP
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <glm/glm.hpp>
+#include "camera.hpp"
+/**
+ * @struct SceneSnapshot
+ * @brief An immutable copy of everything the renderer needs from the scene for one frame.
+ *
+ * Snapshots are written by the simulation thread and read by the render thread, never both at once.
+ */
+struct SceneSnapshot
+{
+    uint64_t sequence = 0;
+    double time = 0.0;
+    std::vector<glm::vec3> triangle_positions;
+    Camera camera;
+};
+
 class Scene
 {
 public:
     Scene();
+    /**
+     * @brief Advances the simulation to the given time.
+     * @param time Seconds since the application started.
+     */
+    void update(double time);
+    /**
+     * @brief Copies the current state into a snapshot, reusing the snapshot's storage.
+     * @param out The snapshot to overwrite.
+     */
+    void snapshot(SceneSnapshot& out) const;
+    /**
+     * @brief Replaces the quads and camera with a scene description read from a text file.
+     *
+     * One statement per line, blank lines and anything after a '#' are ignored:
+     *   quad <x> <y> <z>
+     *   camera <x> <y> <z> <target x> <target y> <target z>
+     *   fov <vertical field of view in degrees>
+     *
+     * @param path The file to read.
+     * @return false with the reason printed if the file can't be read or a line can't be parsed,
+     *         in which case the scene is left as it was.
+     */
+    bool load(const std::string& path);
     std::vector<glm::vec3> triangle_positions_;
+    Camera camera_;
+private:
+    uint64_t sequence_;
+    double time_;
 };
 #endif //INC_3DLOADERVK_SCENE_HPP
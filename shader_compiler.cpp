@@ -0,0 +1,420 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "shader_compiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include "mapped_file.hpp"
+#include "shaders.hpp"
+namespace vkutil
+{
+    namespace
+    {
+        // bumped whenever the key or the compile flags change, so old cache entries are ignored
+        constexpr uint32_t kCacheFormatVersion = 1;
+#ifdef VKLOADER_HAVE_SHADERC
+        constexpr const char* kBackend = "shaderc";
+#else
+        constexpr const char* kBackend = "glslc";
+#endif
+
+        class Fnv1a
+        {
+        public:
+            void add(const void* data, size_t size)
+            {
+                const uint8_t* bytes = static_cast<const uint8_t*>(data);
+                for(size_t i = 0; i < size; i++)
+                {
+                    hash_ ^= bytes[i];
+                    hash_ *= 0x100000001b3ull;
+                }
+            }
+            void add(const std::string& text)
+            {
+                // the terminator keeps "ab" + "c" apart from "a" + "bc"
+                add(text.c_str(), text.size() + 1);
+            }
+            [[nodiscard]] uint64_t value() const
+            {
+                return hash_;
+            }
+        private:
+            uint64_t hash_ = 0xcbf29ce484222325ull;
+        };
+
+        std::optional<std::string> read_text(const std::filesystem::path& path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if(!file.is_open())
+            {
+                return std::nullopt;
+            }
+            std::ostringstream text;
+            text << file.rdbuf();
+            return text.str();
+        }
+
+        /**
+         * @brief Returns the targets of the #include directives in a GLSL source.
+         */
+        std::vector<std::string> find_includes(const std::string& text)
+        {
+            std::vector<std::string> includes;
+            std::istringstream lines(text);
+            std::string line;
+            while(std::getline(lines, line))
+            {
+                size_t start = line.find_first_not_of(" \t");
+                if(start == std::string::npos || line.compare(start, 8, "#include") != 0)
+                {
+                    continue;
+                }
+                size_t open = line.find_first_of("\"<", start + 8);
+                if(open == std::string::npos)
+                {
+                    continue;
+                }
+                size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+                if(close != std::string::npos)
+                {
+                    includes.push_back(line.substr(open + 1, close - open - 1));
+                }
+            }
+            return includes;
+        }
+
+        /**
+         * @brief Resolves an include next to the file that includes it first, then in the source directory.
+         */
+        std::filesystem::path resolve_include(const std::string& include, const std::filesystem::path& includer,
+                                              const std::filesystem::path& source_directory)
+        {
+            std::error_code error;
+            std::filesystem::path relative = includer.parent_path() / include;
+            if(std::filesystem::is_regular_file(relative, error))
+            {
+                return relative;
+            }
+            return source_directory / include;
+        }
+
+        void hash_source(Fnv1a& hash, const std::filesystem::path& path, const std::string& text,
+                         const std::filesystem::path& source_directory, std::set<std::filesystem::path>& visited)
+        {
+            hash.add(text);
+            for(const std::string& include : find_includes(text))
+            {
+                std::filesystem::path resolved = resolve_include(include, path, source_directory);
+                hash.add(include);
+                if(!visited.insert(resolved.lexically_normal()).second)
+                {
+                    continue;
+                }
+                std::optional<std::string> included = read_text(resolved);
+                if(included)
+                {
+                    hash_source(hash, resolved, *included, source_directory, visited);
+                }
+            }
+        }
+
+        std::vector<uint32_t> load_spirv(const std::filesystem::path& path)
+        {
+            MappedFile file(path);
+            if(!is_spirv(file.data(), file.size()))
+            {
+                return { };
+            }
+            std::vector<uint32_t> words(file.size() / sizeof(uint32_t));
+            std::memcpy(words.data(), file.data(), file.size());
+            return words;
+        }
+
+#ifdef VKLOADER_HAVE_SHADERC
+        shaderc_shader_kind shader_kind(const std::filesystem::path& source)
+        {
+            std::string extension = source.extension().string();
+            if(extension == ".vert")
+            {
+                return shaderc_vertex_shader;
+            }
+            if(extension == ".frag")
+            {
+                return shaderc_fragment_shader;
+            }
+            if(extension == ".comp")
+            {
+                return shaderc_compute_shader;
+            }
+            if(extension == ".geom")
+            {
+                return shaderc_geometry_shader;
+            }
+            if(extension == ".tesc")
+            {
+                return shaderc_tess_control_shader;
+            }
+            if(extension == ".tese")
+            {
+                return shaderc_tess_evaluation_shader;
+            }
+            return shaderc_glsl_infer_from_source;
+        }
+
+        /**
+         * @brief Serves #include directives from disk, with the same lookup rules as the cache key.
+         */
+        class Includer : public shaderc::CompileOptions::IncluderInterface
+        {
+        public:
+            explicit Includer(std::filesystem::path source_directory)
+                : source_directory_(std::move(source_directory))
+            {
+            }
+
+            shaderc_include_result* GetInclude(const char* requested_source, shaderc_include_type,
+                                               const char* requesting_source, size_t) override
+            {
+                Include* include = new Include();
+                std::filesystem::path path = resolve_include(requested_source, requesting_source, source_directory_);
+                std::optional<std::string> text = read_text(path);
+                if(text)
+                {
+                    include->name = path.string();
+                    include->content = std::move(*text);
+                }
+                else
+                {
+                    // an empty name tells shaderc the content is an error message
+                    include->content = "Cannot open include \"" + std::string(requested_source) + "\"";
+                }
+                include->result.source_name = include->name.c_str();
+                include->result.source_name_length = include->name.size();
+                include->result.content = include->content.c_str();
+                include->result.content_length = include->content.size();
+                include->result.user_data = include;
+                return &include->result;
+            }
+
+            void ReleaseInclude(shaderc_include_result* data) override
+            {
+                delete static_cast<Include*>(data->user_data);
+            }
+        private:
+            struct Include
+            {
+                std::string name;
+                std::string content;
+                shaderc_include_result result = { };
+            };
+
+            std::filesystem::path source_directory_;
+        };
+#endif
+    }
+
+    std::string find_glslc()
+    {
+        if(const char* glslc = std::getenv("GLSLC"))
+        {
+            return glslc;
+        }
+        if(const char* sdk = std::getenv("VULKAN_SDK"))
+        {
+#ifdef _WIN32
+            std::filesystem::path candidate = std::filesystem::path(sdk) / "Bin" / "glslc.exe";
+#else
+            std::filesystem::path candidate = std::filesystem::path(sdk) / "bin" / "glslc";
+#endif
+            if(std::filesystem::exists(candidate))
+            {
+                return candidate.string();
+            }
+        }
+        return "glslc";
+    }
+
+    ShaderCompiler::ShaderCompiler(std::filesystem::path source_directory, std::filesystem::path cache_directory, bool debug)
+        : source_directory_(std::move(source_directory)), cache_directory_(std::move(cache_directory))
+    {
+        debug_ = debug;
+        temp_counter_ = 0;
+#ifndef VKLOADER_HAVE_SHADERC
+        compiler_ = find_glslc();
+#endif
+        std::error_code error;
+        std::filesystem::create_directories(cache_directory_, error);
+        if(error)
+        {
+            std::cerr << "Failed to create the shader cache " << cache_directory_.string() << ": " << error.message() << "\n";
+        }
+        if(debug_)
+        {
+            std::cout << "Compiling shader variants from " << source_directory_.string() << " with " << kBackend
+                      << ", caching them in " << cache_directory_.string() << "\n";
+        }
+    }
+
+    std::vector<uint32_t> ShaderCompiler::compile(const std::string& name, const std::vector<std::string>& defines)
+    {
+        std::optional<uint64_t> key = Key(source_directory_ / name, defines);
+        if(!key)
+        {
+            std::cerr << "Shader source \"" << name << "\" not found in " << source_directory_.string() << "\n";
+            return { };
+        }
+        std::promise<std::vector<uint32_t>> promise;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto found = variants_.find(*key);
+            if(found != variants_.end())
+            {
+                std::shared_future<std::vector<uint32_t>> pending = found->second;
+                lock.unlock();
+                return pending.get();
+            }
+            variants_.emplace(*key, promise.get_future().share());
+        }
+        // a failed variant stays in the map, it fails the same way until its source changes
+        std::vector<uint32_t> words = Build(name, defines, *key);
+        promise.set_value(words);
+        return words;
+    }
+
+    bool ShaderCompiler::has_source(const std::string& name) const
+    {
+        std::error_code error;
+        return std::filesystem::is_regular_file(source_directory_ / name, error);
+    }
+
+    /**
+     * @brief Hashes everything the SPIR-V of a variant depends on, nullopt when the source can't be read.
+     */
+    std::optional<uint64_t> ShaderCompiler::Key(const std::filesystem::path& source, const std::vector<std::string>& defines) const
+    {
+        std::optional<std::string> text = read_text(source);
+        if(!text)
+        {
+            return std::nullopt;
+        }
+        Fnv1a hash;
+        hash.add(&kCacheFormatVersion, sizeof(kCacheFormatVersion));
+        hash.add(kBackend);
+        hash.add(source.filename().string());
+        std::vector<std::string> sorted = defines;
+        std::sort(sorted.begin(), sorted.end());
+        for(const std::string& define : sorted)
+        {
+            hash.add(define);
+        }
+        std::set<std::filesystem::path> visited = { source.lexically_normal() };
+        hash_source(hash, source, *text, source_directory_, visited);
+        return hash.value();
+    }
+
+    std::vector<uint32_t> ShaderCompiler::Build(const std::string& name, const std::vector<std::string>& defines, uint64_t key)
+    {
+        std::ostringstream file_name;
+        file_name << name << "." << std::hex << key << ".spv";
+        std::filesystem::path spirv = cache_directory_ / file_name.str();
+        std::vector<uint32_t> words = load_spirv(spirv);
+        if(!words.empty())
+        {
+            if(debug_)
+            {
+                std::cout << "Loaded " << file_name.str() << " from the shader cache\n";
+            }
+            return words;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        words = Compile(source_directory_ / name, defines, spirv);
+        if(debug_ && !words.empty())
+        {
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Compiled " << file_name.str() << " in " << elapsed << " ms\n";
+        }
+        return words;
+    }
+
+    /**
+     * @brief Compiles a variant and stores it at spirv, through a temporary file renamed into place.
+     */
+    std::vector<uint32_t> ShaderCompiler::Compile(const std::filesystem::path& source, const std::vector<std::string>& defines,
+                                                  const std::filesystem::path& spirv)
+    {
+        std::filesystem::path temp = spirv;
+        temp += ".tmp" + std::to_string(temp_counter_++);
+#ifdef VKLOADER_HAVE_SHADERC
+        std::optional<std::string> text = read_text(source);
+        if(!text)
+        {
+            return { };
+        }
+        shaderc::CompileOptions options;
+        for(const std::string& define : defines)
+        {
+            size_t equals = define.find('=');
+            if(equals == std::string::npos)
+            {
+                options.AddMacroDefinition(define);
+            }
+            else
+            {
+                options.AddMacroDefinition(define.substr(0, equals), define.substr(equals + 1));
+            }
+        }
+        options.SetIncluder(std::make_unique<Includer>(source_directory_));
+        shaderc::SpvCompilationResult result = compiler_.CompileGlslToSpv(*text, shader_kind(source), source.string().c_str(), options);
+        if(result.GetCompilationStatus() != shaderc_compilation_status_success)
+        {
+            std::cerr << "Failed to compile " << source.string() << ":\n" << result.GetErrorMessage();
+            return { };
+        }
+        std::vector<uint32_t> words(result.cbegin(), result.cend());
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(uint32_t)));
+            if(!file)
+            {
+                std::error_code ignored;
+                std::filesystem::remove(temp, ignored);
+                return words;
+            }
+        }
+#else
+        std::string command = "\"" + compiler_ + "\"";
+        for(const std::string& define : defines)
+        {
+            command += " \"-D" + define + "\"";
+        }
+        command += " -I \"" + source_directory_.string() + "\" \"" + source.string() + "\" -o \"" + temp.string() + "\"";
+#ifdef _WIN32
+        // cmd strips the outer quotes of a command line that starts with one
+        command = "\"" + command + "\"";
+#endif
+        if(std::system(command.c_str()) != 0)
+        {
+            std::cerr << "Failed to compile " << source.string() << "\n";
+            std::error_code ignored;
+            std::filesystem::remove(temp, ignored);
+            return { };
+        }
+        std::vector<uint32_t> words = load_spirv(temp);
+#endif
+        std::error_code error;
+        std::filesystem::rename(temp, spirv, error);
+        if(error)
+        {
+            // still usable, it just gets compiled again next launch
+            std::filesystem::remove(temp, error);
+        }
+        return words;
+    }
+}
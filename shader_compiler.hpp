@@ -0,0 +1,82 @@
+/**
+ * @file shader_compiler.hpp
+ * @brief Defines the ShaderCompiler class, which compiles GLSL variants at runtime and caches the SPIR-V on disk.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_SHADER_COMPILER_HPP
+#define INC_3DLOADERVK_SHADER_COMPILER_HPP
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef VKLOADER_HAVE_SHADERC
+#include <shaderc/shaderc.hpp>
+#endif
+
+namespace vkutil
+{
+    /**
+     * @brief Finds glslc: the GLSLC variable, then the Vulkan SDK, then whatever is on the PATH.
+     */
+    std::string find_glslc();
+
+    /**
+     * @class ShaderCompiler
+     * @brief Compiles GLSL sources to SPIR-V at runtime, one variant per set of preprocessor defines.
+     *
+     * Every variant is keyed on a hash of its source, the sources it includes and its defines, and
+     * the SPIR-V is kept in the cache directory under that key, so a launch only compiles variants
+     * whose inputs changed. Compiles go through shaderc when the build found it and run glslc
+     * otherwise.
+     *
+     * Thread safe. Threads asking for different variants compile them in parallel, threads asking
+     * for the same one wait for a single compile.
+     */
+    class ShaderCompiler
+    {
+    public:
+        /**
+         * @param source_directory The directory holding the GLSL sources and their includes.
+         * @param cache_directory The directory the compiled variants are kept in, created when missing.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        ShaderCompiler(std::filesystem::path source_directory, std::filesystem::path cache_directory, bool debug);
+        ShaderCompiler(const ShaderCompiler&) = delete;
+        ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+        /**
+         * @brief Returns the SPIR-V of a variant, from memory, the disk cache or a fresh compile.
+         * @param name The source file name, such as "shader.vert".
+         * @param defines Preprocessor definitions, "NAME" or "NAME=VALUE". Order doesn't matter.
+         * @return The SPIR-V words, empty when the source is missing or fails to compile.
+         */
+        std::vector<uint32_t> compile(const std::string& name, const std::vector<std::string>& defines);
+        /**
+         * @brief Whether a source with this name exists in the source directory.
+         */
+        [[nodiscard]] bool has_source(const std::string& name) const;
+    private:
+        [[nodiscard]] std::optional<uint64_t> Key(const std::filesystem::path& source, const std::vector<std::string>& defines) const;
+        std::vector<uint32_t> Build(const std::string& name, const std::vector<std::string>& defines, uint64_t key);
+        std::vector<uint32_t> Compile(const std::filesystem::path& source, const std::vector<std::string>& defines,
+                                      const std::filesystem::path& spirv);
+
+        std::filesystem::path source_directory_;
+        std::filesystem::path cache_directory_;
+        bool debug_;
+#ifdef VKLOADER_HAVE_SHADERC
+        shaderc::Compiler compiler_;
+#else
+        std::string compiler_;
+#endif
+        std::mutex mutex_;
+        std::unordered_map<uint64_t, std::shared_future<std::vector<uint32_t>>> variants_;
+        std::atomic<uint64_t> temp_counter_;
+    };
+}
+#endif //INC_3DLOADERVK_SHADER_COMPILER_HPP
@@ -0,0 +1,789 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "shader_reflection.hpp"
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+namespace vkutil
+{
+    namespace
+    {
+        constexpr uint32_t kSpirvMagic = 0x07230203;
+        constexpr size_t kHeaderWords = 5;
+
+        // the subset of the SPIR-V specification reflection needs
+        enum Op : uint32_t
+        {
+            OpName = 5,
+            OpEntryPoint = 15,
+            OpTypeBool = 20,
+            OpTypeInt = 21,
+            OpTypeFloat = 22,
+            OpTypeVector = 23,
+            OpTypeMatrix = 24,
+            OpTypeImage = 25,
+            OpTypeSampler = 26,
+            OpTypeSampledImage = 27,
+            OpTypeArray = 28,
+            OpTypeRuntimeArray = 29,
+            OpTypeStruct = 30,
+            OpTypePointer = 32,
+            OpConstant = 43,
+            OpVariable = 59,
+            OpDecorate = 71,
+            OpMemberDecorate = 72,
+            OpTypeAccelerationStructureKHR = 5341
+        };
+
+        enum Decoration : uint32_t
+        {
+            DecorationSpecId = 1,
+            DecorationBlock = 2,
+            DecorationBufferBlock = 3,
+            DecorationArrayStride = 6,
+            DecorationMatrixStride = 7,
+            DecorationBuiltIn = 11,
+            DecorationLocation = 30,
+            DecorationBinding = 33,
+            DecorationDescriptorSet = 34,
+            DecorationOffset = 35
+        };
+
+        enum StorageClass : uint32_t
+        {
+            StorageClassUniformConstant = 0,
+            StorageClassInput = 1,
+            StorageClassUniform = 2,
+            StorageClassOutput = 3,
+            StorageClassPushConstant = 9,
+            StorageClassStorageBuffer = 12
+        };
+
+        constexpr uint32_t kDimBuffer = 5;
+        constexpr uint32_t kDimSubpassData = 6;
+
+        struct Decorations
+        {
+            std::optional<uint32_t> location;
+            std::optional<uint32_t> binding;
+            std::optional<uint32_t> set;
+            uint32_t arrayStride = 0;
+            bool block = false;
+            bool bufferBlock = false;
+            bool builtIn = false;
+        };
+
+        struct MemberDecorations
+        {
+            uint32_t offset = 0;
+            uint32_t matrixStride = 0;
+            bool builtIn = false;
+        };
+
+        struct Type
+        {
+            uint32_t opcode = 0;
+            // operands after the result id
+            std::vector<uint32_t> operands;
+        };
+
+        struct Variable
+        {
+            uint32_t id = 0;
+            uint32_t pointerType = 0;
+            uint32_t storageClass = 0;
+        };
+
+        std::string read_string(std::span<const uint32_t> words)
+        {
+            std::string text;
+            for(uint32_t word : words)
+            {
+                for(uint32_t shift = 0; shift < 32; shift += 8)
+                {
+                    char character = static_cast<char>((word >> shift) & 0xFF);
+                    if(character == '\0')
+                    {
+                        return text;
+                    }
+                    text.push_back(character);
+                }
+            }
+            return text;
+        }
+
+        /**
+         * @brief The ids, types and decorations of one module, gathered in a single pass over it.
+         */
+        class SpirvModule
+        {
+        public:
+            SpirvModule(std::span<const uint32_t> code, const std::string& name)
+                : name_(name)
+            {
+                valid_ = Parse(code);
+            }
+
+            [[nodiscard]] bool valid() const
+            {
+                return valid_;
+            }
+
+            std::optional<ShaderReflection> reflect()
+            {
+                ShaderReflection reflection;
+                reflection.stage = stage_;
+                for(const Variable& variable : variables_)
+                {
+                    const Type* pointer = Find(variable.pointerType);
+                    if(pointer == nullptr || pointer->opcode != OpTypePointer)
+                    {
+                        Fail("variable without a pointer type");
+                        return std::nullopt;
+                    }
+                    uint32_t pointee = pointer->operands[1];
+                    bool ok = true;
+                    switch(variable.storageClass)
+                    {
+                        case StorageClassInput:
+                            ok = AddVariables(variable.id, pointee, reflection.inputs);
+                            break;
+                        case StorageClassOutput:
+                            ok = AddVariables(variable.id, pointee, reflection.outputs);
+                            break;
+                        case StorageClassPushConstant:
+                            ok = SetPushConstants(pointee, reflection);
+                            break;
+                        case StorageClassUniformConstant:
+                        case StorageClassUniform:
+                        case StorageClassStorageBuffer:
+                            ok = AddResource(variable, pointee, reflection.resources);
+                            break;
+                        default:
+                            break;
+                    }
+                    if(!ok)
+                    {
+                        return std::nullopt;
+                    }
+                }
+                auto by_location = [](const ShaderVariable& a, const ShaderVariable& b) { return a.location < b.location; };
+                std::sort(reflection.inputs.begin(), reflection.inputs.end(), by_location);
+                std::sort(reflection.outputs.begin(), reflection.outputs.end(), by_location);
+                reflection.specializationIds = specialization_ids_;
+                std::sort(reflection.specializationIds.begin(), reflection.specializationIds.end());
+                return reflection;
+            }
+        private:
+            bool Parse(std::span<const uint32_t> code)
+            {
+                if(code.size() < kHeaderWords || code[0] != kSpirvMagic)
+                {
+                    return Fail("not a SPIR-V module");
+                }
+                bool has_entry_point = false;
+                size_t index = kHeaderWords;
+                while(index < code.size())
+                {
+                    uint32_t opcode = code[index] & 0xFFFF;
+                    uint32_t word_count = code[index] >> 16;
+                    if(word_count == 0 || index + word_count > code.size())
+                    {
+                        return Fail("truncated instruction");
+                    }
+                    std::span<const uint32_t> operands = code.subspan(index + 1, word_count - 1);
+                    index += word_count;
+                    if(operands.empty())
+                    {
+                        continue;
+                    }
+                    switch(opcode)
+                    {
+                        case OpName:
+                            names_[operands[0]] = read_string(operands.subspan(1));
+                            break;
+                        case OpEntryPoint:
+                            // the first entry point is the one pipelines use
+                            if(!has_entry_point && !SetStage(operands[0]))
+                            {
+                                return false;
+                            }
+                            has_entry_point = true;
+                            break;
+                        case OpDecorate:
+                            Decorate(operands);
+                            break;
+                        case OpMemberDecorate:
+                            DecorateMember(operands);
+                            break;
+                        case OpConstant:
+                            if(operands.size() >= 3)
+                            {
+                                constants_[operands[1]] = operands[2];
+                            }
+                            break;
+                        case OpVariable:
+                            if(operands.size() >= 3)
+                            {
+                                variables_.push_back({ operands[1], operands[0], operands[2] });
+                            }
+                            break;
+                        case OpTypeBool:
+                        case OpTypeInt:
+                        case OpTypeFloat:
+                        case OpTypeVector:
+                        case OpTypeMatrix:
+                        case OpTypeImage:
+                        case OpTypeSampler:
+                        case OpTypeSampledImage:
+                        case OpTypeArray:
+                        case OpTypeRuntimeArray:
+                        case OpTypeStruct:
+                        case OpTypePointer:
+                        case OpTypeAccelerationStructureKHR:
+                            if(operands.size() <= MinimumOperands(opcode))
+                            {
+                                return Fail("truncated type");
+                            }
+                            types_[operands[0]] = { opcode, std::vector<uint32_t>(operands.begin() + 1, operands.end()) };
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                if(!has_entry_point)
+                {
+                    return Fail("no entry point");
+                }
+                return true;
+            }
+
+            /**
+             * @brief How many operands after the result id the type instructions read are guaranteed.
+             */
+            static size_t MinimumOperands(uint32_t opcode)
+            {
+                switch(opcode)
+                {
+                    case OpTypeInt:
+                    case OpTypeVector:
+                    case OpTypeMatrix:
+                    case OpTypeArray:
+                    case OpTypePointer:
+                        return 2;
+                    case OpTypeFloat:
+                    case OpTypeSampledImage:
+                    case OpTypeRuntimeArray:
+                        return 1;
+                    case OpTypeImage:
+                        return 6;
+                    default:
+                        return 0;
+                }
+            }
+
+            bool SetStage(uint32_t execution_model)
+            {
+                constexpr std::array<vk::ShaderStageFlagBits, 6> kStages = {
+                        vk::ShaderStageFlagBits::eVertex,
+                        vk::ShaderStageFlagBits::eTessellationControl,
+                        vk::ShaderStageFlagBits::eTessellationEvaluation,
+                        vk::ShaderStageFlagBits::eGeometry,
+                        vk::ShaderStageFlagBits::eFragment,
+                        vk::ShaderStageFlagBits::eCompute
+                };
+                if(execution_model >= kStages.size())
+                {
+                    return Fail("unsupported execution model " + std::to_string(execution_model));
+                }
+                stage_ = kStages[execution_model];
+                return true;
+            }
+
+            void Decorate(std::span<const uint32_t> operands)
+            {
+                if(operands.size() < 2)
+                {
+                    return;
+                }
+                Decorations& decorations = decorations_[operands[0]];
+                uint32_t value = operands.size() > 2 ? operands[2] : 0;
+                switch(operands[1])
+                {
+                    case DecorationSpecId:
+                        specialization_ids_.push_back(value);
+                        break;
+                    case DecorationBlock:
+                        decorations.block = true;
+                        break;
+                    case DecorationBufferBlock:
+                        decorations.bufferBlock = true;
+                        break;
+                    case DecorationArrayStride:
+                        decorations.arrayStride = value;
+                        break;
+                    case DecorationBuiltIn:
+                        decorations.builtIn = true;
+                        break;
+                    case DecorationLocation:
+                        decorations.location = value;
+                        break;
+                    case DecorationBinding:
+                        decorations.binding = value;
+                        break;
+                    case DecorationDescriptorSet:
+                        decorations.set = value;
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            void DecorateMember(std::span<const uint32_t> operands)
+            {
+                if(operands.size() < 3)
+                {
+                    return;
+                }
+                std::vector<MemberDecorations>& members = member_decorations_[operands[0]];
+                if(members.size() <= operands[1])
+                {
+                    members.resize(operands[1] + 1);
+                }
+                MemberDecorations& member = members[operands[1]];
+                uint32_t value = operands.size() > 3 ? operands[3] : 0;
+                switch(operands[2])
+                {
+                    case DecorationOffset:
+                        member.offset = value;
+                        break;
+                    case DecorationMatrixStride:
+                        member.matrixStride = value;
+                        break;
+                    case DecorationBuiltIn:
+                        member.builtIn = true;
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            [[nodiscard]] const Type* Find(uint32_t id) const
+            {
+                auto found = types_.find(id);
+                return found == types_.end() ? nullptr : &found->second;
+            }
+
+            [[nodiscard]] Decorations DecorationsOf(uint32_t id) const
+            {
+                auto found = decorations_.find(id);
+                return found == decorations_.end() ? Decorations{ } : found->second;
+            }
+
+            [[nodiscard]] std::string NameOf(uint32_t id) const
+            {
+                auto found = names_.find(id);
+                return found == names_.end() ? "_" + std::to_string(id) : found->second;
+            }
+
+            [[nodiscard]] uint32_t ArrayLength(const Type& array) const
+            {
+                auto found = constants_.find(array.operands[1]);
+                return found == constants_.end() ? 0 : found->second;
+            }
+
+            /**
+             * @brief The size in bytes of a type in a buffer block, following its offset and stride decorations.
+             */
+            [[nodiscard]] uint32_t SizeOf(uint32_t id, uint32_t matrix_stride) const
+            {
+                const Type* type = Find(id);
+                if(type == nullptr || type->operands.empty())
+                {
+                    return 0;
+                }
+                switch(type->opcode)
+                {
+                    case OpTypeInt:
+                    case OpTypeFloat:
+                        return type->operands[0] / 8;
+                    case OpTypeVector:
+                        return type->operands[1] * SizeOf(type->operands[0], 0);
+                    case OpTypeMatrix:
+                        return type->operands[1] * (matrix_stride != 0 ? matrix_stride : SizeOf(type->operands[0], 0));
+                    case OpTypeArray:
+                    {
+                        uint32_t stride = DecorationsOf(id).arrayStride;
+                        return ArrayLength(*type) * (stride != 0 ? stride : SizeOf(type->operands[0], matrix_stride));
+                    }
+                    case OpTypeStruct:
+                    {
+                        auto found = member_decorations_.find(id);
+                        uint32_t size = 0;
+                        for(size_t member = 0; member < type->operands.size(); member++)
+                        {
+                            MemberDecorations decorations = { };
+                            if(found != member_decorations_.end() && member < found->second.size())
+                            {
+                                decorations = found->second[member];
+                            }
+                            size = std::max(size, decorations.offset + SizeOf(type->operands[member], decorations.matrixStride));
+                        }
+                        return size;
+                    }
+                    default:
+                        return 0;
+                }
+            }
+
+            /**
+             * @brief The vertex attribute format of a scalar or vector type, eUndefined for anything else.
+             */
+            [[nodiscard]] vk::Format FormatOf(uint32_t id, uint32_t& size) const
+            {
+                const Type* type = Find(id);
+                if(type == nullptr || type->operands.empty())
+                {
+                    return vk::Format::eUndefined;
+                }
+                uint32_t components = 1;
+                if(type->opcode == OpTypeVector)
+                {
+                    components = type->operands[1];
+                    type = Find(type->operands[0]);
+                    if(type == nullptr || type->operands.empty())
+                    {
+                        return vk::Format::eUndefined;
+                    }
+                }
+                constexpr std::array<vk::Format, 4> kFloat = { vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat };
+                constexpr std::array<vk::Format, 4> kDouble = { vk::Format::eR64Sfloat, vk::Format::eR64G64Sfloat, vk::Format::eR64G64B64Sfloat, vk::Format::eR64G64B64A64Sfloat };
+                constexpr std::array<vk::Format, 4> kSint = { vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint };
+                constexpr std::array<vk::Format, 4> kUint = { vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint };
+                if(components < 1 || components > 4)
+                {
+                    return vk::Format::eUndefined;
+                }
+                uint32_t width = type->operands[0];
+                size = components * width / 8;
+                if(type->opcode == OpTypeFloat && width == 32)
+                {
+                    return kFloat[components - 1];
+                }
+                if(type->opcode == OpTypeFloat && width == 64)
+                {
+                    return kDouble[components - 1];
+                }
+                if(type->opcode == OpTypeInt && width == 32 && type->operands.size() > 1)
+                {
+                    return type->operands[1] != 0 ? kSint[components - 1] : kUint[components - 1];
+                }
+                return vk::Format::eUndefined;
+            }
+
+            bool AddVariables(uint32_t id, uint32_t type_id, std::vector<ShaderVariable>& variables)
+            {
+                Decorations decorations = DecorationsOf(id);
+                const Type* type = Find(type_id);
+                if(decorations.builtIn || type == nullptr)
+                {
+                    return true;
+                }
+                if(type->opcode == OpTypeStruct)
+                {
+                    // gl_PerVertex and friends, user interface blocks aren't supported
+                    auto members = member_decorations_.find(type_id);
+                    bool built_in = members != member_decorations_.end() && !members->second.empty() && members->second[0].builtIn;
+                    return built_in || Fail("interface block \"" + NameOf(id) + "\" is not supported");
+                }
+                if(!decorations.location)
+                {
+                    return Fail("\"" + NameOf(id) + "\" has no location");
+                }
+                // arrays and matrices take one location per element or column
+                uint32_t element = type_id;
+                uint32_t locations = 1;
+                if(type->opcode == OpTypeArray || type->opcode == OpTypeMatrix)
+                {
+                    element = type->operands[0];
+                    locations = type->opcode == OpTypeArray ? ArrayLength(*type) : type->operands[1];
+                }
+                ShaderVariable variable;
+                variable.name = NameOf(id);
+                variable.format = FormatOf(element, variable.size);
+                if(variable.format == vk::Format::eUndefined)
+                {
+                    return Fail("\"" + variable.name + "\" has an unsupported type");
+                }
+                for(uint32_t offset = 0; offset < locations; offset++)
+                {
+                    variable.location = *decorations.location + offset;
+                    variables.push_back(variable);
+                }
+                return true;
+            }
+
+            bool SetPushConstants(uint32_t type_id, ShaderReflection& reflection)
+            {
+                const Type* type = Find(type_id);
+                if(type == nullptr || type->opcode != OpTypeStruct)
+                {
+                    return Fail("push constants are not a block");
+                }
+                uint32_t offset = UINT32_MAX;
+                auto members = member_decorations_.find(type_id);
+                for(size_t member = 0; member < type->operands.size(); member++)
+                {
+                    bool decorated = members != member_decorations_.end() && member < members->second.size();
+                    offset = std::min(offset, decorated ? members->second[member].offset : 0);
+                }
+                if(offset == UINT32_MAX)
+                {
+                    return true;
+                }
+                reflection.pushConstantOffset = offset;
+                reflection.pushConstantSize = SizeOf(type_id, 0) - offset;
+                return true;
+            }
+
+            bool AddResource(const Variable& variable, uint32_t type_id, std::vector<ShaderResource>& resources)
+            {
+                Decorations decorations = DecorationsOf(variable.id);
+                ShaderResource resource;
+                resource.name = NameOf(variable.id);
+                resource.set = decorations.set.value_or(0);
+                resource.binding = decorations.binding.value_or(0);
+                const Type* type = Find(type_id);
+                if(type != nullptr && (type->opcode == OpTypeArray || type->opcode == OpTypeRuntimeArray))
+                {
+                    resource.count = type->opcode == OpTypeArray ? ArrayLength(*type) : 0;
+                    type_id = type->operands[0];
+                    type = Find(type_id);
+                }
+                if(type == nullptr)
+                {
+                    return Fail("\"" + resource.name + "\" has an unknown type");
+                }
+                switch(type->opcode)
+                {
+                    case OpTypeStruct:
+                        if(variable.storageClass == StorageClassStorageBuffer || DecorationsOf(type_id).bufferBlock)
+                        {
+                            resource.type = vk::DescriptorType::eStorageBuffer;
+                        }
+                        else
+                        {
+                            resource.type = vk::DescriptorType::eUniformBuffer;
+                        }
+                        break;
+                    case OpTypeImage:
+                    {
+                        uint32_t dim = type->operands[1];
+                        uint32_t sampled = type->operands[5];
+                        if(dim == kDimBuffer)
+                        {
+                            resource.type = sampled == 2 ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+                        }
+                        else if(dim == kDimSubpassData)
+                        {
+                            resource.type = vk::DescriptorType::eInputAttachment;
+                        }
+                        else
+                        {
+                            resource.type = sampled == 2 ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+                        }
+                        break;
+                    }
+                    case OpTypeSampler:
+                        resource.type = vk::DescriptorType::eSampler;
+                        break;
+                    case OpTypeSampledImage:
+                        resource.type = vk::DescriptorType::eCombinedImageSampler;
+                        break;
+                    case OpTypeAccelerationStructureKHR:
+                        resource.type = vk::DescriptorType::eAccelerationStructureKHR;
+                        break;
+                    default:
+                        return Fail("\"" + resource.name + "\" has an unsupported descriptor type");
+                }
+                resources.push_back(resource);
+                return true;
+            }
+
+            bool Fail(const std::string& reason) const
+            {
+                std::cerr << "Failed to reflect \"" << name_ << "\": " << reason << "\n";
+                return false;
+            }
+
+            std::string name_;
+            bool valid_;
+            vk::ShaderStageFlagBits stage_ = vk::ShaderStageFlagBits::eVertex;
+            std::unordered_map<uint32_t, std::string> names_;
+            std::unordered_map<uint32_t, Decorations> decorations_;
+            std::unordered_map<uint32_t, std::vector<MemberDecorations>> member_decorations_;
+            std::unordered_map<uint32_t, Type> types_;
+            std::unordered_map<uint32_t, uint32_t> constants_;
+            std::vector<Variable> variables_;
+            std::vector<uint32_t> specialization_ids_;
+        };
+
+        /**
+         * @brief Whether a layout's descriptor type serves a reflected one. Shaders can't tell a
+         * dynamic buffer from a plain one, only the layout knows.
+         */
+        bool same_descriptor_type(vk::DescriptorType layout, vk::DescriptorType shader)
+        {
+            if(layout == vk::DescriptorType::eUniformBufferDynamic)
+            {
+                return shader == vk::DescriptorType::eUniformBuffer;
+            }
+            if(layout == vk::DescriptorType::eStorageBufferDynamic)
+            {
+                return shader == vk::DescriptorType::eStorageBuffer;
+            }
+            return layout == shader;
+        }
+
+        bool merge_resources(const ShaderReflection& stage, PipelineInterface& interface, const std::string& name)
+        {
+            for(const ShaderResource& resource : stage.resources)
+            {
+                if(interface.sets.size() <= resource.set)
+                {
+                    interface.sets.resize(resource.set + 1);
+                }
+                std::vector<vk::DescriptorSetLayoutBinding>& set = interface.sets[resource.set];
+                auto existing = std::find_if(set.begin(), set.end(), [&resource](const vk::DescriptorSetLayoutBinding& binding)
+                {
+                    return binding.binding == resource.binding;
+                });
+                if(existing == set.end())
+                {
+                    set.emplace_back(resource.binding, resource.type, resource.count, stage.stage);
+                    continue;
+                }
+                if(existing->descriptorType != resource.type || existing->descriptorCount != resource.count)
+                {
+                    std::cerr << name << ": set " << resource.set << " binding " << resource.binding
+                              << " is declared differently by two stages\n";
+                    return false;
+                }
+                existing->stageFlags |= stage.stage;
+            }
+            return true;
+        }
+    }
+
+    std::optional<ShaderReflection> reflect_shader(std::span<const uint32_t> code, const std::string& name)
+    {
+        SpirvModule module(code, name);
+        if(!module.valid())
+        {
+            return std::nullopt;
+        }
+        return module.reflect();
+    }
+
+    std::optional<PipelineInterface> link_shader_interface(const ShaderReflection& vertex, const ShaderReflection& fragment,
+                                                           const std::string& name)
+    {
+        PipelineInterface interface;
+        if(!merge_resources(vertex, interface, name) || !merge_resources(fragment, interface, name))
+        {
+            return std::nullopt;
+        }
+        for(std::vector<vk::DescriptorSetLayoutBinding>& set : interface.sets)
+        {
+            std::sort(set.begin(), set.end(), [](const vk::DescriptorSetLayoutBinding& a, const vk::DescriptorSetLayoutBinding& b)
+            {
+                return a.binding < b.binding;
+            });
+        }
+
+        // one range covering both stages, two ranges may not name the same stage
+        vk::PushConstantRange range(vk::ShaderStageFlags(), UINT32_MAX, 0);
+        uint32_t end = 0;
+        for(const ShaderReflection* stage : { &vertex, &fragment })
+        {
+            if(stage->pushConstantSize == 0)
+            {
+                continue;
+            }
+            range.stageFlags |= stage->stage;
+            range.offset = std::min(range.offset, stage->pushConstantOffset);
+            end = std::max(end, stage->pushConstantOffset + stage->pushConstantSize);
+        }
+        if(range.stageFlags)
+        {
+            range.size = end - range.offset;
+            interface.pushConstants.push_back(range);
+        }
+
+        for(const ShaderVariable& input : fragment.inputs)
+        {
+            auto output = std::find_if(vertex.outputs.begin(), vertex.outputs.end(), [&input](const ShaderVariable& candidate)
+            {
+                return candidate.location == input.location;
+            });
+            if(output == vertex.outputs.end())
+            {
+                std::cerr << name << ": fragment input \"" << input.name << "\" at location " << input.location
+                          << " is not written by the vertex shader\n";
+                return std::nullopt;
+            }
+            if(output->format != input.format)
+            {
+                std::cerr << name << ": fragment input \"" << input.name << "\" doesn't match vertex output \""
+                          << output->name << "\" at location " << input.location << "\n";
+                return std::nullopt;
+            }
+        }
+        interface.vertexInputs = vertex.inputs;
+        return interface;
+    }
+
+    bool is_layout_compatible(const PipelineInterface& layout, const PipelineInterface& shaders, const std::string& name)
+    {
+        for(size_t set = 0; set < shaders.sets.size(); set++)
+        {
+            for(const vk::DescriptorSetLayoutBinding& binding : shaders.sets[set])
+            {
+                const vk::DescriptorSetLayoutBinding* found = nullptr;
+                if(set < layout.sets.size())
+                {
+                    for(const vk::DescriptorSetLayoutBinding& candidate : layout.sets[set])
+                    {
+                        if(candidate.binding == binding.binding)
+                        {
+                            found = &candidate;
+                        }
+                    }
+                }
+                if(found == nullptr || !same_descriptor_type(found->descriptorType, binding.descriptorType)
+                   || found->descriptorCount < binding.descriptorCount
+                   || (found->stageFlags & binding.stageFlags) != binding.stageFlags)
+                {
+                    std::cerr << name << ": set " << set << " binding " << binding.binding << " doesn't match the pipeline layout\n";
+                    return false;
+                }
+            }
+        }
+        for(const vk::PushConstantRange& range : shaders.pushConstants)
+        {
+            bool covered = std::any_of(layout.pushConstants.begin(), layout.pushConstants.end(), [&range](const vk::PushConstantRange& candidate)
+            {
+                return (candidate.stageFlags & range.stageFlags) == range.stageFlags && candidate.offset <= range.offset
+                       && range.offset + range.size <= candidate.offset + candidate.size;
+            });
+            if(!covered)
+            {
+                std::cerr << name << ": push constants don't match the pipeline layout\n";
+                return false;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * @file shader_reflection.hpp
+ * @brief Reads the resources, push constants and stage inputs and outputs a SPIR-V module declares.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_SHADER_REFLECTION_HPP
+#define INC_3DLOADERVK_SHADER_REFLECTION_HPP
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace vkutil
+{
+    /**
+     * @struct ShaderResource
+     * @brief A descriptor a shader declares. A runtime sized array has a count of 0.
+     */
+    struct ShaderResource
+    {
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
+        uint32_t count = 1;
+        std::string name;
+    };
+
+    /**
+     * @struct ShaderVariable
+     * @brief A stage input or output at one location. Matrices are split into one variable per column.
+     */
+    struct ShaderVariable
+    {
+        uint32_t location = 0;
+        vk::Format format = vk::Format::eUndefined;
+        uint32_t size = 0;
+        std::string name;
+    };
+
+    /**
+     * @struct ShaderReflection
+     * @brief What one shader stage expects from the pipeline_ and the stages around it.
+     *
+     * Built-in variables such as gl_Position are left out. A push constant size of 0 means the
+     * stage declares no push constant block.
+     */
+    struct ShaderReflection
+    {
+        vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+        std::vector<ShaderResource> resources;
+        uint32_t pushConstantOffset = 0;
+        uint32_t pushConstantSize = 0;
+        std::vector<ShaderVariable> inputs;
+        std::vector<ShaderVariable> outputs;
+        // the constant_id of every specialization constant, sorted
+        std::vector<uint32_t> specializationIds;
+    };
+
+    /**
+     * @struct PipelineInterface
+     * @brief The resources of every stage of a pipeline_ merged together, what its layout is built from.
+     *
+     * sets is indexed by set number, a set no stage uses is empty. Vertex inputs are sorted by location.
+     */
+    struct PipelineInterface
+    {
+        std::vector<std::vector<vk::DescriptorSetLayoutBinding>> sets;
+        std::vector<vk::PushConstantRange> pushConstants;
+        std::vector<ShaderVariable> vertexInputs;
+    };
+
+    /**
+     * @brief Parses a SPIR-V module.
+     * @param code The module's words.
+     * @param name The shader's name, for error messages.
+     * @return The reflection, or nullopt if the module is malformed or uses something unsupported.
+     */
+    std::optional<ShaderReflection> reflect_shader(std::span<const uint32_t> code, const std::string& name);
+    /**
+     * @brief Merges a vertex and fragment stage, checking that they agree with each other.
+     *
+     * Fails when the stages declare the same binding differently or the fragment shader reads an
+     * input the vertex shader doesn't write with the same format.
+     * Runtime sized arrays keep their count of 0, the layout cache decides where they are allowed.
+     * @return The merged interface, or nullopt with the reason printed.
+     */
+    std::optional<PipelineInterface> link_shader_interface(const ShaderReflection& vertex, const ShaderReflection& fragment,
+                                                           const std::string& name);
+    /**
+     * @brief Whether a pipeline_ with the given interface can be used with a layout built for another.
+     *
+     * Every binding must exist in the layout with the same type, or its dynamic counterpart, a large
+     * enough count and the stage among its stages, and every push constant byte must be covered for the stage.
+     * @return True if compatible, otherwise false with the reason printed.
+     */
+    bool is_layout_compatible(const PipelineInterface& layout, const PipelineInterface& shaders, const std::string& name);
+}
+#endif //INC_3DLOADERVK_SHADER_REFLECTION_HPP
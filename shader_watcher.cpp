@@ -0,0 +1,179 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "shader_watcher.hpp"
+#include <array>
+#include <cstdlib>
+#include "shader_compiler.hpp"
+namespace vkutil
+{
+    namespace
+    {
+        constexpr std::array<const char*, 6> kShaderExtensions = { ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese" };
+        constexpr const char* kHeaderExtension = ".glsl";
+
+        bool is_shader_source(const std::filesystem::path& path)
+        {
+            for(const char* extension : kShaderExtensions)
+            {
+                if(path.extension() == extension)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool is_shader_header(const std::filesystem::path& path)
+        {
+            return path.extension() == kHeaderExtension;
+        }
+    }
+
+    ShaderWatcher::ShaderWatcher(std::filesystem::path directory, std::filesystem::path output_directory, bool debug)
+        : directory_(std::move(directory)), output_directory_(std::move(output_directory))
+    {
+        debug_ = debug;
+        compiler_ = find_glslc();
+        interval_ = std::chrono::milliseconds(250);
+        stop_ = false;
+        // the first scan only records timestamps, the embedded SPIR-V is assumed current
+        Scan(false);
+        if(debug_)
+        {
+            std::cout << "Watching " << timestamps_.size() << " shaders in " << directory_.string()
+                      << ", compiling with " << compiler_ << "\n";
+        }
+        thread_ = std::thread(&ShaderWatcher::WatchLoop, this);
+    }
+
+    ShaderWatcher::~ShaderWatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        stop_requested_.notify_all();
+        thread_.join();
+    }
+
+    std::vector<std::string> ShaderWatcher::take_changed()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::string> changed;
+        changed.swap(changed_);
+        return changed;
+    }
+
+    void ShaderWatcher::WatchLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(!stop_requested_.wait_for(lock, interval_, [this]() { return stop_; }))
+        {
+            lock.unlock();
+            Scan(true);
+            lock.lock();
+        }
+    }
+
+    /**
+     * @brief Checks every source's and header's modification time, compiling the stages that changed.
+     *
+     * Headers aren't compiled on their own, a changed one marks every stage stale instead.
+     * @param compile Whether to compile changed sources or only record their timestamps.
+     */
+    void ShaderWatcher::Scan(bool compile)
+    {
+        std::error_code error;
+        std::filesystem::directory_iterator entries(directory_, error);
+        if(error)
+        {
+            return;
+        }
+        bool header_changed = false;
+        std::vector<std::filesystem::path> stages;
+        std::vector<std::filesystem::path> stale;
+        for(const std::filesystem::directory_entry& entry : entries)
+        {
+            bool header = is_shader_header(entry.path());
+            if(!entry.is_regular_file(error) || (!header && !is_shader_source(entry.path())))
+            {
+                continue;
+            }
+            if(!header)
+            {
+                stages.push_back(entry.path());
+            }
+            std::filesystem::file_time_type modified = entry.last_write_time(error);
+            if(error)
+            {
+                continue;
+            }
+            auto [known, inserted] = timestamps_.emplace(entry.path(), modified);
+            if(!inserted && known->second == modified)
+            {
+                continue;
+            }
+            known->second = modified;
+            if(header)
+            {
+                header_changed = true;
+            }
+            else
+            {
+                stale.push_back(entry.path());
+            }
+        }
+        if(!compile)
+        {
+            return;
+        }
+        for(const std::filesystem::path& source : header_changed ? stages : stale)
+        {
+            std::filesystem::path spirv = OutputFor(source);
+            if(Compile(source, spirv))
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                changed_.push_back(source.filename().string());
+            }
+        }
+    }
+
+    bool ShaderWatcher::Compile(const std::filesystem::path& source, const std::filesystem::path& spirv)
+    {
+        std::filesystem::path temp = spirv;
+        temp += ".tmp";
+        std::string command = "\"" + compiler_ + "\" \"" + source.string() + "\" -o \"" + temp.string() + "\"";
+#ifdef _WIN32
+        // cmd strips the outer quotes of a command line that starts with one
+        command = "\"" + command + "\"";
+#endif
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if(std::system(command.c_str()) != 0)
+        {
+            std::cout << "Failed to compile " << source.string() << ", keeping the previous version\n";
+            std::error_code ignored;
+            std::filesystem::remove(temp, ignored);
+            return false;
+        }
+        std::error_code error;
+        std::filesystem::rename(temp, spirv, error);
+        if(error)
+        {
+            std::cout << "Failed to replace " << spirv.string() << ": " << error.message() << "\n";
+            return false;
+        }
+        if(debug_)
+        {
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Recompiled " << source.filename().string() << " in " << elapsed << " ms\n";
+        }
+        return true;
+    }
+
+    std::filesystem::path ShaderWatcher::OutputFor(const std::filesystem::path& source) const
+    {
+        return output_directory_ / (source.filename().string() + ".spv");
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file shader_watcher.hpp
+ * @brief Defines the ShaderWatcher class, which recompiles GLSL sources when they change on disk.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_SHADER_WATCHER_HPP
+#define INC_3DLOADERVK_SHADER_WATCHER_HPP
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vkutil
+{
+    /**
+     * @class ShaderWatcher
+     * @brief Polls a shader directory and recompiles changed GLSL to SPIR-V on a background thread.
+     *
+     * Polling keeps the watcher portable and a scan of a handful of files is far cheaper than the
+     * interval. Every source file is compiled to <output directory>/<source name>.spv, where
+     * createModule() picks it up in place of the embedded shader. A changed .glsl header recompiles
+     * every stage, since any of them may include it. The SPIR-V is written to a temporary
+     * file first and renamed into place, so a pipeline_ being built never reads a half written module.
+     */
+    class ShaderWatcher
+    {
+    public:
+        /**
+         * @param directory The directory holding the GLSL sources.
+         * @param output_directory The directory the SPIR-V is written to.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        ShaderWatcher(std::filesystem::path directory, std::filesystem::path output_directory, bool debug);
+        ~ShaderWatcher();
+        ShaderWatcher(const ShaderWatcher&) = delete;
+        ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+        /**
+         * @brief Returns the names of the shaders recompiled since the last call, such as "shader.vert".
+         */
+        std::vector<std::string> take_changed();
+    private:
+        void WatchLoop();
+        void Scan(bool compile);
+        bool Compile(const std::filesystem::path& source, const std::filesystem::path& spirv);
+        [[nodiscard]] std::filesystem::path OutputFor(const std::filesystem::path& source) const;
+
+        std::filesystem::path directory_;
+        std::filesystem::path output_directory_;
+        bool debug_;
+        std::string compiler_;
+        std::map<std::filesystem::path, std::filesystem::file_time_type> timestamps_;
+        std::chrono::milliseconds interval_;
+
+        std::mutex mutex_;
+        std::condition_variable stop_requested_;
+        bool stop_;
+        std::vector<std::string> changed_;
+        std::thread thread_;
+    };
+}
+#endif //INC_3DLOADERVK_SHADER_WATCHER_HPP
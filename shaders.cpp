@@ -3,14 +3,99 @@
 //
 
 #include "shaders.hpp"
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include "mapped_file.hpp"
+#include "shader_compiler.hpp"
 namespace vkutil
 {
+    namespace
+    {
+        constexpr uint32_t kSpirvMagic = 0x07230203;
+
+        std::mutex override_mutex;
+        std::filesystem::path override_directory;
+        ShaderCompiler* shader_compiler = nullptr;
+
+        std::filesystem::path get_override_directory()
+        {
+            std::lock_guard<std::mutex> lock(override_mutex);
+            return override_directory;
+        }
+
+        ShaderCompiler* get_shader_compiler()
+        {
+            std::lock_guard<std::mutex> lock(override_mutex);
+            return shader_compiler;
+        }
+
+        ShaderCode load_mapped(const std::filesystem::path& path, const std::string& name, bool debug)
+        {
+            std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path);
+            if(!is_spirv(file->data(), file->size()))
+            {
+                std::cerr << "\"" << path.string() << "\" is not a SPIR-V module\n";
+                return { };
+            }
+            if(debug)
+            {
+                std::cout << "Loading \"" << name << "\" from " << path.string() << "\n";
+            }
+            // mappings are page aligned
+            ShaderCode code;
+            code.words = std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(file->data()), file->size() / sizeof(uint32_t));
+            code.owner = std::move(file);
+            return code;
+        }
+
+        ShaderCode load_compiled(ShaderCompiler& compiler, const std::string& name, const std::vector<std::string>& defines)
+        {
+            std::shared_ptr<std::vector<uint32_t>> words = std::make_shared<std::vector<uint32_t>>(compiler.compile(name, defines));
+            if(words->empty())
+            {
+                return { };
+            }
+            ShaderCode code;
+            code.words = *words;
+            code.owner = std::move(words);
+            return code;
+        }
+    }
+
+    bool is_spirv(const uint8_t* code, size_t size)
+    {
+        if(code == nullptr || size < sizeof(uint32_t) || size % sizeof(uint32_t) != 0)
+        {
+            return false;
+        }
+        uint32_t magic;
+        std::memcpy(&magic, code, sizeof(magic));
+        return magic == kSpirvMagic;
+    }
+
+    void set_shader_compiler(ShaderCompiler* compiler)
+    {
+        std::lock_guard<std::mutex> lock(override_mutex);
+        shader_compiler = compiler;
+    }
+
+    void set_shader_override_directory(std::filesystem::path directory)
+    {
+        std::lock_guard<std::mutex> lock(override_mutex);
+        override_directory = std::move(directory);
+    }
+
     std::vector<char> readFile(std::string filename, bool debug)
     {
         std::ifstream file(filename, std::ios::ate | std::ios::binary);
-        if(debug && !file.is_open())
+        if(!file.is_open())
         {
-            std::cout << "Failed to load \"" << filename << "\"" << std::endl;
+            if(debug)
+            {
+                std::cout << "Failed to load \"" << filename << "\"" << std::endl;
+            }
+            return { };
         }
 
         size_t filesize { static_cast<size_t>(file.tellg()) };
@@ -20,13 +105,60 @@ namespace vkutil
         file.close();
         return buffer;
     }
-    vk::ShaderModule createModule(const std::string& filename, vk::Device device, bool debug)
+
+    ShaderCode loadShader(const std::string& name, bool debug, const std::vector<std::string>& defines)
     {
-        std::vector<char> sourceCode = readFile(filename, debug);
+        ShaderCompiler* compiler = get_shader_compiler();
+        if(!defines.empty())
+        {
+            if(compiler == nullptr)
+            {
+                std::cerr << "Shader \"" << name << "\" has defines but no shader compiler is set\n";
+                return { };
+            }
+            return load_compiled(*compiler, name, defines);
+        }
+        std::error_code error;
+        std::filesystem::path directory = get_override_directory();
+        if(!directory.empty())
+        {
+            std::filesystem::path override_path = directory / (name + ".spv");
+            if(std::filesystem::is_regular_file(override_path, error))
+            {
+                return load_mapped(override_path, name, debug);
+            }
+        }
+        for(const EmbeddedShader& shader : embedded_shaders())
+        {
+            if(name == shader.name)
+            {
+                ShaderCode code;
+                code.words = std::span<const uint32_t>(shader.code, shader.size / sizeof(uint32_t));
+                return code;
+            }
+        }
+        if(compiler != nullptr && compiler->has_source(name))
+        {
+            return load_compiled(*compiler, name, defines);
+        }
+        if(std::filesystem::is_regular_file(name, error))
+        {
+            return load_mapped(name, name, debug);
+        }
+        std::cerr << "Shader \"" << name << "\" is neither embedded nor on disk\n";
+        return { };
+    }
+
+    vk::ShaderModule createModule(const ShaderCode& code, const std::string& name, vk::Device device, bool debug)
+    {
+        if(code.words.empty())
+        {
+            return vk::ShaderModule{};
+        }
         vk::ShaderModuleCreateInfo moduleInfo = {};
         moduleInfo.flags = vk::ShaderModuleCreateFlags();
-        moduleInfo.codeSize = sourceCode.size();
-        moduleInfo.pCode = reinterpret_cast<const uint32_t*>(sourceCode.data());
+        moduleInfo.codeSize = code.words.size_bytes();
+        moduleInfo.pCode = code.words.data();
         try
         {
             return device.createShaderModule(moduleInfo);
@@ -35,9 +167,14 @@ namespace vkutil
         {
             if(debug)
             {
-                std::cout << "Failed to create shader module for \"" << filename << "\"" << std::endl;
+                std::cout << "Failed to create shader module for \"" << name << "\"" << std::endl;
             }
             return vk::ShaderModule{};
         }
     }
-}
\ No newline at end of file
+
+    vk::ShaderModule createModule(const std::string& name, vk::Device device, bool debug, const std::vector<std::string>& defines)
+    {
+        return createModule(loadShader(name, debug, defines), name, device, debug);
+    }
+}
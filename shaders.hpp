@@ -4,14 +4,73 @@
 #ifndef INC_3DLOADERVK_SHADERS_HPP
 #define INC_3DLOADERVK_SHADERS_HPP
 #include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <filesystem>
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <span>
 #include <string>
 namespace vkutil
 {
+    /**
+     * @brief SPIR-V compiled by the build and linked into the binary, named after its GLSL source.
+     */
+    struct EmbeddedShader
+    {
+        const char* name;
+        const uint32_t* code;
+        size_t size;
+    };
+
+    /**
+     * @brief The words of a loaded shader, kept alive by owner when they aren't embedded.
+     */
+    struct ShaderCode
+    {
+        std::span<const uint32_t> words;
+        std::shared_ptr<const void> owner;
+    };
+
+    /**
+     * @brief Returns every shader embedded at build time.
+     */
+    std::span<const EmbeddedShader> embedded_shaders();
+    class ShaderCompiler;
+
+    /**
+     * @brief Whether the bytes hold a whole number of words starting with the SPIR-V magic number.
+     */
+    bool is_spirv(const uint8_t* code, size_t size);
+    /**
+     * @brief Sets the compiler used for shader variants and sources that aren't embedded, null disables it.
+     */
+    void set_shader_compiler(ShaderCompiler* compiler);
+    /**
+     * @brief Sets a directory whose <name>.spv files take precedence over the embedded shaders, empty disables it.
+     */
+    void set_shader_override_directory(std::filesystem::path directory);
     std::vector<char> readFile(std::string filename, bool debug);
-    vk::ShaderModule createModule(const std::string& filename, vk::Device device, bool debug);
+    /**
+     * @brief Loads the SPIR-V of a shader name such as "shader.vert".
+     *
+     * Without defines the name is looked up as <override directory>/<name>.spv first, then among the
+     * embedded shaders, then compiled from source by the shader compiler, and last as a path to a
+     * SPIR-V file. Files are memory mapped rather than read. Variants with defines always go
+     * through the shader compiler.
+     * @param defines Preprocessor definitions selecting a variant, "NAME" or "NAME=VALUE".
+     * @return The code, with no words when the shader can't be found or is rejected.
+     */
+    ShaderCode loadShader(const std::string& name, bool debug, const std::vector<std::string>& defines = { });
+    /**
+     * @brief Creates a shader module from loaded code, a null handle if there is none or it is rejected.
+     */
+    vk::ShaderModule createModule(const ShaderCode& code, const std::string& name, vk::Device device, bool debug);
+    /**
+     * @brief Loads a shader with loadShader() and creates a module from it.
+     */
+    vk::ShaderModule createModule(const std::string& name, vk::Device device, bool debug, const std::vector<std::string>& defines = { });
 }
 
 #endif //INC_3DLOADERVK_SHADERS_HPP
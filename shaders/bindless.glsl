@@ -0,0 +1,20 @@
+// Bindless resources, the shader side of vkutil::BindlessTable. Include after #version with
+// #extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define BINDLESS_SET 1
+#define BINDLESS_BUFFER_BINDING 0
+#define BINDLESS_TEXTURE_BINDING 1
+
+// Every buffer of the table viewed as an array of the given struct, indexed by buffer ID:
+// BINDLESS_BUFFER(Material, materials); ... materials[id].data[i]
+#define BINDLESS_BUFFER(Type, name) \
+    layout(std430, set = BINDLESS_SET, binding = BINDLESS_BUFFER_BINDING) readonly buffer Type##Buffer { Type data[]; } name[]
+
+layout(set = BINDLESS_SET, binding = BINDLESS_TEXTURE_BINDING) uniform sampler2D bindless_textures[];
+
+// IDs that may differ between invocations of a draw have to be marked non-uniform
+vec4 bindless_sample(uint id, vec2 uv)
+{
+    return texture(bindless_textures[nonuniformEXT(id)], uv);
+}
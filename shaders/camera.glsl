@@ -0,0 +1,11 @@
+// The per frame camera, the shader side of vkutil::CameraData. Set 0 is reserved for it and bound
+// once per frame with a dynamic offset. Include after #version with
+// #extension GL_GOOGLE_include_directive : require
+layout(set = 0, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 position;
+    // inward facing (normal, distance) planes: left, right, top, bottom, near, far
+    vec4 frustum[6];
+} camera;
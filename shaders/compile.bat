@@ -1,3 +0,0 @@
-set GLSLC="D:\VULKAN_SDK\Bin\glslc.exe"
-%GLSLC% quad.vert -o vertex.spv
-%GLSLC% quad.frag -o fragment.spv
\ No newline at end of file
@@ -1,3 +0,0 @@
-#!/bin/sh
-/nix/store/3vv8z2q40pabnlkld3i74l9sdiix1zpn-shaderc-2022.4-bin/bin/glslc shader.vert -o vertex.spv
-/nix/store/3vv8z2q40pabnlkld3i74l9sdiix1zpn-shaderc-2022.4-bin/bin/glslc shader.frag -o fragment.spv
@@ -1,16 +1,17 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#include "camera.glsl"
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
 
-layout(set = 0, binding = 0) uniform UBO {
+layout (push_constant) uniform constants {
     mat4 model;
-    mat4 view;
-    mat4 proj;
-} ubo;
+} ObjectData;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = camera.viewProjection * ObjectData.model * vec4(inPosition, 1.0);
     fragColor = inColor;
 }
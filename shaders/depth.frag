@@ -0,0 +1,5 @@
+#version 450
+
+// depth only passes write no color, the stage only exists because every pipeline has one
+void main() {
+}
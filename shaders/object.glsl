@@ -0,0 +1,46 @@
+// The scene's objects, the shader side of vkutil::ObjectData and vkutil::DrawIds. Every frame
+// writes its objects to one buffer of the bindless table, each draw pushes that buffer's ID and
+// the index of the object drawn. Built with NO_BINDLESS, for devices without descriptor indexing,
+// draws push the model matrix instead. Include after #version with
+// #extension GL_GOOGLE_include_directive : require
+#ifdef NO_BINDLESS
+layout(push_constant) uniform Draw {
+    mat4 model;
+} draw;
+
+mat4 object_model()
+{
+    return draw.model;
+}
+
+vec4 object_color()
+{
+    return vec4(1.0);
+}
+#else
+#include "bindless.glsl"
+
+struct Object {
+    mat4 model;
+    // multiplies the vertex colors
+    vec4 color;
+};
+
+BINDLESS_BUFFER(Object, objects);
+
+layout(push_constant) uniform Draw {
+    uint objectBuffer;
+    uint object;
+} draw;
+
+// push constants are uniform across a draw, so the IDs need no nonuniformEXT
+mat4 object_model()
+{
+    return objects[draw.objectBuffer].data[draw.object].model;
+}
+
+vec4 object_color()
+{
+    return objects[draw.objectBuffer].data[draw.object].color;
+}
+#endif
@@ -1,8 +1,17 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#include "object.glsl"
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 0) out vec4 outColor;
 
+// 0 shades with the vertex colors, 1 shows the depth, switched at runtime by Engine::cycle_debug_view
+layout(constant_id = 0) const uint debugView = 0;
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    if (debugView == 1u) {
+        outColor = vec4(vec3(gl_FragCoord.z), 1.0);
+        return;
+    }
+    outColor = vec4(fragColor, 1.0) * object_color();
 }
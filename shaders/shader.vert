@@ -1,15 +1,17 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#include "camera.glsl"
+#include "object.glsl"
 
 layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec3 vertexColor;
 
-layout (push_constant) uniform constants {
-    mat4 model;
-} ObjectData;
-
 layout(location = 0) out vec3 fragColor;
 
+// the depth pre-pass runs this shader too, the color pass's equal test needs the exact same depth
+invariant gl_Position;
+
 void main() {
-    gl_Position = ObjectData.model * vec4(vertexPosition, 1.0);
+    gl_Position = camera.viewProjection * object_model() * vec4(vertexPosition, 1.0);
     fragColor = vertexColor;
 }
@@ -1,4 +1,6 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#include "camera.glsl"
 
 layout(location = 0) in vec2 vertexPosition;
 layout(location = 1) in vec3 vertexColor;
@@ -10,6 +12,6 @@ layout (push_constant) uniform constants{
 layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = ObjectData.model * vec4(vertexPosition, 0.0, 1.0);
+    gl_Position = camera.viewProjection * ObjectData.model * vec4(vertexPosition, 0.0, 1.0);
     fragColor = vertexColor;
 }
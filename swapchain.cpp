@@ -81,9 +81,12 @@ namespace vkinit
             }
         }
         support.presentModes = device.getSurfacePresentModesKHR(surface);
-        for (vk::PresentModeKHR presentMode: support.presentModes)
+        if (debug)
         {
-            std::cout << '\t' << log_present_mode(presentMode) << '\n';
+            for (vk::PresentModeKHR presentMode: support.presentModes)
+            {
+                std::cout << '\t' << log_present_mode(presentMode) << '\n';
+            }
         }
         return support;
     }
@@ -110,26 +113,53 @@ namespace vkinit
     }
 
     /**
-     * @brief Chooses the best available present mode for the swap chain.
+     * @brief Chooses the present mode for the swap chain.
      *
-     * Selects a presentation mode from the available modes, with a preference for
-     * 'mailbox' mode, which supports triple buffering.
+     * Returns the requested mode if the surface_ supports it, otherwise 'fifo', the only
+     * mode every implementation is required to support.
      *
      * @param presentModes A vector of available presentation modes.
+     * @param requested The present mode asked for by the frame pacing settings.
+     * @param debug Flag indicating whether to enable debug logging.
      * @return The chosen vk::PresentModeKHR.
      */
-    vk::PresentModeKHR choose_swapchain_present_mode(std::vector<vk::PresentModeKHR> presentModes)
+    vk::PresentModeKHR choose_swapchain_present_mode(std::vector<vk::PresentModeKHR> presentModes, vk::PresentModeKHR requested, bool debug)
     {
         for (vk::PresentModeKHR presentMode: presentModes)
         {
-            if (presentMode == vk::PresentModeKHR::eMailbox)
+            if (presentMode == requested)
             {
                 return presentMode;
             }
         }
+        if (debug)
+        {
+            std::cout << "Present mode " << vk::to_string(requested) << " is not supported, falling back to fifo\n";
+        }
         return vk::PresentModeKHR::eFifo;
     }
 
+    /**
+     * @brief Chooses the number of images in the swap chain.
+     *
+     * A request of zero keeps the default of one more than the surface_ minimum, any request
+     * is clamped to the limits of the surface_, where a maximum of zero means unbounded.
+     *
+     * @param capabilities The surface_ capabilities.
+     * @param requested The image count asked for by the frame pacing settings.
+     * @return The image count to create the swap chain with.
+     */
+    uint32_t choose_swapchain_image_count(const vk::SurfaceCapabilitiesKHR& capabilities, uint32_t requested)
+    {
+        uint32_t imageCount = requested == 0 ? capabilities.minImageCount + 1 : requested;
+        imageCount = std::max(imageCount, capabilities.minImageCount);
+        if (capabilities.maxImageCount > 0)
+        {
+            imageCount = std::min(imageCount, capabilities.maxImageCount);
+        }
+        return imageCount;
+    }
+
     /**
      * @brief Determines the extent of the swap chain images.
      *
@@ -173,22 +203,28 @@ namespace vkinit
      * @param logicalDevice The Vulkan logical device_.
      * @param physicalDevice The Vulkan physical device_.
      * @param surface The Vulkan surface_.
+     * @param queueFamilies The queue families of the device_, the images are shared by graphics and present.
      * @param width The width_ of the window_.
      * @param height The height_ of the window_.
+     * @param oldSwapchain The swap chain being replaced, or nullptr.
+     * @param pacing The requested present mode and image count.
      * @param debug Flag indicating whether to enable debug logging.
      * @return A SwapChainBlundle containing the swap chain and its related components.
      */
-    SwapChainBundle create_swapchain(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, int width, int height, bool debug)
+    SwapChainBundle create_swapchain(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, const vkutil::QueueFamilyIndices& queueFamilies, int width, int height, vk::SwapchainKHR oldSwapchain, const vkutil::FramePacingSettings& pacing, bool debug)
     {
         SwapChainSupportDetails support = query_swapchain_support(physicalDevice, surface, debug);
         vk::SurfaceFormatKHR format = choose_swapchain_surface_format(support.formats);
-        vk::PresentModeKHR presentMode = choose_swapchain_present_mode(support.presentModes);
+        vk::PresentModeKHR presentMode = choose_swapchain_present_mode(support.presentModes, pacing.presentMode, debug);
         vk::Extent2D extent = choose_swapchain_extent(static_cast<uint32_t>(width), static_cast<uint32_t>(height), support.capabilities);
-        uint32_t imageCount = std::min
-                (
-                        support.capabilities.maxImageCount,
-                        support.capabilities.minImageCount + 1
-                );
+        uint32_t imageCount = choose_swapchain_image_count(support.capabilities, pacing.imageCount);
+        // copying from the images lets rendered frames be read back
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment |
+                                    (support.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc);
+        if(debug)
+        {
+            std::cout << "Creating a swapchain_ of " << imageCount << " images in " << vk::to_string(presentMode) << " mode\n";
+        }
 
         vk::SwapchainCreateInfoKHR createInfo = vk::SwapchainCreateInfoKHR
         (
@@ -199,14 +235,9 @@ namespace vkinit
             format.colorSpace,
             extent,
             1,
-            vk::ImageUsageFlagBits::eColorAttachment
-        );
-        vkutil::QueueFamilyIndices indices = vkutil::findQueueFamilies
-        (
-            physicalDevice,
-            surface,
-            debug
+            usage
         );
+        const vkutil::QueueFamilyIndices& indices = queueFamilies;
         uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
 
         if(indices.graphicsFamily.value() != indices.presentFamily.value())
@@ -225,7 +256,7 @@ namespace vkinit
         createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
 
-        createInfo.oldSwapchain = vk::SwapchainKHR(nullptr);
+        createInfo.oldSwapchain = oldSwapchain;
 
         SwapChainBundle bundle{ };
         try
@@ -263,6 +294,8 @@ namespace vkinit
         }
         bundle.format = format.format;
         bundle.extent = extent;
+        bundle.presentMode = presentMode;
+        bundle.usage = usage;
 
         return bundle;
     }
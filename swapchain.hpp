@@ -12,6 +12,7 @@
 #include "logging.hpp"
 #include "queue_families.hpp"
 #include "frame.hpp"
+#include "frame_pacing.hpp"
 #include <vector>
 #include <vulkan/vulkan.hpp>
 #include <iostream>
@@ -44,6 +45,9 @@ namespace vkinit
         std::vector<vkutil::SwapChainFrame> frames;
         vk::Format format;
         vk::Extent2D extent;
+        vk::PresentModeKHR presentMode;
+        // what the images can be used for, color attachment and, where supported, copies
+        vk::ImageUsageFlags usage;
     };
 
     /**
@@ -70,15 +74,29 @@ namespace vkinit
     vk::SurfaceFormatKHR choose_swapchain_surface_format(std::vector<vk::SurfaceFormatKHR> formats);
 
     /**
-     * @brief Chooses the best available present mode for the swap chain.
+     * @brief Chooses the present mode for the swap chain.
      *
-     * Selects a presentation mode from the available modes, with a preference for
-     * 'mailbox' mode, which supports triple buffering.
+     * Returns the requested mode if the surface_ supports it, otherwise 'fifo', the only
+     * mode every implementation is required to support.
      *
      * @param presentModes A vector of available presentation modes.
+     * @param requested The present mode asked for by the frame pacing settings.
+     * @param debug Flag indicating whether to enable debug logging.
      * @return The chosen vk::PresentModeKHR.
      */
-    vk::PresentModeKHR choose_swapchain_present_mode(std::vector<vk::PresentModeKHR> presentModes);
+    vk::PresentModeKHR choose_swapchain_present_mode(std::vector<vk::PresentModeKHR> presentModes, vk::PresentModeKHR requested, bool debug);
+
+    /**
+     * @brief Chooses the number of images in the swap chain.
+     *
+     * A request of zero keeps the default of one more than the surface_ minimum, any request
+     * is clamped to the limits of the surface_, where a maximum of zero means unbounded.
+     *
+     * @param capabilities The surface_ capabilities.
+     * @param requested The image count asked for by the frame pacing settings.
+     * @return The image count to create the swap chain with.
+     */
+    uint32_t choose_swapchain_image_count(const vk::SurfaceCapabilitiesKHR& capabilities, uint32_t requested);
 
     /**
      * @brief Determines the extent of the swap chain images.
@@ -102,11 +120,15 @@ namespace vkinit
      * @param logicalDevice The Vulkan logical device_.
      * @param physicalDevice The Vulkan physical device_.
      * @param surface The Vulkan surface_.
+     * @param queueFamilies The queue families of the device_, the images are shared by graphics and present.
      * @param width The width_ of the window_.
      * @param height The height_ of the window_.
+     * @param oldSwapchain The swap chain being replaced, or nullptr. Passing it lets the driver hand
+     *                     its resources over, and it stays valid until the caller destroys it.
+     * @param pacing The requested present mode and image count.
      * @param debug Flag indicating whether to enable debug logging.
      * @return A SwapChainBlundle containing the swap chain and its related components.
      */
-    SwapChainBundle create_swapchain(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, int width, int height, bool debug);
+    SwapChainBundle create_swapchain(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, const vkutil::QueueFamilyIndices& queueFamilies, int width, int height, vk::SwapchainKHR oldSwapchain, const vkutil::FramePacingSettings& pacing, bool debug);
 }
 #endif //INC_3DLOADERVK_SWAPCHAIN_HPP
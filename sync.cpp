@@ -60,4 +60,36 @@ namespace vkinit
             return nullptr;
         }
     }
+    /**
+     * @brief Creates a Vulkan timeline semaphore.
+     *
+     * Unlike a binary semaphore, a timeline semaphore carries a 64-bit counter that only increases.
+     * Submissions signal and wait on specific values, and the host can query or wait on them too.
+     *
+     * @param device The Vulkan logical device_ used to create the semaphore.
+     * @param initial_value The counter value the semaphore starts at.
+     * @param debug Flag indicating whether to enable debug logging.
+     * @return A Vulkan semaphore object, or nullptr if creation fails.
+     */
+    vk::Semaphore make_timeline_semaphore(vk::Device device, uint64_t initial_value, bool debug)
+    {
+        vk::SemaphoreTypeCreateInfo typeInfo = { };
+        typeInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+        typeInfo.initialValue = initial_value;
+        vk::SemaphoreCreateInfo semaphoreInfo = { };
+        semaphoreInfo.flags = vk::SemaphoreCreateFlags();
+        semaphoreInfo.pNext = &typeInfo;
+        try
+        {
+            return device.createSemaphore(semaphoreInfo);
+        }
+        catch(vk::SystemError &err)
+        {
+            if(debug)
+            {
+                std::cout << "Failed to create timeline semaphore" << std::endl;
+            }
+            return nullptr;
+        }
+    }
 }
\ No newline at end of file
@@ -15,5 +15,6 @@ namespace vkinit
 {
     vk::Semaphore make_semaphore(vk::Device device, bool debug);
     vk::Fence make_fence(vk::Device device, bool debug);
+    vk::Semaphore make_timeline_semaphore(vk::Device device, uint64_t initial_value, bool debug);
 }
 #endif //INC_3DLOADERVK_SYNC_HPP
\ No newline at end of file
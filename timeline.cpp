@@ -0,0 +1,111 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "timeline.hpp"
+#include "sync.hpp"
+#include <algorithm>
+namespace vkutil
+{
+    Timeline::Timeline(vk::Device device, bool debug)
+    {
+        this->device_ = device;
+        this->debug_ = debug;
+        semaphore_ = vkinit::make_timeline_semaphore(device, 0, debug);
+    }
+
+    Timeline::~Timeline()
+    {
+        device_.destroySemaphore(semaphore_);
+    }
+
+    vk::Semaphore Timeline::semaphore() const
+    {
+        return semaphore_;
+    }
+
+    uint64_t Timeline::advance()
+    {
+        return next_value_.fetch_add(1) + 1;
+    }
+
+    uint64_t Timeline::last_signaled() const
+    {
+        return next_value_.load();
+    }
+
+    /**
+     * @brief Queries the driver for the completed value.
+     *
+     * The cache only ever moves forward, so concurrent pollers can't roll it back to an older value.
+     */
+    uint64_t Timeline::poll()
+    {
+        uint64_t reached = device_.getSemaphoreCounterValue(semaphore_);
+        uint64_t cached = completed_value_.load();
+        while(cached < reached && !completed_value_.compare_exchange_weak(cached, reached))
+        {
+        }
+        return std::max(cached, reached);
+    }
+
+    bool Timeline::is_complete(uint64_t value)
+    {
+        if(value <= completed_value_.load())
+        {
+            return true;
+        }
+        return value <= poll();
+    }
+
+    bool Timeline::wait(uint64_t value, uint64_t timeout)
+    {
+        if(is_complete(value))
+        {
+            return true;
+        }
+        vk::SemaphoreWaitInfo waitInfo = { };
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &semaphore_;
+        waitInfo.pValues = &value;
+        try
+        {
+            if(device_.waitSemaphores(waitInfo, timeout) != vk::Result::eSuccess)
+            {
+                return false;
+            }
+        }
+        catch(vk::SystemError &err)
+        {
+            if(debug_)
+            {
+                std::cout << "Failed to wait for timeline value " << value << std::endl;
+            }
+            return false;
+        }
+        poll();
+        return true;
+    }
+
+    bool Timeline::signal(uint64_t value)
+    {
+        if(!wait(value - 1))
+        {
+            return false;
+        }
+        vk::SemaphoreSignalInfo signalInfo = { };
+        signalInfo.semaphore = semaphore_;
+        signalInfo.value = value;
+        try
+        {
+            device_.signalSemaphore(signalInfo);
+        }
+        catch(vk::SystemError &err)
+        {
+            std::cerr << "Failed to signal timeline value " << value << ": " << err.what() << std::endl;
+            return false;
+        }
+        poll();
+        return true;
+    }
+}
@@ -0,0 +1,86 @@
+/**
+ * @file timeline.hpp
+ * @brief Defines the Timeline class, a monotonically increasing GPU/CPU synchronization point.
+ * @date Created by Renato on 18-10-26.
+ *
+ * A timeline wraps a Vulkan timeline semaphore. Every submission that wants to be tracked reserves
+ * the next value with advance() and signals it, after which any subsystem can wait for, or cheaply
+ * poll, that exact value without owning a fence.
+ */
+#ifndef INC_3DLOADERVK_TIMELINE_HPP
+#define INC_3DLOADERVK_TIMELINE_HPP
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+namespace vkutil
+{
+    /**
+     * @class Timeline
+     * @brief Owns a timeline semaphore and tracks the values reserved and completed on it.
+     *
+     * The completed value is cached, so is_complete() only reaches the driver when the cached value is
+     * older than the value being asked about. All counters are atomic so other threads may poll.
+     */
+    class Timeline
+    {
+    public:
+        /**
+         * @brief Creates the timeline semaphore with an initial value of zero.
+         * @param device The Vulkan logical device.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        Timeline(vk::Device device, bool debug);
+        ~Timeline();
+        Timeline(const Timeline&) = delete;
+        Timeline& operator=(const Timeline&) = delete;
+        /**
+         * @brief The underlying semaphore, to be placed in a submit's signal or wait list.
+         */
+        [[nodiscard]] vk::Semaphore semaphore() const;
+        /**
+         * @brief Reserves the next value on the timeline; the caller must signal it.
+         * @return The newly reserved value.
+         */
+        uint64_t advance();
+        /**
+         * @brief The most recently reserved value.
+         */
+        [[nodiscard]] uint64_t last_signaled() const;
+        /**
+         * @brief Queries the driver for the value the GPU has reached and refreshes the cache.
+         * @return The completed value.
+         */
+        uint64_t poll();
+        /**
+         * @brief Checks whether a value has been reached, querying the driver only if needed.
+         * @param value The value to test.
+         * @return true if the GPU has signaled at least this value.
+         */
+        bool is_complete(uint64_t value);
+        /**
+         * @brief Blocks the calling thread until the given value is signaled or the timeout expires.
+         * @param value The value to wait for.
+         * @param timeout Timeout in nanoseconds.
+         * @return true if the value was reached.
+         */
+        bool wait(uint64_t value, uint64_t timeout = UINT64_MAX);
+        /**
+         * @brief Signals a reserved value from the host, for work that reserved it and was never submitted.
+         *
+         * Waits for the value before it first, a host signal must not overtake values the GPU has yet to signal.
+         *
+         * @param value The value to signal.
+         * @return true if the value was signaled.
+         */
+        bool signal(uint64_t value);
+    private:
+        vk::Device device_;
+        vk::Semaphore semaphore_;
+        std::atomic<uint64_t> next_value_{ 0 };
+        std::atomic<uint64_t> completed_value_{ 0 };
+        bool debug_;
+    };
+}
+#endif //INC_3DLOADERVK_TIMELINE_HPP
@@ -0,0 +1,83 @@
+/**
+ * @file triple_buffer.hpp
+ * @brief Defines TripleBuffer, a lock-free single producer, single consumer handoff of the latest value.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_TRIPLE_BUFFER_HPP
+#define INC_3DLOADERVK_TRIPLE_BUFFER_HPP
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace vkutil
+{
+    /**
+     * @class TripleBuffer
+     * @brief Hands the most recently published value from one thread to another without locks.
+     *
+     * The producer owns the back slot and the consumer owns the front slot; the middle slot is
+     * exchanged atomically between them. Neither side ever waits for the other: the producer can
+     * publish faster than the consumer reads, in which case stale values are simply skipped, and
+     * the consumer keeps reading its front slot until something newer is published.
+     *
+     * @tparam T The value type, default constructible. Slots are reused, so a type holding containers
+     *           keeps its capacity between publishes.
+     */
+    template<typename T>
+    class TripleBuffer
+    {
+    public:
+        TripleBuffer() : middle_(1), back_(2), front_(0)
+        {
+        }
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+        /**
+         * @brief The slot the producer fills before calling publish().
+         */
+        T& write_buffer()
+        {
+            return slots_[back_].value;
+        }
+        /**
+         * @brief Makes the write buffer visible to the consumer and takes a new one.
+         */
+        void publish()
+        {
+            back_ = static_cast<uint8_t>(middle_.exchange(static_cast<uint8_t>(back_ | kFresh), std::memory_order_acq_rel) & kIndexMask);
+        }
+        /**
+         * @brief Moves the most recently published value to the front, if there is one.
+         * @return true if the front slot now holds a value that wasn't read before.
+         */
+        bool acquire()
+        {
+            if((middle_.load(std::memory_order_relaxed) & kFresh) == 0)
+            {
+                return false;
+            }
+            front_ = static_cast<uint8_t>(middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask);
+            return true;
+        }
+        /**
+         * @brief The slot the consumer reads, stable until the next acquire().
+         */
+        const T& read_buffer() const
+        {
+            return slots_[front_].value;
+        }
+    private:
+        static constexpr uint8_t kIndexMask = 0x3;
+        static constexpr uint8_t kFresh = 0x4;
+        // each slot on its own cache line so producer and consumer don't false share
+        struct alignas(64) Slot
+        {
+            T value;
+        };
+        std::array<Slot, 3> slots_;
+        std::atomic<uint8_t> middle_;
+        uint8_t back_;
+        uint8_t front_;
+    };
+}
+#endif //INC_3DLOADERVK_TRIPLE_BUFFER_HPP
@@ -0,0 +1,75 @@
+//
+// Created by Renato on 18-10-26.
+//
+
+#include "uniform_buffer.hpp"
+#include "memory.hpp"
+namespace vkutil
+{
+    FrameUniformBuffer::FrameUniformBuffer(vk::Device device, const vkinit::DeviceCapabilities& capabilities, vk::DeviceSize size,
+                                           uint32_t frame_count, bool debug)
+    {
+        device_ = device;
+        mapped_ = nullptr;
+        size_ = size;
+        frame_count_ = frame_count;
+        vk::DeviceSize alignment = std::max<vk::DeviceSize>(capabilities.properties.limits.minUniformBufferOffsetAlignment, 1);
+        stride_ = (size + alignment - 1) / alignment * alignment;
+
+        BufferInput input;
+        input.size = stride_ * frame_count;
+        input.usage = vk::BufferUsageFlagBits::eUniformBuffer;
+        input.logical_device = device;
+        input.physical_device = capabilities.physicalDevice;
+        try
+        {
+            buffer_ = createBuffer(input);
+            // host coherent, writes need no flush
+            mapped_ = device_.mapMemory(buffer_.buffer_memory, 0, VK_WHOLE_SIZE);
+        }
+        catch(std::exception &err)
+        {
+            std::cout << "Failed to create a per frame uniform buffer: " << err.what() << "\n";
+            return;
+        }
+        if(debug)
+        {
+            std::cout << "Per frame uniform buffer of " << frame_count << " slices of " << stride_ << " bytes\n";
+        }
+    }
+
+    FrameUniformBuffer::~FrameUniformBuffer()
+    {
+        if(mapped_ != nullptr)
+        {
+            device_.unmapMemory(buffer_.buffer_memory);
+        }
+        device_.destroyBuffer(buffer_.buffer);
+        device_.freeMemory(buffer_.buffer_memory);
+    }
+
+    bool FrameUniformBuffer::valid() const
+    {
+        return mapped_ != nullptr;
+    }
+
+    uint32_t FrameUniformBuffer::write(uint32_t frame, const void* data)
+    {
+        vk::DeviceSize offset = stride_ * (frame % frame_count_);
+        if(mapped_ != nullptr)
+        {
+            std::memcpy(static_cast<char*>(mapped_) + offset, data, size_);
+        }
+        return static_cast<uint32_t>(offset);
+    }
+
+    vk::Buffer FrameUniformBuffer::buffer() const
+    {
+        return buffer_.buffer;
+    }
+
+    vk::DeviceSize FrameUniformBuffer::range() const
+    {
+        return size_;
+    }
+}
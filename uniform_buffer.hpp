@@ -0,0 +1,68 @@
+/**
+ * @file uniform_buffer.hpp
+ * @brief Defines the FrameUniformBuffer class, a persistently mapped uniform buffer with a slice per frame in flight.
+ * @date Created by Renato on 18-10-26.
+ */
+#ifndef INC_3DLOADERVK_UNIFORM_BUFFER_HPP
+#define INC_3DLOADERVK_UNIFORM_BUFFER_HPP
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "config.hpp"
+#include "device.hpp"
+
+namespace vkutil
+{
+    /**
+     * @class FrameUniformBuffer
+     * @brief One host visible uniform buffer, mapped for its whole life, split into a slice per frame in flight.
+     *
+     * A frame writes only its own slice, which the GPU is done reading once the frame's previous
+     * submission finished, so no copies or barriers are needed. Slices are aligned to the device_'s
+     * minimum uniform buffer offset, a descriptor set written once with a dynamic uniform buffer
+     * selects one through the offset returned by write().
+     */
+    class FrameUniformBuffer
+    {
+    public:
+        /**
+         * @param device The Vulkan logical device_.
+         * @param capabilities The snapshot of the physical device_, its limits align the slices.
+         * @param size The size of one frame's data.
+         * @param frame_count The number of frames in flight.
+         * @param debug Flag indicating whether to enable debug logging.
+         */
+        FrameUniformBuffer(vk::Device device, const vkinit::DeviceCapabilities& capabilities, vk::DeviceSize size, uint32_t frame_count, bool debug);
+        ~FrameUniformBuffer();
+        FrameUniformBuffer(const FrameUniformBuffer&) = delete;
+        FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+        [[nodiscard]] bool valid() const;
+        /**
+         * @brief Copies a frame's data into its slice.
+         * @param frame The frame in flight index.
+         * @param data The data, the size the buffer was created with.
+         * @return The dynamic offset of the frame's slice.
+         */
+        uint32_t write(uint32_t frame, const void* data);
+        template<typename T>
+        uint32_t write(uint32_t frame, const T& data)
+        {
+            return write(frame, static_cast<const void*>(&data));
+        }
+        [[nodiscard]] vk::Buffer buffer() const;
+        /**
+         * @brief The size of one slice's data, the range to write into a dynamic descriptor.
+         */
+        [[nodiscard]] vk::DeviceSize range() const;
+    private:
+        vk::Device device_;
+        Buffer buffer_;
+        void* mapped_;
+        vk::DeviceSize size_;
+        vk::DeviceSize stride_;
+        uint32_t frame_count_;
+    };
+}
+#endif //INC_3DLOADERVK_UNIFORM_BUFFER_HPP